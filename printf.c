@@ -1,17 +1,37 @@
 // C/Posix standard library function printf and its derivatives.
 // Includes printf, fprintf, sprintf, snprintf, asprintf (for allocated string),
-// dprintf (for file descriptors), and vprintf forms of all. Allows for posix
+// dprintf (for file descriptors), cbprintf (for user callbacks), mmprintf (for 
+// memory mapped log files), ringprintf (for shared memory rings), hashprintf
+// (for a digest of the output), and vprintf forms of all. Allows for posix 
 // positional arguments.
 // 
 // printf.c - provides printf family functions, generic input/output.
 // printf_arguments.c/h - va_arg / posix positional parsing.
 // printf_basic_output.c/h - everything but floating point output.
 // printf_format.c/h - printf format string parsing helpers.
+// printf_allocator.c/h - memory for asprintf and positional arguments.
+// printf_mmap.c/h - memory mapped log file output.
+// printf_ring.c/h - shared memory ring output.
+// printf_hash.c/h - hashing of output.
+// printf_compile.c/h - format strings parsed once, for printing many times.
+// printf_compile_generator.c - generates C for format strings known early.
+// printf_batch.c/h - one format over arrays of records.
+// printf_decimal.c/h - arrays of integers in decimal, vectorised.
+// printf_cpu.c/h - picks vectorised kernels for the processor.
+// printf_custom.c/h - conversion letters, and user registered conversions.
+// printf_json.c/h - strings escaped for JSON, "%{json}".
+// printf_binary.c/h - bytes in hexadecimal and base64, "%{hex}" and others.
+// printf_bignum.c/h - arbitrary precision integers, "%{bignum}".
+// printf_quantity.c/h - readable sizes and fixed point, "%{iec}", "%{fixed}".
+// printf_locale.c/h - the locale's digit grouping and decimal point.
+// printf_decimal_float.c/h - decimal floating point, "%Df" and others.
 // printf_definitons.h - general data structures and functions.
+// printf.hpp - type safe C++ front end.
+// printf_format.hpp - format string parsing when compiling, for printf.hpp.
 //
 // TODO: printf_s bounds checked versions.
 //       wide character support, both input and output.
-//       floating point support.
+//       binary floating point support.
 //
 // Copyright 2017 - Elliot Dawber. MIT licensed.
 
@@ -29,6 +49,13 @@
 #include "printf_basic_output.h"
 #include "printf_arguments.h"
 #include "printf_format.h"
+#include "printf_allocator.h"
+#include "printf_mmap.h"
+#include "printf_ring.h"
+#include "printf_hash.h"
+#include "printf_cpu.h"
+#include "printf_custom.h"
+#include "printf_decimal_float.h"
 
 
 
@@ -36,12 +63,39 @@
 
 
 
+static bool generic_printf_argv(output_specifier *output, const char *format,
+								const printf_arg *args, size_t count);
 static bool generic_printf(output_specifier *output, const char *format, 
 						   va_list_s *valist);
 static bool printf_output_asprintf(output_specifier *output, char c);
 static bool printf_output_dprintf(output_specifier *output, char c);
 static bool printf_output_fprintf(output_specifier *output, char c);
 static bool printf_output_sprintf(output_specifier *output, char c);
+static bool printf_output_hash(output_specifier *output, char c);
+static bool printf_output_span_hash(output_specifier *output, 
+									const char *span, size_t length);
+static bool printf_output_is_buffered(const output_specifier *output);
+static bool printf_output_tee(output_specifier *output, const char *span, 
+							  size_t length);
+static void printf_output_fail_child(output_specifier *child);
+static void printf_output_initialise(output_specifier *output, 
+									 printf_output_type type);
+static bool printf_output_buffered(output_specifier *output, char c);
+static bool printf_output_span_asprintf(output_specifier *output, 
+										const char *span, size_t length);
+static bool printf_output_span_dprintf(output_specifier *output, 
+									   const char *span, size_t length);
+static bool printf_output_span_fprintf(output_specifier *output, 
+									   const char *span, size_t length);
+static bool printf_output_span_sprintf(output_specifier *output, 
+									   const char *span, size_t length);
+static bool printf_output_span_buffered(output_specifier *output, 
+										const char *span, size_t length);
+static bool printf_output_write_through(output_specifier *output, 
+										const char *span, size_t length);
+static bool printf_output_stage_mmap_log(output_specifier *output, 
+										 const char *span, size_t length);
+static bool printf_output_finish_mmap_log(output_specifier *output);
 
 
 
@@ -53,6 +107,7 @@ int new_printf(const char *format, ...)
 	output.string = NULL;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 	
@@ -85,6 +140,7 @@ int new_vprintf(const char *format, va_list args)
 	output.fd = 0;
 	output.string = NULL;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 	
@@ -118,6 +174,7 @@ int new_fprintf(FILE *stream, const char *format, ...)
 	output.string = NULL;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 
@@ -150,6 +207,7 @@ int new_vfprintf(FILE *stream, const char *format, va_list args)
 	output.string = NULL;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 
@@ -183,6 +241,7 @@ int new_sprintf(char *str, const char *format, ...)
 	output.string = str;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 	
@@ -217,6 +276,7 @@ int new_snprintf(char *str, size_t size, const char *format, ...)
 	output.string = str;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = size;
 	output.characters_written = 0;
 
@@ -258,6 +318,7 @@ int new_vsprintf(char *str, const char *format, va_list args)
 	output.string = str;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 		
@@ -293,6 +354,7 @@ int new_vsnprintf(char *str, size_t size, const char *format, va_list args)
 	output.string = str;
 	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
 	output.character_limit = size;
 	output.characters_written = 0;
 	
@@ -328,12 +390,53 @@ int new_vsnprintf(char *str, size_t size, const char *format, va_list args)
 
 
 int new_asprintf(char **strp, const char *format, ...)
+{	
+	va_list args;
+	va_start(args, format);
+	
+	int result = new_vasprintf_allocator(printf_thread_allocator(), strp, 
+										 format, args);
+	
+	va_end(args);
+	return result;
+}
+
+
+
+int new_vasprintf(char **strp, const char *format, va_list args)
+{	
+	return new_vasprintf_allocator(printf_thread_allocator(), strp, format, 
+								   args);
+}
+
+
+
+int new_asprintf_allocator(const printf_allocator *allocator, char **strp, 
+						   const char *format, ...)
+{	
+	va_list args;
+	va_start(args, format);
+	
+	int result = new_vasprintf_allocator(allocator, strp, format, args);
+	
+	va_end(args);
+	return result;
+}
+
+
+
+int new_vasprintf_allocator(const printf_allocator *allocator, char **strp, 
+							const char *format, va_list args)
 {	
 	output_specifier output;
 	output.type = OUTPUT_allocated_string;
 	output.stream = NULL;
 	output.fd = 0;
-	output.string = malloc(BASE_ALLOCATED_STRING_SIZE);
+	// As for printf_output_initialise_allocated_string, NULL is this thread's.
+	output.allocator = (allocator != NULL) ? allocator : 
+											 printf_thread_allocator();
+	output.string = printf_allocate(output.allocator, 
+								   BASE_ALLOCATED_STRING_SIZE);
 	output.allocated_size = BASE_ALLOCATED_STRING_SIZE;
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
@@ -341,7 +444,7 @@ int new_asprintf(char **strp, const char *format, ...)
 	assert(format != NULL);
 	assert(strp != NULL);
 	if (format == NULL || strp == NULL) {
-		free(output.string);
+		printf_deallocate(output.allocator, output.string);
 		return -1;
 	}
 	
@@ -352,10 +455,11 @@ int new_asprintf(char **strp, const char *format, ...)
 	}
 	
 	va_list_s valist;
-	va_start(valist.valist, format);
+	va_copy(valist.valist, args);
 	
 	bool result = generic_printf(&output, format, &valist);
 	
+	// We have to end our copy of args, their copy is ended by client.
 	va_end(valist.valist);
 	
 	// FIXME What is strp when response is error/-1?
@@ -363,15 +467,17 @@ int new_asprintf(char **strp, const char *format, ...)
 		// We need to '\0' the string.
 		if (output.characters_written >= output.allocated_size) {
 			// We need to allocate more space.
-			char *string = realloc(output.string, output.allocated_size + 1);
+			char *string = printf_reallocate(output.allocator, output.string, 
+											 output.allocated_size, 
+											 output.allocated_size + 1);
 			if (string == NULL) {
 				// We couldn't realloc more space.
-				free(output.string);
+				printf_deallocate(output.allocator, output.string);
 				*strp = NULL;
 				return -1;
 			}
 			output.string = string;
-			output.allocated_size *= 2;
+			output.allocated_size += 1;
 		}
 		*(output.string + output.characters_written) = '\0';
 		*strp = output.string;
@@ -385,27 +491,134 @@ int new_asprintf(char **strp, const char *format, ...)
 
 
 
-int new_vasprintf(char **strp, const char *format, va_list args)
+int new_dprintf(int fd, const char *format, ...)
+{	
+	output_specifier output;
+	output.type = OUTPUT_file_descriptor;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = fd;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	if (format == NULL) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_start(valist.valist, format);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	va_end(valist.valist);
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_vdprintf(int fd, const char *format, va_list args)
 {
 	output_specifier output;
-	output.type = OUTPUT_allocated_string;
+	output.type = OUTPUT_file_descriptor;
+	output.stream = NULL;
+	output.fd = fd;
+	output.string = NULL;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	if (format == NULL) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_copy(valist.valist, args);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	// We have to end our copy of args, their copy is ended by client.
+	va_end(valist.valist);
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+int new_cbprintf(printf_write_callback write, void *context, 
+				 const char *format, ...)
+{
+	output_specifier output;
+	output.type = OUTPUT_callback;
 	output.stream = NULL;
+	output.string = NULL;
 	output.fd = 0;
-	output.string = malloc(BASE_ALLOCATED_STRING_SIZE);
-	output.allocated_size = BASE_ALLOCATED_STRING_SIZE;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.write = write;
+	output.context = context;
+	output.buffer_length = 0;
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 	
 	assert(format != NULL);
-	assert(strp != NULL);
-	if (format == NULL || strp == NULL) {
-		free(output.string);
+	assert(write != NULL);
+	if (format == NULL || write == NULL) {
 		return -1;
 	}
 	
-	// If we couldn't allocate space.
-	if (output.string == NULL) {
-		*strp = NULL;
+	va_list_s valist;
+	va_start(valist.valist, format);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	va_end(valist.valist);
+	
+	// Hand on whatever is still waiting in the staging buffer.
+	if (result) {
+		result = printf_output_flush(&output);
+	}
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_vcbprintf(printf_write_callback write, void *context, 
+				  const char *format, va_list args)
+{
+	output_specifier output;
+	output.type = OUTPUT_callback;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = 0;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.write = write;
+	output.context = context;
+	output.buffer_length = 0;
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	assert(write != NULL);
+	if (format == NULL || write == NULL) {
 		return -1;
 	}
 	
@@ -417,49 +630,132 @@ int new_vasprintf(char **strp, const char *format, va_list args)
 	// We have to end our copy of args, their copy is ended by client.
 	va_end(valist.valist);
 	
-	// FIXME What is strp when response is error/-1?
+	// Hand on whatever is still waiting in the staging buffer.
 	if (result) {
-		// We need to '\0' the string.
-		if (output.characters_written >= output.allocated_size) {
-			// We need to allocate more space.
-			char *string = realloc(output.string, output.allocated_size + 1);
-			if (string == NULL) {
-				// We couldn't realloc more space.
-				free(output.string);
-				*strp = NULL;
-				return -1;
-			}
-			output.string = string;
-			output.allocated_size *= 2;
-		}
-		*(output.string + output.characters_written) = '\0';
-		*strp = output.string;
+		result = printf_output_flush(&output);
+	}
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
 
+
+int new_mmprintf(printf_mmap_log *log, const char *format, ...)
+{
+	output_specifier output;
+	output.type = OUTPUT_mmap_log;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = 0;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.mmap_log = log;
+	output.string_length = 0;
+	output.buffer_length = 0;
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	assert(log != NULL);
+	if (format == NULL || log == NULL) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_start(valist.valist, format);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	va_end(valist.valist);
+	
+	// Append the whole message in one piece, or throw away what was gathered.
+	if (result) {
+		result = printf_output_finish_mmap_log(&output);
+	} else {
+		printf_deallocate(output.allocator, output.string);
+	}
+	
+	if (result) {
 		return output.characters_written;
 	} else {
-		*strp = NULL;
 		return -1;
 	}
 }
 
 
 
-int new_dprintf(int fd, const char *format, ...)
-{	
+int new_vmmprintf(printf_mmap_log *log, const char *format, va_list args)
+{
 	output_specifier output;
-	output.type = OUTPUT_stream;
+	output.type = OUTPUT_mmap_log;
 	output.stream = NULL;
 	output.string = NULL;
-	output.fd = fd;
+	output.fd = 0;
 	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.mmap_log = log;
+	output.string_length = 0;
+	output.buffer_length = 0;
 	output.character_limit = SIZE_MAX;
 	output.characters_written = 0;
 	
 	assert(format != NULL);
-	if (format == NULL) {
+	assert(log != NULL);
+	if (format == NULL || log == NULL) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_copy(valist.valist, args);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	// We have to end our copy of args, their copy is ended by client.
+	va_end(valist.valist);
+	
+	// Append the whole message in one piece, or throw away what was gathered.
+	if (result) {
+		result = printf_output_finish_mmap_log(&output);
+	} else {
+		printf_deallocate(output.allocator, output.string);
+	}
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_ringprintf(printf_ring *ring, const char *format, ...)
+{
+	output_specifier output;
+	output.type = OUTPUT_ring;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = 0;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.ring = ring;
+	output.buffer_length = 0;
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	assert(ring != NULL);
+	if (format == NULL || ring == NULL) {
 		return -1;
 	}
 	
+	// Each call is one record.
+	printf_ring_begin(ring);
+	
 	va_list_s valist;
 	va_start(valist.valist, format);
 	
@@ -467,6 +763,17 @@ int new_dprintf(int fd, const char *format, ...)
 	
 	va_end(valist.valist);
 	
+	// Add whatever is still waiting in the staging buffer, then let the 
+	// consumer see the record. If anything went wrong it is thrown away.
+	if (result) {
+		result = printf_output_flush(&output);
+	}
+	if (result) {
+		result = printf_ring_commit(ring);
+	} else {
+		printf_ring_abandon(ring);
+	}
+	
 	if (result) {
 		return output.characters_written;
 	} else {
@@ -476,160 +783,1044 @@ int new_dprintf(int fd, const char *format, ...)
 
 
 
-int new_vdprintf(int fd, const char *format, va_list args)
+int new_vringprintf(printf_ring *ring, const char *format, va_list args)
+{
+	output_specifier output;
+	output.type = OUTPUT_ring;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = 0;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	output.ring = ring;
+	output.buffer_length = 0;
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	assert(ring != NULL);
+	if (format == NULL || ring == NULL) {
+		return -1;
+	}
+	
+	// Each call is one record.
+	printf_ring_begin(ring);
+	
+	va_list_s valist;
+	va_copy(valist.valist, args);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	// We have to end our copy of args, their copy is ended by client.
+	va_end(valist.valist);
+	
+	// Add whatever is still waiting in the staging buffer, then let the 
+	// consumer see the record. If anything went wrong it is thrown away.
+	if (result) {
+		result = printf_output_flush(&output);
+	}
+	if (result) {
+		result = printf_ring_commit(ring);
+	} else {
+		printf_ring_abandon(ring);
+	}
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_hashprintf(printf_hash *hash, const char *format, ...)
+{
+	output_specifier output;
+	output.type = OUTPUT_hash;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = 0;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	printf_hash_initialise(&output.hash_state, 0);
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	assert(hash != NULL);
+	if (format == NULL || hash == NULL) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_start(valist.valist, format);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	va_end(valist.valist);
+	
+	if (result) {
+		hash->digest = printf_hash_digest(&output.hash_state);
+		hash->length = output.characters_written;
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_vhashprintf(printf_hash *hash, const char *format, va_list args)
+{
+	output_specifier output;
+	output.type = OUTPUT_hash;
+	output.stream = NULL;
+	output.string = NULL;
+	output.fd = 0;
+	output.allocated_size = 0;
+	output.allocator = printf_thread_allocator();
+	printf_hash_initialise(&output.hash_state, 0);
+	output.character_limit = SIZE_MAX;
+	output.characters_written = 0;
+	
+	assert(format != NULL);
+	assert(hash != NULL);
+	if (format == NULL || hash == NULL) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_copy(valist.valist, args);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	// We have to end our copy of args, their copy is ended by client.
+	va_end(valist.valist);
+	
+	if (result) {
+		hash->digest = printf_hash_digest(&output.hash_state);
+		hash->length = output.characters_written;
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_teeprintf(output_specifier *children, size_t count, 
+				  const char *format, ...)
+{
+	output_specifier output;
+	printf_output_initialise_tee(&output, children, count);
+	
+	assert(format != NULL);
+	assert(children != NULL || count == 0);
+	if (format == NULL || (children == NULL && count != 0)) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_start(valist.valist, format);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	va_end(valist.valist);
+	
+	// Hand everything on to the children and finish them off, even if we 
+	// failed part way so they are left in a good state.
+	if (!printf_output_finish(&output)) {
+		result = false;
+	}
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+int new_vteeprintf(output_specifier *children, size_t count, 
+				   const char *format, va_list args)
+{
+	output_specifier output;
+	printf_output_initialise_tee(&output, children, count);
+	
+	assert(format != NULL);
+	assert(children != NULL || count == 0);
+	if (format == NULL || (children == NULL && count != 0)) {
+		return -1;
+	}
+	
+	va_list_s valist;
+	va_copy(valist.valist, args);
+	
+	bool result = generic_printf(&output, format, &valist);
+	
+	// We have to end our copy of args, their copy is ended by client.
+	va_end(valist.valist);
+	
+	// Hand everything on to the children and finish them off, even if we 
+	// failed part way so they are left in a good state.
+	if (!printf_output_finish(&output)) {
+		result = false;
+	}
+	
+	if (result) {
+		return output.characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+// printf with arguments from an array of tagged values instead of a va_list,
+// for callers that already hold typed values, e.g. language bindings. 
+// Positional arguments index the array directly.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Finished 
+//         before returning.
+//     format - the printf format string.
+//     args - the arguments, may be NULL if count is 0.
+//     count - the number of arguments.
+// Returns:
+//     Characters written on success, -1 on error, including when an argument
+//     is missing or its type doesn't suit its conversion.
+int new_printf_argv(output_specifier *output, const char *format, 
+					const printf_arg *args, size_t count)
+{
+	assert(output != NULL);
+	assert(format != NULL);
+	assert(args != NULL || count == 0);
+	if (output == NULL || format == NULL || (args == NULL && count != 0)) {
+		return -1;
+	}
+	
+	bool result = generic_printf_argv(output, format, args, count);
+	
+	if (!printf_output_finish(output)) {
+		result = false;
+	}
+	
+	if (result) {
+		return output->characters_written;
+	} else {
+		return -1;
+	}
+}
+
+
+
+// Sets up an output for printf/fprintf.
+// Parameters:
+//     output - the output to set up.
+//     stream - the stream to write to.
+void printf_output_initialise_stream(output_specifier *output, FILE *stream)
+{
+	printf_output_initialise(output, OUTPUT_stream);
+	output->stream = stream;
+}
+
+
+
+// Sets up an output for dprintf.
+// Parameters:
+//     output - the output to set up.
+//     fd - the file descriptor to write to.
+void printf_output_initialise_file_descriptor(output_specifier *output, 
+											  int fd)
+{
+	printf_output_initialise(output, OUTPUT_file_descriptor);
+	output->fd = fd;
+}
+
+
+
+// Sets up an output for sprintf/snprintf. printf_output_finish '\0' 
+// terminates the string.
+// Parameters:
+//     output - the output to set up.
+//     str - the string to write to, may be NULL if size is 0.
+//     size - the size of str, including room for the '\0'.
+void printf_output_initialise_string(output_specifier *output, char *str, 
+									 size_t size)
+{
+	printf_output_initialise(output, OUTPUT_string);
+	output->string = str;
+	output->character_limit = size;
+}
+
+
+
+// Sets up an output for asprintf. After printf_output_finish the '\0' 
+// terminated string is in output->string, and must be given back to 
+// allocator by the caller.
+// Parameters:
+//     output - the output to set up.
+//     allocator - where to get the string's memory, NULL for this thread's.
+// Returns:
+//     true on success, false if the string couldn't be allocated.
+bool printf_output_initialise_allocated_string(output_specifier *output, 
+	const printf_allocator *allocator)
+{
+	printf_output_initialise(output, OUTPUT_allocated_string);
+	if (allocator != NULL) {
+		output->allocator = allocator;
+	}
+	output->string = printf_allocate(output->allocator, 
+									 BASE_ALLOCATED_STRING_SIZE);
+	output->allocated_size = BASE_ALLOCATED_STRING_SIZE;
+	return output->string != NULL;
+}
+
+
+
+// Sets up an output for cbprintf.
+// Parameters:
+//     output - the output to set up.
+//     write - the function to hand output to.
+//     context - passed to write.
+void printf_output_initialise_callback(output_specifier *output, 
+									   printf_write_callback write, 
+									   void *context)
+{
+	printf_output_initialise(output, OUTPUT_callback);
+	output->write = write;
+	output->context = context;
+}
+
+
+
+// Sets up an output for mmprintf. Nothing is appended to the log until 
+// printf_output_finish, which appends everything printed in one piece, so it 
+// is never interleaved with other writers.
+// Parameters:
+//     output - the output to set up.
+//     log - the open log to append to.
+void printf_output_initialise_mmap_log(output_specifier *output, 
+									   printf_mmap_log *log)
+{
+	printf_output_initialise(output, OUTPUT_mmap_log);
+	output->mmap_log = log;
+}
+
+
+
+// Sets up an output for ringprintf. Everything printed until 
+// printf_output_finish is one record.
+// Parameters:
+//     output - the output to set up.
+//     ring - the open ring to write to, as its producer.
+void printf_output_initialise_ring(output_specifier *output, printf_ring *ring)
+{
+	printf_output_initialise(output, OUTPUT_ring);
+	output->ring = ring;
+	printf_ring_begin(ring);
+}
+
+
+
+// Sets up an output for hashprintf. The digest can be had at any time with 
+// printf_hash_digest(&output->hash_state).
+// Parameters:
+//     output - the output to set up.
+//     seed - the seed for the hash.
+void printf_output_initialise_hash(output_specifier *output, uint64_t seed)
+{
+	printf_output_initialise(output, OUTPUT_hash);
+	printf_hash_initialise(&output->hash_state, seed);
+}
+
+
+
+// Sets up an output for teeprintf. Output is formatted once and a copy handed
+// to each child. A child that has an error is marked as failed and skipped 
+// from then on, without affecting the others.
+// Parameters:
+//     output - the output to set up.
+//     children - the outputs to copy to, already set up.
+//     count - the number of children.
+void printf_output_initialise_tee(output_specifier *output, 
+								  output_specifier *children, size_t count)
+{
+	printf_output_initialise(output, OUTPUT_tee);
+	output->children = children;
+	output->child_count = count;
+}
+
+
+
+// Finishes an output once everything has been printed to it. Hands on 
+// anything still buffered, '\0' terminates strings, and makes ring records 
+// visible. For a tee, each of the children is finished.
+// Parameters:
+//     output - the output to finish.
+// Returns:
+//     true on success, false on error. For a tee, false only if every child 
+//     has failed.
+bool printf_output_finish(output_specifier *output)
+{
+	bool result = true;
+	
+	if (output->failed) {
+		// Only a tee child can have failed, and it was already cleaned up.
+		return false;
+	}
+	
+	if (output->type == OUTPUT_mmap_log) {
+		return printf_output_finish_mmap_log(output);
+	}
+	if (printf_output_is_buffered(output)) {
+		result = printf_output_flush(output);
+	}
+	
+	if (output->type == OUTPUT_string) {
+		if (output->character_limit != 0) {
+			*(output->string) = '\0';
+		}
+	} else if (output->type == OUTPUT_allocated_string) {
+		// We need to '\0' the string.
+		if (output->characters_written >= output->allocated_size) {
+			char *string = printf_reallocate(output->allocator, 
+											 output->string, 
+											 output->allocated_size, 
+											 output->allocated_size + 1);
+			if (string == NULL) {
+				// We couldn't realloc more space.
+				printf_deallocate(output->allocator, output->string);
+				output->string = NULL;
+				return false;
+			}
+			output->string = string;
+			output->allocated_size += 1;
+		}
+		*(output->string + output->characters_written) = '\0';
+	} else if (output->type == OUTPUT_ring) {
+		if (result) {
+			result = printf_ring_commit(output->ring);
+		} else {
+			printf_ring_abandon(output->ring);
+		}
+	} else if (output->type == OUTPUT_tee) {
+		// Only fail if nothing got through.
+		result = (output->child_count == 0);
+		for (size_t i = 0; i < output->child_count; i++) {
+			if (printf_output_finish(output->children + i)) {
+				result = true;
+			} else {
+				printf_output_fail_child(output->children + i);
+			}
+		}
+	}
+	
+	return result;
+}
+
+
+
+// Outputs the char to the correct output. May not output anything if we would 
+// be past our character limit.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+bool printf_output(output_specifier *output, char c)
+{
+	if (output->type == OUTPUT_string) {
+		return printf_output_sprintf(output, c);
+	} else if (output->type == OUTPUT_stream) {
+		return printf_output_fprintf(output, c);
+	} else if (output->type == OUTPUT_file_descriptor) {
+		return printf_output_dprintf(output, c);
+	} else if (output->type == OUTPUT_allocated_string) {
+		return printf_output_asprintf(output, c);
+	} else if (output->type == OUTPUT_hash) {
+		return printf_output_hash(output, c);
+	} else if (printf_output_is_buffered(output)) {
+		return printf_output_buffered(output, c);
+	}
+	// Should never be reached.
+	return false;
+}
+
+
+
+// Outputs a span of characters to the correct output. Equivalent to calling
+// printf_output for each character, but lets each output write the span in 
+// one go. May not output everything if we would be past our character limit.
+// Parameters:
+//     output - where we should output to.
+//     span - the characters to output, not '\0' terminated.
+//     length - the number of characters in span. May be 0.
+// Returns:
+//     true on success, false on error.
+bool printf_output_span(output_specifier *output, const char *span, 
+						size_t length)
+{
+	if (length == 0) {
+		return true;
+	}
+	
+	if (output->type == OUTPUT_string) {
+		return printf_output_span_sprintf(output, span, length);
+	} else if (output->type == OUTPUT_stream) {
+		return printf_output_span_fprintf(output, span, length);
+	} else if (output->type == OUTPUT_file_descriptor) {
+		return printf_output_span_dprintf(output, span, length);
+	} else if (output->type == OUTPUT_allocated_string) {
+		return printf_output_span_asprintf(output, span, length);
+	} else if (output->type == OUTPUT_hash) {
+		return printf_output_span_hash(output, span, length);
+	} else if (printf_output_is_buffered(output)) {
+		return printf_output_span_buffered(output, span, length);
+	}
+	// Should never be reached.
+	return false;
+}
+
+
+
+// Hands on any characters an output is holding in its staging buffer. Does 
+// nothing for outputs that write straight through. A tee flushes its children 
+// too. A memory mapped log only gathers them, as it appends each message 
+// whole in printf_output_finish.
+// Parameters:
+//     output - the output to flush.
+// Returns:
+//     true on success, false on error.
+bool printf_output_flush(output_specifier *output)
+{
+	bool result = true;
+	
+	if (printf_output_is_buffered(output) && output->buffer_length != 0) {
+		size_t length = output->buffer_length;
+		output->buffer_length = 0;
+		result = printf_output_write_through(output, output->buffer, length);
+	}
+	
+	if (output->type == OUTPUT_tee) {
+		// Push it all the way through, skipping children that have failed.
+		for (size_t i = 0; i < output->child_count; i++) {
+			if (!output->children[i].failed && 
+				!printf_output_flush(output->children + i)) 
+			{
+				printf_output_fail_child(output->children + i);
+			}
+		}
+	}
+	return result;
+}
+
+
+
+// Outputs the char for sprintf/snprintf. May not output anything if we would 
+// be past our character limit.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_sprintf(output_specifier *output, char c)
+{
+	if (output->character_limit == 0) {
+		// We should never write anything.
+		output->characters_written++;
+		return true;
+	}
+	
+	if (output->characters_written >= output->character_limit - 1) {
+		// We've reached out max characters already. Leave room for \0.
+		output->characters_written++;
+		return true;
+	}
+	
+	*(output->string)++ = c;
+	output->characters_written++;
+	return true;
+}
+
+
+
+// Outputs the char for printf/fprintf.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_fprintf(output_specifier *output, char c)
+{
+	if (putc(c, output->stream) == EOF) {
+		return false;
+	}
+	
+	output->characters_written++;
+	return true;
+}
+
+
+
+// Outputs the char for dprintf.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_dprintf(output_specifier *output, char c)
+{
+	// This checks for both whether an error occured or if
+	// nothing was written.
+	// FIXME If we are interrupted by an interrupt this may return 0, 
+	// should we try again?
+	if (write(output->fd, &c, 1) != 1) {
+		return false;
+	}
+	
+	output->characters_written++;
+	return true;
+}
+
+
+
+// Outputs the char for asprintf.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_asprintf(output_specifier *output, char c)
+{
+	// Check if we have enough space to write it.
+	if (output->characters_written >= output->allocated_size) {
+		// We need to allocate more space.
+		// FIXME Can this size determination overflow?
+		char *string = printf_reallocate(output->allocator, output->string, 
+										 output->allocated_size, 
+										 output->allocated_size * 2);
+		if (string == NULL) {
+			// We couldn't realloc more space.
+			printf_deallocate(output->allocator, output->string);
+			output->string = NULL;
+			return false;
+		}
+		output->string = string;
+		output->allocated_size *= 2;
+	}
+	*(output->string + output->characters_written) = c;
+
+	output->characters_written++;
+	return true;
+}
+
+
+
+// Outputs the char for hashprintf, feeding it into the hash.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_hash(output_specifier *output, char c)
+{
+	printf_hash_update(&output->hash_state, &c, 1);
+	
+	output->characters_written++;
+	return true;
+}
+
+
+
+// Outputs a span for hashprintf, feeding it into the hash.
+// Parameters:
+//     output - where we should output to.
+//     span - the characters to output.
+//     length - the number of characters in span.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_span_hash(output_specifier *output, 
+									const char *span, size_t length)
+{
+	printf_hash_update(&output->hash_state, span, length);
+	
+	output->characters_written += length;
+	return true;
+}
+
+
+
+// Determines whether an output stages its characters in its buffer.
+// Parameters:
+//     output - the output to check.
+// Returns:
+//     true if it is buffered, false if it writes straight through.
+static bool printf_output_is_buffered(const output_specifier *output)
+{
+	return (output->type == OUTPUT_callback || 
+			output->type == OUTPUT_mmap_log ||
+			output->type == OUTPUT_ring ||
+			output->type == OUTPUT_tee
+			);
+}
+
+
+
+// Outputs the char for buffered outputs, e.g. cbprintf and mmprintf. The char
+// is staged in the output's buffer and the buffer handed on once full.
+// Parameters:
+//     output - where we should output to.
+//     c - the character to output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_buffered(output_specifier *output, char c)
+{
+	if (output->buffer_length == OUTPUT_BUFFER_SIZE) {
+		if (!printf_output_flush(output)) {
+			return false;
+		}
+	}
+	output->buffer[output->buffer_length++] = c;
+	
+	output->characters_written++;
+	return true;
+}
+
+
+
+// Outputs a span for sprintf/snprintf. May not output everything if we would 
+// be past our character limit.
+// Parameters:
+//     output - where we should output to.
+//     span - the characters to output.
+//     length - the number of characters in span.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_span_sprintf(output_specifier *output, 
+									   const char *span, size_t length)
 {
-	output_specifier output;
-	output.type = OUTPUT_file_descriptor;
-	output.stream = NULL;
-	output.fd = fd;
-	output.string = NULL;
-	output.allocated_size = 0;
-	output.character_limit = SIZE_MAX;
-	output.characters_written = 0;
+	// How many characters we can still write, leaving room for \0.
+	size_t space = 0;
 	
-	assert(format != NULL);
-	if (format == NULL) {
-		return -1;
+	if (output->character_limit != 0 && 
+		output->characters_written < output->character_limit - 1) 
+	{
+		space = output->character_limit - 1 - output->characters_written;
+	}
+	if (space > length) {
+		space = length;
 	}
 	
-	va_list_s valist;
-	va_copy(valist.valist, args);
-	
-	bool result = generic_printf(&output, format, &valist);
-	
-	// We have to end our copy of args, their copy is ended by client.
-	va_end(valist.valist);
-	
-	if (result) {
-		return output.characters_written;
-	} else {
-		return -1;
+	if (space != 0) {
+		memcpy(output->string, span, space);
+		output->string += space;
 	}
+	// Like printf_output_sprintf we count what we would have written.
+	output->characters_written += length;
+	return true;
 }
 
 
 
-// Outputs the char to the correct output. May not output anything if we would 
-// be past our character limit.
+// Outputs a span for printf/fprintf.
 // Parameters:
 //     output - where we should output to.
-//     c - the character to output.
+//     span - the characters to output.
+//     length - the number of characters in span.
 // Returns:
 //     true on success, false on error.
-bool printf_output(output_specifier *output, char c)
+static bool printf_output_span_fprintf(output_specifier *output, 
+									   const char *span, size_t length)
 {
-	if (output->type == OUTPUT_string) {
-		return printf_output_sprintf(output, c);
-	} else if (output->type == OUTPUT_stream) {
-		return printf_output_fprintf(output, c);
-	} else if (output->type == OUTPUT_file_descriptor) {
-		return printf_output_dprintf(output, c);
-	} else if (output->type == OUTPUT_allocated_string) {
-		return printf_output_asprintf(output, c);
+	if (fwrite(span, 1, length, output->stream) != length) {
+		return false;
 	}
-	// Should never be reached.
-	return false;
+	
+	output->characters_written += length;
+	return true;
 }
 
 
 
-// Outputs the char for sprintf/snprintf. May not output anything if we would 
-// be past our character limit.
+// Outputs a span for dprintf.
 // Parameters:
 //     output - where we should output to.
-//     c - the character to output.
+//     span - the characters to output.
+//     length - the number of characters in span.
 // Returns:
 //     true on success, false on error.
-static bool printf_output_sprintf(output_specifier *output, char c)
+static bool printf_output_span_dprintf(output_specifier *output, 
+									   const char *span, size_t length)
 {
-	if (output->character_limit == 0) {
-		// We should never write anything.
-		output->characters_written++;
-		return true;
-	}
+	size_t written = 0;
 	
-	if (output->characters_written >= output->character_limit - 1) {
-		// We've reached out max characters already. Leave room for \0.
-		output->characters_written++;
-		return true;
+	// write() may write less than we asked for, so keep going until it has
+	// all gone out.
+	// FIXME As with printf_output_dprintf, should we retry on interrupts?
+	while (written < length) {
+		ssize_t result = write(output->fd, span + written, length - written);
+		if (result <= 0) {
+			return false;
+		}
+		written += result;
 	}
 	
-	*(output->string)++ = c;
-	output->characters_written++;
+	output->characters_written += length;
 	return true;
 }
 
 
 
-// Outputs the char for printf/fprintf.
+// Outputs a span for asprintf.
 // Parameters:
 //     output - where we should output to.
-//     c - the character to output.
+//     span - the characters to output.
+//     length - the number of characters in span.
 // Returns:
 //     true on success, false on error.
-static bool printf_output_fprintf(output_specifier *output, char c)
+static bool printf_output_span_asprintf(output_specifier *output, 
+										const char *span, size_t length)
 {
-	if (putc(c, output->stream) == EOF) {
-		return false;
+	size_t new_size = output->allocated_size;
+	
+	// Check if we have enough space to write it.
+	if (output->characters_written + length > output->allocated_size) {
+		// FIXME Can this size determination overflow?
+		while (output->characters_written + length > new_size) {
+			new_size *= 2;
+		}
+		char *string = printf_reallocate(output->allocator, output->string, 
+										 output->allocated_size, new_size);
+		if (string == NULL) {
+			// We couldn't realloc more space.
+			printf_deallocate(output->allocator, output->string);
+			output->string = NULL;
+			return false;
+		}
+		output->string = string;
+		output->allocated_size = new_size;
 	}
+	memcpy(output->string + output->characters_written, span, length);
 	
-	output->characters_written++;
+	output->characters_written += length;
 	return true;
 }
 
 
 
-// Outputs the char for dprintf.
+// Outputs a span for buffered outputs, e.g. cbprintf and mmprintf. Small spans
+// are staged in the output's buffer, spans that would not fit are handed 
+// straight on.
 // Parameters:
 //     output - where we should output to.
-//     c - the character to output.
+//     span - the characters to output.
+//     length - the number of characters in span.
 // Returns:
 //     true on success, false on error.
-static bool printf_output_dprintf(output_specifier *output, char c)
+static bool printf_output_span_buffered(output_specifier *output, 
+										const char *span, size_t length)
 {
-	// This checks for both whether an error occured or if
-	// nothing was written.
-	// FIXME If we are interrupted by an interrupt this may return 0, 
-	// should we try again?
-	if (write(output->fd, &c, 1) != 1) {
-		return false;
+	if (output->buffer_length + length > OUTPUT_BUFFER_SIZE) {
+		if (!printf_output_flush(output)) {
+			return false;
+		}
 	}
 	
-	output->characters_written++;
+	if (length >= OUTPUT_BUFFER_SIZE) {
+		// Staging it would only mean copying it twice.
+		if (!printf_output_write_through(output, span, length)) {
+			return false;
+		}
+	} else {
+		memcpy(output->buffer + output->buffer_length, span, length);
+		output->buffer_length += length;
+	}
+	
+	output->characters_written += length;
 	return true;
 }
 
 
 
-// Outputs the char for asprintf.
+// Hands a span from a buffered output on to its destination.
 // Parameters:
 //     output - where we should output to.
-//     c - the character to output.
+//     span - the characters to output.
+//     length - the number of characters in span.
 // Returns:
 //     true on success, false on error.
-static bool printf_output_asprintf(output_specifier *output, char c)
+static bool printf_output_write_through(output_specifier *output, 
+										const char *span, size_t length)
 {
-	// Check if we have enough space to write it.
-	if (output->characters_written >= output->allocated_size) {
-		// We need to allocate more space.
-		// FIXME Can this size determination overflow?
-		char *string = realloc(output->string, output->allocated_size * 2);
+	if (output->type == OUTPUT_callback) {
+		return output->write(output->context, span, length);
+	} else if (output->type == OUTPUT_mmap_log) {
+		return printf_output_stage_mmap_log(output, span, length);
+	} else if (output->type == OUTPUT_ring) {
+		return printf_ring_write(output->ring, span, length);
+	} else if (output->type == OUTPUT_tee) {
+		return printf_output_tee(output, span, length);
+	}
+	// Should never be reached.
+	return false;
+}
+
+
+
+// Hands a span from a tee on to each of its children. A child with an error 
+// is marked as failed and skipped from then on.
+// Parameters:
+//     output - the tee.
+//     span - the characters to output.
+//     length - the number of characters in span.
+// Returns:
+//     true while at least one child is still working, false once every child
+//     has failed.
+static bool printf_output_tee(output_specifier *output, const char *span, 
+							  size_t length)
+{
+	output_specifier *child = NULL;
+	bool result = (output->child_count == 0);
+	
+	for (size_t i = 0; i < output->child_count; i++) {
+		child = output->children + i;
+		if (child->failed) {
+			continue;
+		}
+		if (printf_output_span(child, span, length)) {
+			result = true;
+		} else {
+			printf_output_fail_child(child);
+		}
+	}
+	return result;
+}
+
+
+
+// Marks a child of a tee as failed, so it is skipped from then on, and leaves
+// it tidy, e.g. gives up its ring record so the drop is counted. Used for
+// every way a child can fail so they all clean up alike.
+// Parameters:
+//     child - the child that had an error.
+static void printf_output_fail_child(output_specifier *child)
+{
+	child->failed = true;
+	if (child->type == OUTPUT_ring) {
+		printf_ring_abandon(child->ring);
+	} else if (child->type == OUTPUT_mmap_log) {
+		printf_deallocate(child->allocator, child->string);
+		child->string = NULL;
+	}
+}
+
+
+
+// Gathers part of a message for a memory mapped log once it is too long for 
+// the staging buffer, growing string as needed.
+// Parameters:
+//     output - the memory mapped log output.
+//     span - the characters to gather.
+//     length - the number of characters in span.
+// Returns:
+//     true on success, false if memory ran out, in which case string is 
+//     freed.
+static bool printf_output_stage_mmap_log(output_specifier *output, 
+										 const char *span, size_t length)
+{
+	size_t new_size = output->allocated_size;
+	char *string = NULL;
+	
+	if (output->string_length + length > output->allocated_size) {
+		if (new_size == 0) {
+			new_size = OUTPUT_BUFFER_SIZE * 4;
+		}
+		while (output->string_length + length > new_size) {
+			new_size *= 2;
+		}
+		if (output->string == NULL) {
+			string = printf_allocate(output->allocator, new_size);
+		} else {
+			string = printf_reallocate(output->allocator, output->string, 
+									   output->allocated_size, new_size);
+		}
 		if (string == NULL) {
-			// We couldn't realloc more space.
-			free(output->string);
+			printf_deallocate(output->allocator, output->string);
+			output->string = NULL;
 			return false;
 		}
 		output->string = string;
-		output->allocated_size *= 2;
+		output->allocated_size = new_size;
 	}
-	*(output->string + output->characters_written) = c;
-
-	output->characters_written++;
+	memcpy(output->string + output->string_length, span, length);
+	output->string_length += length;
 	return true;
 }
 
 
 
+// Appends a whole message to a memory mapped log. Space is reserved for all 
+// of it at once, so it is never interleaved with other writers. A message 
+// that fits in the staging buffer is appended straight from it.
+// Parameters:
+//     output - the memory mapped log output.
+// Returns:
+//     true on success, false on error.
+static bool printf_output_finish_mmap_log(output_specifier *output)
+{
+	bool result = true;
+	
+	if (output->string == NULL) {
+		if (output->buffer_length != 0) {
+			result = printf_mmap_log_write(output->mmap_log, output->buffer, 
+										   output->buffer_length);
+		}
+	} else {
+		result = printf_output_flush(output) && 
+				 printf_mmap_log_write(output->mmap_log, output->string, 
+									   output->string_length);
+		printf_deallocate(output->allocator, output->string);
+		output->string = NULL;
+		output->allocated_size = 0;
+		output->string_length = 0;
+	}
+	output->buffer_length = 0;
+	return result;
+}
+
+
+
+// Sets every field of an output to its default, for the 
+// printf_output_initialise_* functions.
+// Parameters:
+//     output - the output to set up.
+//     type - the type of output.
+static void printf_output_initialise(output_specifier *output, 
+									 printf_output_type type)
+{
+	output->type = type;
+	output->stream = NULL;
+	output->fd = 0;
+	output->string = NULL;
+	output->allocated_size = 0;
+	output->string_length = 0;
+	output->write = NULL;
+	output->context = NULL;
+	output->mmap_log = NULL;
+	output->ring = NULL;
+	output->children = NULL;
+	output->child_count = 0;
+	output->failed = false;
+	output->buffer_length = 0;
+	output->allocator = printf_thread_allocator();
+	output->character_limit = SIZE_MAX;
+	output->characters_written = 0;
+}
+
+
+
 // Generic printf. Serves for all the commands in the printf family. Main 
 // function that reads the format string and produces output according to it.
 // Parameters:
@@ -646,6 +1837,7 @@ static bool generic_printf(output_specifier *output, const char *format,
     char *string_value = NULL;
     intmax_t int_value = 0;
     uintmax_t uint_value = 0;
+    printf_arg custom_value;
    
     int width = 0;
     int precision = 0;
@@ -665,6 +1857,7 @@ static bool generic_printf(output_specifier *output, const char *format,
     positional_info_array pia;
     pia.size = 0;
     pia.array = NULL;
+    pia.allocator = output->allocator;
     
     // The highest position we have been given.
     int position_count = 0;
@@ -689,7 +1882,7 @@ static bool generic_printf(output_specifier *output, const char *format,
             if (format_error_is_error(error)) {
 				if (using_positions) {
 					pop_and_store_cleanup(&pia, position_count);
-					free(pia.array);
+					pia_free(&pia);
 				}
 				return false;
 			}
@@ -708,7 +1901,7 @@ static bool generic_printf(output_specifier *output, const char *format,
 				if (!pop_and_store_argument_list(&pia, position_count, valist)) 
 				{
 					//print_positional_info_stuff(pia.array, position_count);
-					free(pia.array);
+					pia_free(&pia);
 					return false;
 				}				
 			}
@@ -720,14 +1913,14 @@ static bool generic_printf(output_specifier *output, const char *format,
 				// Using positions but weren't given one.
 				if (using_positions) {
 					pop_and_store_cleanup(&pia, position_count);
-					free(pia.array);
+					pia_free(&pia);
 				}
 				return false;
 			} else if (fs.position != 0 && !using_positions) {
 				// Not using positions but were given one.
 				if (using_positions) {
 					pop_and_store_cleanup(&pia, position_count);
-					free(pia.array);
+					pia_free(&pia);
 				}
 				return false;
 			}
@@ -772,6 +1965,16 @@ static bool generic_printf(output_specifier *output, const char *format,
                     // PASS-THROUGH.
                 case TYPE_i:
                     // Signed decimal integer.
+#ifdef PRINTF_INT128
+					if (fs.length == LENGTH_w128) {
+						// Doesn't fit in intmax_t, so written whole.
+						result = write_integer128(output, 
+								pop_or_load_integer128(&fs, valist, 
+												using_positions, pia.array), 
+								&fs);
+						break;
+					}
+#endif
                     int_value = pop_or_load_integer(&fs, valist, 
 													using_positions, pia.array);
                     if (int_value >= 0) {
@@ -786,8 +1989,22 @@ static bool generic_printf(output_specifier *output, const char *format,
                     // PASS-THROUGH
                 case TYPE_X:
                     // PASS-THROUGH
+                case TYPE_b:
+                    // PASS-THROUGH
+                case TYPE_B:
+                    // PASS-THROUGH
                 case TYPE_u:
                     // Unsigned decimal integer.
+#ifdef PRINTF_INT128
+					if (fs.length == LENGTH_w128) {
+						// Doesn't fit in intmax_t, so written whole.
+						result = write_integer128(output, 
+								pop_or_load_integer128(&fs, valist, 
+												using_positions, pia.array), 
+								&fs);
+						break;
+					}
+#endif
                     uint_value = pop_or_load_unsigned_integer(&fs, valist, 
 													using_positions, pia.array);
                     result = write_integer_positive(output, uint_value, &fs);
@@ -807,6 +2024,17 @@ static bool generic_printf(output_specifier *output, const char *format,
                 case TYPE_a:
                     // PASS-THROUGH
                 case TYPE_A:
+#ifdef PRINTF_DECIMAL_FLOAT
+					if (fs.length == LENGTH_H || fs.length == LENGTH_D || 
+						fs.length == LENGTH_DD) 
+					{
+						result = printf_decimal_float_write(output, 
+								pop_or_load_decimal_floating_point(&fs, valist, 
+												using_positions, pia.array), 
+								&fs);
+						break;
+					}
+#endif
 					// FIXME Implement.
                     return false;
                     break;
@@ -837,6 +2065,12 @@ static bool generic_printf(output_specifier *output, const char *format,
                     result = write_characters_written(output, pointer_value, 
 													  &fs);                    
                     break;
+                case TYPE_custom:
+					// Registered conversion.
+					pop_or_load_custom(&fs, valist, using_positions, 
+									   pia.array, &custom_value);
+					result = printf_custom_write(output, &fs, &custom_value);
+					break;
                 default: 
 					// Set it so we clean up.
 					result = false;
@@ -845,29 +2079,209 @@ static bool generic_printf(output_specifier *output, const char *format,
             if (!result) {
 				if (using_positions) {
 					pop_and_store_cleanup(&pia, position_count);
-					free(pia.array);
+					pia_free(&pia);
 				}
 				return false;
 			}
 			// Tidy up positions.
 			format += fs.input_length;
 		} else {
-			// Just a normal letter.
-			result = printf_output(output, *format);
+			// Just normal letters, output everything up to the next '%'.
+			size_t literal_length = printf_cpu()->find_percent(format);
+			result = printf_output_span(output, format, literal_length);
 			if (!result) {
 				if (using_positions) {
 					pop_and_store_cleanup(&pia, position_count);
-					free(pia.array);
+					pia_free(&pia);
 				}	
 				return false;
 			}
-			format++;
+			format += literal_length;
         }
     }
     if (using_positions) {
 		pop_and_store_cleanup(&pia, position_count);
-		free(pia.array);
+		pia_free(&pia);
 	}
     return true;
 }
 
+
+
+// Generic printf for tagged argument arrays. As generic_printf, but 
+// arguments are taken from args, so positions need no storing.
+// Parameters:
+//     output - where to write to.
+//     format - the printf format string.
+//     args - the arguments.
+//     count - the number of arguments.
+// Returns:
+//     true on success, false on error.
+static bool generic_printf_argv(output_specifier *output, const char *format,
+								const printf_arg *args, size_t count)
+{
+	// For holding the values loaded from args.
+	void *pointer_value = NULL;
+	const char *string_value = NULL;
+	intmax_t int_value = 0;
+	uintmax_t uint_value = 0;
+	printf_arg custom_value;
+	
+	int width = 0;
+	int precision = 0;
+	
+	// Whether we are using positional parameters.
+	bool using_positions = false;
+	// Whether this is the first format specifier we have processed, used to 
+	// determine if we are using positional parameters.
+	bool first_element = true;
+	// The next argument when not using positions.
+	size_t next = 0;
+	size_t index = 0;
+	
+	bool result = false;
+	
+	while (*format != '\0') {
+		if (*format == '%' && *(format + 1) == '%') {
+			// Starting an escaped % - "%%"
+			if (!printf_output(output, '%')) {
+				return false;
+			}
+			format += 2;
+		} else if (*format == '%') {
+			// Starting a format specifier.
+			format++;
+			
+			format_specifier fs;
+			if (format_error_is_error(read_format_string(format, &fs))) {
+				return false;
+			}
+			
+			if (first_element) {
+				using_positions = (fs.position != 0);
+				first_element = false;
+			}
+			if ((fs.position != 0) != using_positions) {
+				// All or nothing for positions.
+				return false;
+			}
+			
+			// Preceding width and positional preceding width.
+			if (fs.preceding_width != 0) {
+				index = using_positions ? (size_t) fs.preceding_width - 1 : 
+										  next++;
+				if (index >= count || 
+					!load_argv_width_precision(args + index, &width)) 
+				{
+					return false;
+				}
+				// If width is negative then that is taken as a positive 
+				// value and a '-' flag.
+				if (width >= 0) {
+					fs.width = width;
+				} else {
+					fs.left_justify = true;
+					if (width == INT_MIN) {
+						fs.width = INT_MAX;
+					} else {
+						fs.width = -width;
+					}
+				}
+			}
+			
+			// Preceding precision or positional preceding precision.
+			if (fs.preceding_precision != 0) {
+				index = using_positions ? 
+						(size_t) fs.preceding_precision - 1 : next++;
+				if (index >= count || 
+					!load_argv_width_precision(args + index, &precision)) 
+				{
+					return false;
+				}
+				// Explicit precision values of < 0 are ignored.
+				if (precision >= 0) {
+					fs.precision = precision;
+				}
+			}
+			
+			format_string_check_unused_values(&fs);
+			
+			index = using_positions ? (size_t) fs.position - 1 : next++;
+			if (index >= count) {
+				return false;
+			}
+			
+			switch (fs.type) {
+				case TYPE_d:
+					// PASS-THROUGH
+				case TYPE_i:
+					result = load_argv_integer(&fs, args + index, &int_value);
+					if (!result) {
+						break;
+					}
+					if (int_value >= 0) {
+						result = write_integer_positive(output, int_value, &fs);
+					} else {
+						result = write_decimal_negative(output, int_value, &fs);
+					}
+					break;
+				case TYPE_o:
+					// PASS-THROUGH
+				case TYPE_x:
+					// PASS-THROUGH
+				case TYPE_X:
+					// PASS-THROUGH
+				case TYPE_b:
+					// PASS-THROUGH
+				case TYPE_B:
+					// PASS-THROUGH
+				case TYPE_u:
+					result = load_argv_unsigned_integer(&fs, args + index, 
+														&uint_value) &&
+							 write_integer_positive(output, uint_value, &fs);
+					break;
+				case TYPE_c:
+					result = load_argv_character(args + index, &uint_value) &&
+							 write_character(output, uint_value, &fs);
+					break;
+				case TYPE_s:
+					result = load_argv_string(args + index, &string_value) &&
+							 write_string(output, string_value, &fs);
+					break;
+				case TYPE_p:
+					result = load_argv_pointer(args + index, &pointer_value) &&
+							 write_pointer(output, pointer_value, &fs);
+					break;
+				case TYPE_n:
+					result = load_argv_n_pointer(&fs, args + index, 
+												 &pointer_value) &&
+							 write_characters_written(output, pointer_value, 
+													  &fs);
+					break;
+				case TYPE_custom:
+					result = load_argv_custom(&fs, args + index, 
+											  &custom_value) &&
+							 printf_custom_write(output, &fs, &custom_value);
+					break;
+				default:
+					// FIXME Binary floating point, along with 
+					// generic_printf. %Hf, %Df and %DDf have no printf_arg 
+					// tag for decimal floating point yet.
+					result = false;
+					break;
+			}
+			if (!result) {
+				return false;
+			}
+			format += fs.input_length;
+		} else {
+			// Just normal letters, output everything up to the next '%'.
+			size_t literal_length = printf_cpu()->find_percent(format);
+			if (!printf_output_span(output, format, literal_length)) {
+				return false;
+			}
+			format += literal_length;
+		}
+	}
+	return true;
+}
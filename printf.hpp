@@ -0,0 +1,857 @@
+// Part of printf function suite. A type safe C++17 front end to printf, with
+// the same format strings and output, e.g.
+//     stdlib::print("%-8s|%5d|%#x\n", name, count, flags);
+// Arguments are passed as themselves rather than through a va_list, so the
+// type of each one is known when the call is compiled and it goes straight to
+// the matching write_* function. An argument that can never be printed, e.g.
+// a struct, is a compile error. An argument that doesn't suit its conversion,
+// e.g. an int for "%s", fails the call like a bad format string does.
+//
+// Length modifiers are optional here: without one an argument is printed at
+// its own size. With one the value is converted to that size first, exactly as
+// printf would, so "%hhx" of 0x1ff prints "ff". The conversion decides
+// signedness, so "%x" of -1 prints "ffffffff" for an int argument.
+//
+// "%s" takes char pointers, std::string and std::string_view. "%p" takes any
+// object pointer or nullptr. "%n" takes a pointer to any integer type. Posix
+// positional arguments and '*' widths and precisions work as they do in C.
+// Registered conversions take whatever suits the type they read, but only in
+// format strings parsed when running, as they aren't known when compiling.
+//
+// A format string wrapped in STDLIB_FORMAT is parsed when compiling instead,
+// e.g.
+//     stdlib::print(STDLIB_FORMAT("%-8s|%5d\n"), name, count);
+// Each call then compiles to straight-line code with the widths, flags and
+// precisions as constants. A bad format string, an argument that doesn't suit
+// its conversion, or too few arguments, are all compile errors.
+//
+// The C files are compiled as C and linked in as normal.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_HPP
+#define PRINTF_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <array>
+
+extern "C" {
+#include "printf_definitions.h"
+#include "printf_basic_output.h"
+#include "printf_format.h"
+#include "printf_custom.h"
+}
+
+#include "printf_format.hpp"
+
+
+// Wraps a string literal format for parsing when compiling.
+#define STDLIB_FORMAT(string) \
+	([] { \
+		struct format : stdlib::detail::compiled_format { \
+			static constexpr const char* value() { return string; } \
+		}; \
+		return format{}; \
+	}())
+
+
+namespace stdlib {
+
+namespace detail {
+
+// What an argument can be printed as.
+enum class argument_kind {
+	signed_integer,
+	unsigned_integer,
+	floating_point,
+	string,
+	pointer,
+	// A pointer to an integer, for "%n".
+	count_pointer,
+	unsupported
+};
+
+
+
+// Classifies an argument type.
+// Parameters:
+//     T - the type of the argument, as passed.
+// Returns:
+//     The argument_kind of T.
+template<typename T>
+constexpr argument_kind kind_of()
+{
+	using U = std::remove_cv_t<std::decay_t<T>>;
+
+	if constexpr (std::is_enum_v<U>) {
+		return kind_of<std::underlying_type_t<U>>();
+	} else if constexpr (std::is_same_v<U, bool>) {
+		return argument_kind::unsigned_integer;
+	} else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+		return argument_kind::signed_integer;
+	} else if constexpr (std::is_integral_v<U>) {
+		return argument_kind::unsigned_integer;
+	} else if constexpr (std::is_floating_point_v<U>) {
+		return argument_kind::floating_point;
+	} else if constexpr (std::is_same_v<U, char*> ||
+						 std::is_same_v<U, const char*> ||
+						 std::is_same_v<U, std::string> ||
+						 std::is_same_v<U, std::string_view>)
+	{
+		return argument_kind::string;
+	} else if constexpr (std::is_pointer_v<U> &&
+						 std::is_integral_v<std::remove_pointer_t<U>> &&
+						 !std::is_const_v<std::remove_pointer_t<U>>)
+	{
+		return argument_kind::count_pointer;
+	} else if constexpr (std::is_null_pointer_v<U> ||
+						 (std::is_pointer_v<U> &&
+						  (std::is_object_v<std::remove_pointer_t<U>> ||
+						   std::is_void_v<std::remove_pointer_t<U>>)))
+	{
+		return argument_kind::pointer;
+	} else {
+		return argument_kind::unsupported;
+	}
+}
+
+
+
+// Whether an argument of a kind can be printed with a conversion. Character
+// pointers count as strings, but may still be printed with "%p".
+// Parameters:
+//     kind - the kind of the argument.
+//     type - the conversion in the format string.
+// Returns:
+//     true if they go together, false if not.
+constexpr bool kind_suits_type(argument_kind kind, format_string_types type)
+{
+	switch (type) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			// PASS-THROUGH
+		case TYPE_u:
+			// PASS-THROUGH
+		case TYPE_o:
+			// PASS-THROUGH
+		case TYPE_x:
+			// PASS-THROUGH
+		case TYPE_X:
+			// PASS-THROUGH
+		case TYPE_b:
+			// PASS-THROUGH
+		case TYPE_B:
+			// PASS-THROUGH
+		case TYPE_c:
+			return (kind == argument_kind::signed_integer ||
+					kind == argument_kind::unsigned_integer);
+		case TYPE_f:
+			// PASS-THROUGH
+		case TYPE_F:
+			// PASS-THROUGH
+		case TYPE_e:
+			// PASS-THROUGH
+		case TYPE_E:
+			// PASS-THROUGH
+		case TYPE_g:
+			// PASS-THROUGH
+		case TYPE_G:
+			// PASS-THROUGH
+		case TYPE_a:
+			// PASS-THROUGH
+		case TYPE_A:
+			return kind == argument_kind::floating_point;
+		case TYPE_s:
+			return kind == argument_kind::string;
+		case TYPE_p:
+			return (kind == argument_kind::pointer ||
+					kind == argument_kind::count_pointer ||
+					kind == argument_kind::string);
+		case TYPE_n:
+			return kind == argument_kind::count_pointer;
+		default:
+			return false;
+	}
+}
+
+
+
+// Converts a signed value to the size given by a length modifier, as printf
+// does after popping it off the va_list.
+// Parameters:
+//     value - the value to convert.
+//     length - the length modifier, LENGTH_none leaves it alone.
+// Returns:
+//     The converted value.
+inline intmax_t signed_to_length(intmax_t value, format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_hh:
+			return static_cast<signed char>(value);
+		case LENGTH_h:
+			return static_cast<short>(value);
+		case LENGTH_l:
+			return static_cast<long int>(value);
+		case LENGTH_ll:
+			return static_cast<long long int>(value);
+		case LENGTH_z:
+			return static_cast<std::make_signed_t<size_t>>(value);
+		case LENGTH_t:
+			return static_cast<ptrdiff_t>(value);
+		case LENGTH_w8:
+			return static_cast<int8_t>(value);
+		case LENGTH_w16:
+			return static_cast<int16_t>(value);
+		case LENGTH_w32:
+			return static_cast<int32_t>(value);
+		case LENGTH_w64:
+			return static_cast<int64_t>(value);
+		case LENGTH_wf8:
+			return static_cast<int_fast8_t>(value);
+		case LENGTH_wf16:
+			return static_cast<int_fast16_t>(value);
+		case LENGTH_wf32:
+			return static_cast<int_fast32_t>(value);
+		case LENGTH_wf64:
+			return static_cast<int_fast64_t>(value);
+		default:
+			return value;
+	}
+}
+
+
+
+// Converts an unsigned value to the size given by a length modifier, as
+// printf does after popping it off the va_list.
+// Parameters:
+//     value - the value to convert.
+//     length - the length modifier, LENGTH_none leaves it alone.
+// Returns:
+//     The converted value.
+inline uintmax_t unsigned_to_length(uintmax_t value,
+									format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_hh:
+			return static_cast<unsigned char>(value);
+		case LENGTH_h:
+			return static_cast<unsigned short>(value);
+		case LENGTH_l:
+			return static_cast<unsigned long int>(value);
+		case LENGTH_ll:
+			return static_cast<unsigned long long int>(value);
+		case LENGTH_z:
+			return static_cast<size_t>(value);
+		case LENGTH_t:
+			return static_cast<std::make_unsigned_t<ptrdiff_t>>(value);
+		case LENGTH_w8:
+			return static_cast<uint8_t>(value);
+		case LENGTH_w16:
+			return static_cast<uint16_t>(value);
+		case LENGTH_w32:
+			return static_cast<uint32_t>(value);
+		case LENGTH_w64:
+			return static_cast<uint64_t>(value);
+		case LENGTH_wf8:
+			return static_cast<uint_fast8_t>(value);
+		case LENGTH_wf16:
+			return static_cast<uint_fast16_t>(value);
+		case LENGTH_wf32:
+			return static_cast<uint_fast32_t>(value);
+		case LENGTH_wf64:
+			return static_cast<uint_fast64_t>(value);
+		default:
+			return value;
+	}
+}
+
+
+
+// Writes a registered conversion, passing it value as a tagged argument read
+// as the conversion says.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, of TYPE_custom.
+//     value - the argument.
+// Returns:
+//     true on success, false on error, including when value doesn't suit what
+//     the conversion reads.
+template<typename T>
+bool write_custom_argument(output_specifier *output, format_specifier *fs,
+						   const T &value)
+{
+	constexpr argument_kind kind = kind_of<T>();
+	format_string_types type = fs->custom->argument;
+	printf_arg argument = {};
+
+	if (!kind_suits_type(kind, type)) {
+		return false;
+	}
+	argument.type = type;
+	argument.length = fs->length;
+
+	if constexpr (kind == argument_kind::signed_integer ||
+				  kind == argument_kind::unsigned_integer)
+	{
+		using U = std::remove_cv_t<std::decay_t<T>>;
+		using I = std::conditional_t<std::is_enum_v<U>,
+									 std::underlying_type<U>,
+									 std::common_type<U>>;
+		using integer = decltype(+std::declval<typename I::type>());
+		integer raw = static_cast<integer>(value);
+
+		if (type == TYPE_c) {
+			argument.value.unsigned_integer = static_cast<unsigned char>(raw);
+		} else if (type == TYPE_d || type == TYPE_i) {
+			argument.value.integer = signed_to_length(
+				static_cast<std::make_signed_t<integer>>(raw), fs->length);
+		} else {
+			argument.value.unsigned_integer = unsigned_to_length(
+				static_cast<std::make_unsigned_t<integer>>(raw), fs->length);
+		}
+	} else if constexpr (kind == argument_kind::string) {
+		using U = std::remove_cv_t<std::decay_t<T>>;
+		if constexpr (std::is_same_v<U, std::string_view>) {
+			// Not '\0' terminated, and conversions may read to the end.
+			return false;
+		} else if constexpr (std::is_same_v<U, std::string>) {
+			argument.value.string = value.c_str();
+		} else {
+			argument.value.string = value;
+		}
+		if (type == TYPE_p) {
+			argument.value.pointer = const_cast<char*>(argument.value.string);
+		}
+	} else if constexpr (kind == argument_kind::pointer ||
+						 kind == argument_kind::count_pointer)
+	{
+		argument.value.pointer = const_cast<void*>(
+			static_cast<const void*>(value));
+	} else {
+		// Floating point, which conversions can't read yet.
+		return false;
+	}
+	return printf_custom_write(output, fs, &argument);
+}
+
+
+
+// Writes a single argument according to fs. Which write_* function is used
+// is decided when this is compiled, from the type of the argument.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, already checked for unused values.
+//     value - the argument.
+// Returns:
+//     true on success, false on error, including when value doesn't suit the
+//     conversion in fs.
+template<typename T>
+bool write_argument(output_specifier *output, format_specifier *fs,
+					const T &value)
+{
+	constexpr argument_kind kind = kind_of<T>();
+	static_assert(kind != argument_kind::unsupported,
+				  "stdlib::print can't print an argument of this type");
+
+	if (fs->type == TYPE_custom) {
+		return write_custom_argument(output, fs, value);
+	}
+	if (!kind_suits_type(kind, fs->type)) {
+		return false;
+	}
+
+	if constexpr (kind == argument_kind::signed_integer ||
+				  kind == argument_kind::unsigned_integer)
+	{
+		using U = std::remove_cv_t<std::decay_t<T>>;
+		using I = std::conditional_t<std::is_enum_v<U>,
+									 std::underlying_type<U>,
+									 std::common_type<U>>;
+		// Promoted, as it would be on the way through a va_list.
+		using integer = decltype(+std::declval<typename I::type>());
+		// The signedness comes from the conversion, the size from the
+		// argument unless a length modifier says otherwise.
+		using signed_integer = std::make_signed_t<integer>;
+		using unsigned_integer = std::make_unsigned_t<integer>;
+		integer raw = static_cast<integer>(value);
+
+		if (fs->type == TYPE_c) {
+			return write_character(output, static_cast<unsigned char>(raw),
+								   fs);
+		} else if (fs->type == TYPE_d || fs->type == TYPE_i) {
+			intmax_t int_value = signed_to_length(
+				static_cast<signed_integer>(raw), fs->length);
+			if (int_value >= 0) {
+				return write_integer_positive(output, int_value, fs);
+			} else {
+				return write_decimal_negative(output, int_value, fs);
+			}
+		} else {
+			uintmax_t uint_value = unsigned_to_length(
+				static_cast<unsigned_integer>(raw), fs->length);
+			return write_integer_positive(output, uint_value, fs);
+		}
+	} else if constexpr (kind == argument_kind::floating_point) {
+		// FIXME Implement, along with the C side.
+		return false;
+	} else if constexpr (kind == argument_kind::string) {
+		using U = std::remove_cv_t<std::decay_t<T>>;
+		if constexpr (std::is_same_v<U, std::string> ||
+					  std::is_same_v<U, std::string_view>)
+		{
+			if (fs->type == TYPE_p) {
+				return write_pointer(output, value.data(), fs);
+			}
+			// Not '\0' terminated, so never read past the end.
+			format_specifier bounded = *fs;
+			if (bounded.precision == -1 ||
+				static_cast<size_t>(bounded.precision) > value.size())
+			{
+				bounded.precision = (value.size() > INT_MAX) ?
+									INT_MAX : static_cast<int>(value.size());
+			}
+			return write_string(output, value.data(), &bounded);
+		} else {
+			const char *string_value = value;
+			if (fs->type == TYPE_p) {
+				return write_pointer(output, string_value, fs);
+			}
+			return write_string(output, string_value, fs);
+		}
+	} else if constexpr (kind == argument_kind::count_pointer) {
+		if (fs->type == TYPE_p) {
+			return write_pointer(output, static_cast<const void*>(value), fs);
+		}
+		if (value == nullptr) {
+			return false;
+		}
+		// We know the real type, so the length modifier isn't needed.
+		using integer = std::remove_pointer_t<std::decay_t<T>>;
+		*value = static_cast<integer>(output->characters_written);
+		return true;
+	} else if constexpr (kind == argument_kind::pointer) {
+		return write_pointer(output, static_cast<const void*>(value), fs);
+	}
+}
+
+
+
+// Calls function with the argument at index.
+// Parameters:
+//     index - which argument, from 0.
+//     function - called with the argument.
+//     args - the arguments.
+// Returns:
+//     What function returns, or false if there is no such argument.
+template<typename F, typename... Args>
+bool with_argument(int index, F &&function, const Args&... args)
+{
+	int current = 0;
+	bool result = false;
+	bool found = ((current++ == index ? (result = function(args), true) : false)
+				  || ...);
+	(void) current;
+	return found && result;
+}
+
+
+
+// Reads a '*' width or precision from the argument at index.
+// Parameters:
+//     index - which argument, from 0.
+//     value - where to store the value.
+//     args - the arguments.
+// Returns:
+//     true on success, false if there is no such argument or it isn't an
+//     integer.
+template<typename... Args>
+bool argument_as_int(int index, int *value, const Args&... args)
+{
+	return with_argument(index, [value](const auto &argument) {
+		using U = std::remove_cv_t<std::decay_t<decltype(argument)>>;
+		if constexpr (std::is_integral_v<U>) {
+			*value = static_cast<int>(argument);
+			return true;
+		} else {
+			return false;
+		}
+	}, args...);
+}
+
+
+
+// Generic print, the counterpart of generic_printf. Serves for everything in
+// stdlib::print.
+// Parameters:
+//     output - where to write to.
+//     format - the printf format string.
+//     args - the arguments.
+// Returns:
+//     true on success, false on error.
+template<typename... Args>
+bool generic_print(output_specifier *output, const char *format,
+				   const Args&... args)
+{
+	// Whether we are using positional parameters.
+	bool using_positions = false;
+	bool first_element = true;
+	// The next argument when not using positions.
+	int next = 0;
+	int index = 0;
+	int width = 0;
+	int precision = 0;
+
+	while (*format != '\0') {
+		if (*format == '%' && *(format + 1) == '%') {
+			// Starting an escaped % - "%%"
+			if (!printf_output(output, '%')) {
+				return false;
+			}
+			format += 2;
+		} else if (*format == '%') {
+			// Starting a format specifier.
+			format++;
+
+			format_specifier fs;
+			if (format_error_is_error(read_format_string(format, &fs))) {
+				return false;
+			}
+
+			if (first_element) {
+				using_positions = (fs.position != 0);
+				first_element = false;
+			}
+			if ((fs.position != 0) != using_positions) {
+				// All or nothing for positions.
+				return false;
+			}
+
+			// Preceding width and positional preceding width.
+			if (fs.preceding_width != 0) {
+				index = using_positions ? fs.preceding_width - 1 : next++;
+				if (!argument_as_int(index, &width, args...)) {
+					return false;
+				}
+				// If width is negative then that is taken as a positive
+				// value and a '-' flag.
+				if (width >= 0) {
+					fs.width = width;
+				} else {
+					fs.left_justify = true;
+					fs.width = (width == INT_MIN) ? INT_MAX : -width;
+				}
+			}
+
+			// Preceding precision or positional preceding precision.
+			if (fs.preceding_precision != 0) {
+				index = using_positions ? fs.preceding_precision - 1 : next++;
+				if (!argument_as_int(index, &precision, args...)) {
+					return false;
+				}
+				// Explicit precision values of < 0 are ignored.
+				if (precision >= 0) {
+					fs.precision = precision;
+				}
+			}
+
+			format_string_check_unused_values(&fs);
+
+			index = using_positions ? fs.position - 1 : next++;
+			if (!with_argument(index, [output, &fs](const auto &argument) {
+					return write_argument(output, &fs, argument);
+				}, args...))
+			{
+				return false;
+			}
+			format += fs.input_length;
+		} else {
+			// Just normal letters, output everything up to the next '%'.
+			size_t literal_length = strcspn(format, "%");
+			if (!printf_output_span(output, format, literal_length)) {
+				return false;
+			}
+			format += literal_length;
+		}
+	}
+	return true;
+}
+
+
+
+// Base of the types made by STDLIB_FORMAT, which have a static value()
+// returning the format string.
+struct compiled_format {};
+
+template<typename F>
+constexpr bool is_compiled_format = std::is_base_of_v<compiled_format, F>;
+
+// Whether a type can be given as a format, a string or a compiled format.
+template<typename F>
+constexpr bool is_format = (std::is_convertible_v<F, const char*> ||
+							is_compiled_format<F>);
+
+// The summary and nodes of a compiled format, worked out once per format.
+template<typename F>
+struct compiled_format_nodes {
+	static constexpr format_summary summary =
+		walk_format_string(F::value(), nullptr);
+
+	static constexpr std::array<format_node, summary.node_count> build()
+	{
+		std::array<format_node, summary.node_count> nodes{};
+		walk_format_string(F::value(), nodes.data());
+		return nodes;
+	}
+
+	static constexpr std::array<format_node, summary.node_count> nodes =
+		build();
+};
+
+
+
+// Reads a '*' width or precision from an argument of a compiled format.
+// Parameters:
+//     argument - the argument.
+// Returns:
+//     The argument as an int.
+template<typename T>
+int compiled_argument_as_int(const T &argument)
+{
+	using U = std::remove_cv_t<std::decay_t<T>>;
+	static_assert(std::is_integral_v<U> || std::is_enum_v<U>,
+				  "'*' width or precision must be given an integer");
+	return static_cast<int>(argument);
+}
+
+
+
+// Outputs one node of a compiled format.
+// Parameters:
+//     F - the compiled format.
+//     I - which node.
+//     output - where to write to.
+//     args - the arguments, as a tuple.
+// Returns:
+//     true on success, false on error.
+template<typename F, size_t I, typename Tuple>
+bool compiled_print_node(output_specifier *output, const Tuple &args)
+{
+	constexpr format_node node = compiled_format_nodes<F>::nodes[I];
+
+	if constexpr (node.literal) {
+		return printf_output_span(output, F::value() + node.offset,
+								  node.length);
+	} else {
+		using T = std::tuple_element_t<node.argument, Tuple>;
+		static_assert(kind_suits_type(kind_of<T>(), node.fs.type),
+					  "argument doesn't suit its conversion");
+
+		format_specifier fs = node.fs;
+		if constexpr (node.width_argument != -1) {
+			int width = compiled_argument_as_int(
+				std::get<node.width_argument>(args));
+			// If width is negative then that is taken as a positive value and
+			// a '-' flag.
+			if (width >= 0) {
+				fs.width = width;
+			} else {
+				fs.left_justify = true;
+				fs.zero_padded = false;
+				fs.width = (width == INT_MIN) ? INT_MAX : -width;
+			}
+		}
+		if constexpr (node.precision_argument != -1) {
+			int precision = compiled_argument_as_int(
+				std::get<node.precision_argument>(args));
+			// Explicit precision values of < 0 are ignored.
+			// If a precision is specified, the 0 flag is ignored.
+			if (precision >= 0) {
+				fs.precision = precision;
+				fs.zero_padded = false;
+			}
+		}
+		return write_argument(output, &fs, std::get<node.argument>(args));
+	}
+}
+
+
+
+// Generic print for a compiled format, output node by node.
+// Parameters:
+//     output - where to write to.
+//     format - the compiled format.
+//     args - the arguments.
+// Returns:
+//     true on success, false on error.
+template<typename F, typename... Args, size_t... I>
+bool compiled_print(output_specifier *output, std::index_sequence<I...>,
+					const Args&... args)
+{
+	auto arguments = std::forward_as_tuple(args...);
+	(void) arguments;
+	return (compiled_print_node<F, I>(output, arguments) && ...);
+}
+
+
+
+// Generic print for a compiled format. Checks the format when compiling.
+// Parameters:
+//     output - where to write to.
+//     format - the compiled format.
+//     args - the arguments.
+// Returns:
+//     true on success, false on error.
+template<typename F, typename... Args,
+		 typename = std::enable_if_t<is_compiled_format<F>>>
+bool generic_print(output_specifier *output, F format, const Args&... args)
+{
+	(void) format;
+	constexpr format_summary summary = compiled_format_nodes<F>::summary;
+	static_assert(summary.error != FORMAT_ERROR_unknown_type,
+				  "format string has an unknown conversion");
+	static_assert(summary.error != FORMAT_ERROR_incompatible_length_type,
+				  "format string has a length that doesn't suit its "
+				  "conversion");
+	static_assert(summary.error != FORMAT_ERROR_unknown_length,
+				  "format string has an unknown wN or wfN length");
+	static_assert(summary.error != FORMAT_ERROR_no_positional_width,
+				  "format string has '*' width without a position");
+	static_assert(summary.error != FORMAT_ERROR_no_positional_precision,
+				  "format string has '*' precision without a position");
+	static_assert(!summary.mixed_positions,
+				  "format string mixes positional and plain conversions");
+	static_assert(summary.argument_count <= sizeof...(Args),
+				  "format string needs more arguments than given");
+
+	if constexpr (summary.error != FORMAT_okay || summary.mixed_positions ||
+				  summary.argument_count > sizeof...(Args))
+	{
+		return false;
+	} else {
+		return compiled_print<F>(output,
+			std::make_index_sequence<summary.node_count>{}, args...);
+	}
+}
+
+
+
+// Prints to an output and finishes it.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function.
+//     format - the printf format string.
+//     args - the arguments.
+// Returns:
+//     Characters written on success, -1 on error.
+template<typename Format, typename... Args>
+int print_and_finish(output_specifier *output, Format format,
+					 const Args&... args)
+{
+	if constexpr (!is_compiled_format<Format>) {
+		if (format == nullptr) {
+			return -1;
+		}
+	}
+	bool result = generic_print(output, format, args...);
+	if (!printf_output_finish(output)) {
+		result = false;
+	}
+	if (result) {
+		return output->characters_written;
+	} else {
+		return -1;
+	}
+}
+
+} // namespace detail
+
+
+
+// printf.
+// Parameters:
+//     format - the printf format string, or from STDLIB_FORMAT.
+//     args - the arguments.
+// Returns:
+//     Characters written on success, -1 on error.
+template<typename Format, typename... Args,
+		 typename = std::enable_if_t<detail::is_format<Format>>>
+int print(Format format, const Args&... args)
+{
+	output_specifier output;
+	printf_output_initialise_stream(&output, stdout);
+	return detail::print_and_finish(&output, format, args...);
+}
+
+
+
+// fprintf.
+// Parameters:
+//     stream - the stream to write to.
+//     format - the printf format string, or from STDLIB_FORMAT.
+//     args - the arguments.
+// Returns:
+//     Characters written on success, -1 on error.
+template<typename Format, typename... Args,
+		 typename = std::enable_if_t<detail::is_format<Format>>>
+int print(FILE *stream, Format format, const Args&... args)
+{
+	output_specifier output;
+	printf_output_initialise_stream(&output, stream);
+	return detail::print_and_finish(&output, format, args...);
+}
+
+
+
+// snprintf.
+// Parameters:
+//     str - the string to write to, may be nullptr if size is 0.
+//     size - the size of str, including room for the '\0'.
+//     format - the printf format string, or from STDLIB_FORMAT.
+//     args - the arguments.
+// Returns:
+//     Characters that would have been written given the room on success, -1
+//     on error.
+template<typename Format, typename... Args,
+		 typename = std::enable_if_t<detail::is_format<Format>>>
+int sprint(char *str, size_t size, Format format, const Args&... args)
+{
+	output_specifier output;
+	printf_output_initialise_string(&output, str, size);
+	return detail::print_and_finish(&output, format, args...);
+}
+
+
+
+// Prints to any output, e.g. a callback or a tee. The output is not finished,
+// so several calls can print to it before printf_output_finish.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function.
+//     format - the printf format string, or from STDLIB_FORMAT.
+//     args - the arguments.
+// Returns:
+//     true on success, false on error.
+template<typename Format, typename... Args,
+		 typename = std::enable_if_t<detail::is_format<Format>>>
+bool print_to(output_specifier *output, Format format, const Args&... args)
+{
+	if constexpr (!detail::is_compiled_format<Format>) {
+		if (format == nullptr) {
+			return false;
+		}
+	}
+	return detail::generic_print(output, format, args...);
+}
+
+} // namespace stdlib
+
+
+#endif // PRINTF_HPP
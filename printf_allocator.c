@@ -0,0 +1,286 @@
+// Part of printf function suite. Handles where the memory for asprintf 
+// strings and stored positional arguments comes from.
+// A printf_allocator is a set of allocate/reallocate/deallocate functions with
+// a context pointer. The default uses malloc/realloc/free. Each thread may set
+// its own allocator, and asprintf may be given one per call.
+// printf_arena is a bump allocator over caller provided memory. Allocations 
+// move a pointer forwards and are all given back at once on reset, so memory 
+// for a request can be thrown away in one go.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_allocator.h"
+
+// Alignment of every arena allocation, enough for any type we store.
+#define ARENA_ALIGNMENT (_Alignof(max_align_t))
+
+
+
+static void* default_allocate(void *context, size_t size);
+static void* default_reallocate(void *context, void *pointer, size_t old_size, 
+								size_t new_size);
+static void default_deallocate(void *context, void *pointer);
+static void* arena_allocate(void *context, size_t size);
+static void* arena_reallocate(void *context, void *pointer, size_t old_size, 
+							  size_t new_size);
+static void arena_deallocate(void *context, void *pointer);
+
+
+
+// The allocator used when none has been set, wraps malloc/realloc/free.
+static const printf_allocator default_allocator = {
+	default_allocate, default_reallocate, default_deallocate, NULL
+};
+
+// The allocator set for this thread, NULL for default_allocator.
+static _Thread_local const printf_allocator *thread_allocator = NULL;
+
+
+
+// Gets memory from an allocator.
+// Parameters:
+//     allocator - the allocator to use.
+//     size - the number of bytes needed.
+// Returns:
+//     the memory, or NULL on failure.
+void* printf_allocate(const printf_allocator *allocator, size_t size)
+{
+	return allocator->allocate(allocator->context, size);
+}
+
+
+
+// Resizes memory from an allocator, keeping its contents.
+// Parameters:
+//     allocator - the allocator pointer came from.
+//     pointer - the memory to resize.
+//     old_size - the current size of pointer.
+//     new_size - the size needed.
+// Returns:
+//     the new memory, or NULL on failure, in which case pointer is untouched.
+void* printf_reallocate(const printf_allocator *allocator, void *pointer, 
+						size_t old_size, size_t new_size)
+{
+	return allocator->reallocate(allocator->context, pointer, old_size, 
+								 new_size);
+}
+
+
+
+// Gives memory back to an allocator.
+// Parameters:
+//     allocator - the allocator pointer came from.
+//     pointer - the memory to give back, may be NULL.
+void printf_deallocate(const printf_allocator *allocator, void *pointer)
+{
+	if (pointer != NULL) {
+		allocator->deallocate(allocator->context, pointer);
+	}
+}
+
+
+
+// Sets the allocator this thread uses for asprintf strings and positional
+// arguments. The allocator must stay valid until it is replaced.
+// Parameters:
+//     allocator - the allocator to use, NULL to go back to malloc/free.
+void printf_set_thread_allocator(const printf_allocator *allocator)
+{
+	thread_allocator = allocator;
+}
+
+
+
+// Gets the allocator this thread is using.
+// Returns:
+//     the allocator set by printf_set_thread_allocator, or the default 
+//     malloc/free allocator if none was set.
+const printf_allocator* printf_thread_allocator(void)
+{
+	if (thread_allocator == NULL) {
+		return &default_allocator;
+	}
+	return thread_allocator;
+}
+
+
+
+// Sets up an arena over memory given by the caller. The arena never frees 
+// memory itself, it is up to the caller to release memory afterwards.
+// Parameters:
+//     arena - the arena to set up.
+//     memory - the memory to hand out, of any alignment. Allocations are 
+//         aligned within it, so some bytes may go unused.
+//     size - the number of bytes in memory.
+void printf_arena_initialise(printf_arena *arena, void *memory, size_t size)
+{
+	arena->memory = memory;
+	arena->size = size;
+	arena->used = 0;
+	arena->last = 0;
+}
+
+
+
+// Gives back everything allocated from the arena in one go. Anything 
+// allocated from it is no longer valid.
+// Parameters:
+//     arena - the arena to reset.
+void printf_arena_reset(printf_arena *arena)
+{
+	arena->used = 0;
+	arena->last = 0;
+}
+
+
+
+// Makes an allocator that gets its memory from an arena.
+// Parameters:
+//     arena - the arena to allocate from, must outlive the allocator.
+// Returns:
+//     the allocator.
+printf_allocator printf_arena_allocator(printf_arena *arena)
+{
+	printf_allocator allocator;
+	allocator.allocate = arena_allocate;
+	allocator.reallocate = arena_reallocate;
+	allocator.deallocate = arena_deallocate;
+	allocator.context = arena;
+	return allocator;
+}
+
+
+
+// Allocates using malloc.
+// Parameters:
+//     context - unused.
+//     size - the number of bytes needed.
+// Returns:
+//     the memory, or NULL on failure.
+static void* default_allocate(void *context, size_t size)
+{
+	(void) context;
+	return malloc(size);
+}
+
+
+
+// Reallocates using realloc.
+// Parameters:
+//     context - unused.
+//     pointer - the memory to resize.
+//     old_size - unused, realloc keeps track itself.
+//     new_size - the size needed.
+// Returns:
+//     the new memory, or NULL on failure.
+static void* default_reallocate(void *context, void *pointer, size_t old_size, 
+								size_t new_size)
+{
+	(void) context;
+	(void) old_size;
+	return realloc(pointer, new_size);
+}
+
+
+
+// Deallocates using free.
+// Parameters:
+//     context - unused.
+//     pointer - the memory to give back.
+static void default_deallocate(void *context, void *pointer)
+{
+	(void) context;
+	free(pointer);
+}
+
+
+
+// Allocates from an arena by moving its used pointer forwards.
+// Parameters:
+//     context - the printf_arena.
+//     size - the number of bytes needed.
+// Returns:
+//     the memory, or NULL if the arena doesn't have enough left.
+static void* arena_allocate(void *context, size_t size)
+{
+	printf_arena *arena = context;
+	// Round the address up, not just the offset, so every allocation is 
+	// suitably aligned however the arena's memory is.
+	uintptr_t address = (uintptr_t) (arena->memory + arena->used);
+	size_t start = arena->used + 
+				   ((ARENA_ALIGNMENT - address % ARENA_ALIGNMENT) % 
+					ARENA_ALIGNMENT);
+	
+	if (start > arena->size || size > arena->size - start) {
+		return NULL;
+	}
+	arena->last = start;
+	arena->used = start + size;
+	return arena->memory + start;
+}
+
+
+
+// Resizes memory from an arena. The most recent allocation is resized in 
+// place, anything else is copied to a new allocation.
+// Parameters:
+//     context - the printf_arena.
+//     pointer - the memory to resize.
+//     old_size - the current size of pointer.
+//     new_size - the size needed.
+// Returns:
+//     the new memory, or NULL if the arena doesn't have enough left.
+static void* arena_reallocate(void *context, void *pointer, size_t old_size, 
+							  size_t new_size)
+{
+	printf_arena *arena = context;
+	char *new_pointer = NULL;
+	
+	if (pointer == NULL) {
+		return arena_allocate(context, new_size);
+	}
+	
+	if ((char*) pointer == arena->memory + arena->last) {
+		// Nothing comes after it, so just move the end.
+		if (new_size > arena->size - arena->last) {
+			return NULL;
+		}
+		arena->used = arena->last + new_size;
+		return pointer;
+	}
+	
+	new_pointer = arena_allocate(context, new_size);
+	if (new_pointer == NULL) {
+		return NULL;
+	}
+	if (old_size < new_size) {
+		memcpy(new_pointer, pointer, old_size);
+	} else {
+		memcpy(new_pointer, pointer, new_size);
+	}
+	return new_pointer;
+}
+
+
+
+// Gives back memory to an arena. Memory is only really given back by 
+// printf_arena_reset, so this does nothing.
+// Parameters:
+//     context - the printf_arena.
+//     pointer - the memory to give back.
+static void arena_deallocate(void *context, void *pointer)
+{
+	(void) context;
+	(void) pointer;
+}
@@ -0,0 +1,21 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_ALLOCATOR_H
+#define PRINTF_ALLOCATOR_H
+
+#include "printf_definitions.h"
+
+void* printf_allocate(const printf_allocator *allocator, size_t size);
+void* printf_reallocate(const printf_allocator *allocator, void *pointer, 
+						size_t old_size, size_t new_size);
+void printf_deallocate(const printf_allocator *allocator, void *pointer);
+
+void printf_set_thread_allocator(const printf_allocator *allocator);
+const printf_allocator* printf_thread_allocator(void);
+void printf_arena_initialise(printf_arena *arena, void *memory, size_t size);
+void printf_arena_reset(printf_arena *arena);
+printf_allocator printf_arena_allocator(printf_arena *arena);
+
+#endif // PRINTF_ALLOCATOR_H
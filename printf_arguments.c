@@ -4,6 +4,8 @@
 // pop_and_load functions are used to load from either previously stored 
 // arguments if using positional parameters, or directly from the variable 
 // argument list if not.
+// load_argv functions are used to load from the tagged argument arrays given 
+// to new_printf_argv, checking the tags.
 // positional_info_array is a dynamically resizing data structure that holds
 // the stored positional arguments and information to retrieve them.
 //
@@ -21,28 +23,53 @@
 
 #include "printf_definitions.h"
 #include "printf_arguments.h"
+#include "printf_format.h"
+#include "printf_allocator.h"
 
 #define DEFAULT_PIA_SIZE 8
 
 
 
 static bool pop_and_store_integer(positional_info *current_item, 
-								  va_list_s *valist);
+								  va_list_s *valist, 
+								  const printf_allocator *allocator);
 static bool pop_and_store_unsigned_integer(positional_info *current_item, 
-										   va_list_s *valist);
+										   va_list_s *valist, 
+										   const printf_allocator *allocator);
 static bool pop_and_store_floating_point(positional_info *current_item, 
-										 va_list_s *valist);
+										 va_list_s *valist, 
+										 const printf_allocator *allocator);
 static bool pop_and_store_string(positional_info *current_item, 
-								 va_list_s *valist);
+								 va_list_s *valist, 
+								 const printf_allocator *allocator);
 static bool pop_and_store_character(positional_info *current_item, 
-									va_list_s *valist);
+									va_list_s *valist, 
+									const printf_allocator *allocator);
 static bool pop_and_store_pointer(positional_info *current_item, 
-								  va_list_s *valist);
+								  va_list_s *valist, 
+								  const printf_allocator *allocator);
 static bool pop_and_store_n_pointer(positional_info *current_item, 
-									va_list_s *valist);
+									va_list_s *valist, 
+									const printf_allocator *allocator);
 static bool pia_check_size_and_update(positional_info_array *pia, 
 									  int required_size);
 static bool pia_initialise(positional_info_array *pia);
+static bool argv_is_integer(const printf_arg *arg);
+static bool argv_is_signed(const printf_arg *arg);
+static intmax_t pop_width_integer(va_list_s *valist, 
+								  format_string_lengths length);
+static uintmax_t pop_width_unsigned_integer(va_list_s *valist, 
+											format_string_lengths length);
+static void* pop_width_n_pointer(va_list_s *valist, 
+								 format_string_lengths length);
+#ifdef PRINTF_DECIMAL_FLOAT
+static printf_uint128 pop_decimal_floating_point(va_list_s *valist, 
+											format_string_lengths length);
+#endif
+static intmax_t truncate_width_integer(intmax_t value, 
+									   format_string_lengths length);
+static uintmax_t truncate_width_unsigned_integer(uintmax_t value, 
+												format_string_lengths length);
 
 
 
@@ -69,7 +96,9 @@ bool pop_and_store_argument_list(positional_info_array *pia, int count,
 				// PASS-THROUGH.
 			case TYPE_i:
 				// Signed decimal integer.
-				if (!pop_and_store_integer(current_item, valist)) {
+				if (!pop_and_store_integer(current_item, valist, 
+										   pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;
 				}
@@ -80,9 +109,15 @@ bool pop_and_store_argument_list(positional_info_array *pia, int count,
 				// PASS-THROUGH
 			case TYPE_X:
 				// PASS-THROUGH
+			case TYPE_b:
+				// PASS-THROUGH
+			case TYPE_B:
+				// PASS-THROUGH
 			case TYPE_u:
 				// Unsigned decimal integer.
-				if (!pop_and_store_unsigned_integer(current_item, valist)) {
+				if (!pop_and_store_unsigned_integer(current_item, valist, 
+													pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;
 				}
@@ -103,34 +138,44 @@ bool pop_and_store_argument_list(positional_info_array *pia, int count,
 				// PASS-THROUGH
 			case TYPE_A:
 				// Floating point number.
-				if (!pop_and_store_floating_point(current_item, valist)) {
+				if (!pop_and_store_floating_point(current_item, valist, 
+												  pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;
 				}
 				break;
 			case TYPE_c:
 				// Character.
-				if (!pop_and_store_character(current_item, valist)) {
+				if (!pop_and_store_character(current_item, valist, 
+											 pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;
 				}
 				break;
 			case TYPE_s:
 			    // String.
-				if (!pop_and_store_string(current_item, valist)) {
+				if (!pop_and_store_string(current_item, valist, 
+										  pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;
 				}
 				break;
 			case TYPE_p:
 				// Pointer.
-				if (!pop_and_store_pointer(current_item, valist)) {
+				if (!pop_and_store_pointer(current_item, valist, 
+										   pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;	
 				}
 				break;
 			case TYPE_n:
-				if (!pop_and_store_n_pointer(current_item, valist)) {
+				if (!pop_and_store_n_pointer(current_item, valist, 
+											 pia->allocator))
+				{
 					pop_and_store_cleanup(pia, count);
 					return false;
 				}
@@ -239,6 +284,39 @@ intmax_t pop_or_load_integer(const format_specifier *fs, va_list_s *valist,
 				return_value = va_arg(valist->valist, ptrdiff_t);
 			}
 			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			// int8_t to int_fast64_t, stored as intmax_t.
+			if (using_positions) {
+				return_value = *((intmax_t*) pointer);
+			} else {
+				return_value = pop_width_integer(valist, fs->length);
+			}
+			break;
+#ifdef PRINTF_INT128
+		case LENGTH_w128:
+			// Cut down to intmax_t, printf.c reads it whole with 
+			// pop_or_load_integer128.
+			if (using_positions) {
+				return_value = *((printf_int128*) pointer);
+			} else {
+				return_value = va_arg(valist->valist, printf_int128);
+			}
+			break;
+#endif
 		default:
 			// Should never be called, means an error elsewhere in the code.
 			break;
@@ -340,6 +418,37 @@ uintmax_t pop_or_load_unsigned_integer(const format_specifier *fs,
 				return_value = va_arg(valist->valist, ptrdiff_t);
 			}
 			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			// uint8_t to uint_fast64_t, stored as uintmax_t.
+			if (using_positions) {
+				return_value = *((uintmax_t*) pointer);
+			} else {
+				return_value = pop_width_unsigned_integer(valist, fs->length);
+			}
+			break;
+#ifdef PRINTF_INT128
+		case LENGTH_w128:
+			if (using_positions) {
+				return_value = *((printf_uint128*) pointer);
+			} else {
+				return_value = va_arg(valist->valist, printf_uint128);
+			}
+			break;
+#endif
 		default:
 			// Should never be called, means an error elsewhere in the code.
 			break;
@@ -350,6 +459,35 @@ uintmax_t pop_or_load_unsigned_integer(const format_specifier *fs,
 
 
 
+#ifdef PRINTF_INT128
+// Either pops a "%w128d" or "%w128u" integer off the valist and returns it, 
+// or if we are using positional arguments loads one from memory. va_list may 
+// be NULL if using_positions, positional_items may be NULL if not 
+// using_positions.
+// Parameters:
+//     fs - The format specifier for what to pop, of LENGTH_w128.
+//     valist - Struct holding a va_list for us to pop off of.
+//     using_positions - Whether we pop or load from memory.
+//     positional_items - Array holding information about previously popped
+//         items stored in memory, when using_positions = true.
+// Returns:
+//     The value popped or loaded. Signed values are converted, so convert it 
+//     back to printf_int128 for "%d".
+printf_uint128 pop_or_load_integer128(const format_specifier *fs, 
+	va_list_s *valist, bool using_positions, positional_info *positional_items)
+{
+	if (using_positions) {
+		return *((printf_uint128*) positional_items[fs->position - 1].item);
+	}
+	if (fs->type == TYPE_d || fs->type == TYPE_i) {
+		return va_arg(valist->valist, printf_int128);
+	}
+	return va_arg(valist->valist, printf_uint128);
+}
+#endif
+
+
+
 // Either pops a floating point number off the valist and returns it, or if we
 // are using positional arguments loads one from memory. va_list may be NULL
 // if using_positions, positional_items may be NULL if not using_positions.
@@ -398,6 +536,32 @@ long double pop_or_load_floating_point(const format_specifier *fs,
 
 
 
+#ifdef PRINTF_DECIMAL_FLOAT
+// Either pops a "%Hf", "%Df" or "%DDf" decimal floating point number off the 
+// valist and returns its encoding, or if we are using positional arguments 
+// loads one from memory. va_list may be NULL if using_positions, 
+// positional_items may be NULL if not using_positions.
+// Parameters:
+//     fs - The format specifier for what to pop, of LENGTH_H, LENGTH_D or 
+//         LENGTH_DD.
+//     valist - Struct holding a va_list for us to pop off of.
+//     using_positions - Whether we pop or load from memory.
+//     positional_items - Array holding information about previously popped
+//         items stored in memory, when using_positions = true.
+// Returns:
+//     The BID encoding of the value, in the low 32, 64 or 128 bits.
+printf_uint128 pop_or_load_decimal_floating_point(const format_specifier *fs, 
+	va_list_s *valist, bool using_positions, positional_info *positional_items)
+{
+	if (using_positions) {
+		return *((printf_uint128*) positional_items[fs->position - 1].item);
+	}
+	return pop_decimal_floating_point(valist, fs->length);
+}
+#endif
+
+
+
 // Either pops a char off the valist and returns it, or if we are using
 // positional arguments loads one from memory. va_list may be NULL if
 // using_positions, positional_items may be NULL if not using_positions.
@@ -564,6 +728,25 @@ void* pop_or_load_n_pointer(const format_specifier *fs, va_list_s *valist,
 		case LENGTH_t:
 			return va_arg(valist->valist, ptrdiff_t*);
 			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			// PASS-THROUGH
+		case LENGTH_w128:
+			return pop_width_n_pointer(valist, fs->length);
+			break;
 		default:
 		    // Should never be called, means an error elsewhere in the code.
 			break;
@@ -573,15 +756,622 @@ void* pop_or_load_n_pointer(const format_specifier *fs, va_list_s *valist,
 
 
 
+// Either pops the argument of a registered conversion off the valist, or if 
+// we are using positional arguments loads it from memory. It is read as the 
+// conversion's argument type says. va_list may be NULL if using_positions, 
+// positional_items may be NULL if not using_positions.
+// Parameters:
+//     fs - The format specifier for what to pop, of TYPE_custom.
+//     valist - Struct holding a va_list for us to pop off of.
+//     using_positions - Whether we pop or load from memory.
+//     positional_items - Array holding information about previously popped
+//         items stored in memory, when using_positions = true.
+//     argument - Where to store the argument.
+// Returns:
+//     argument - Holds the value popped or loaded, tagged with its type.
+void pop_or_load_custom(const format_specifier *fs, va_list_s *valist, 
+						bool using_positions, 
+						positional_info *positional_items, printf_arg *argument)
+{
+	argument->type = fs->custom->argument;
+	argument->length = fs->length;
+	switch (fs->custom->argument) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			argument->value.integer = pop_or_load_integer(fs, valist, 
+											using_positions, positional_items);
+			break;
+		case TYPE_c:
+			argument->value.unsigned_integer = pop_or_load_character(fs, 
+									valist, using_positions, positional_items);
+			break;
+		case TYPE_s:
+			argument->value.string = pop_or_load_string(fs, valist, 
+											using_positions, positional_items);
+			break;
+		case TYPE_p:
+			argument->value.pointer = pop_or_load_pointer(fs, valist, 
+											using_positions, positional_items);
+			break;
+		default:
+			argument->value.unsigned_integer = pop_or_load_unsigned_integer(
+								fs, valist, using_positions, positional_items);
+			break;
+	}
+}
+
+
+
+// Loads a signed integer from a tagged argument, converting it to the length
+// in fs as pop_or_load_integer does.
+// Parameters:
+//     fs - The format specifier for what to load.
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold an integer.
+bool load_argv_integer(const format_specifier *fs, const printf_arg *arg, 
+					   intmax_t *value)
+{
+	intmax_t raw = 0;
+	
+	if (!argv_is_integer(arg)) {
+		return false;
+	}
+	if (argv_is_signed(arg)) {
+		raw = arg->value.integer;
+	} else {
+		raw = (intmax_t) arg->value.unsigned_integer;
+	}
+	
+	switch (fs->length) {
+		case LENGTH_none:
+			*value = (int) raw;
+			break;
+		case LENGTH_hh:
+			*value = (signed char) raw;
+			break;
+		case LENGTH_h:
+			*value = (short) raw;
+			break;
+		case LENGTH_l:
+			*value = (long int) raw;
+			break;
+		case LENGTH_ll:
+			*value = (long long int) raw;
+			break;
+		case LENGTH_z:
+			*value = (size_t) raw;
+			break;
+		case LENGTH_t:
+			*value = (ptrdiff_t) raw;
+			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			*value = truncate_width_integer(raw, fs->length);
+			break;
+		default:
+			*value = raw;
+			break;
+	}
+	return true;
+}
+
+
+
+// Loads an unsigned integer from a tagged argument, converting it to the 
+// length in fs as pop_or_load_unsigned_integer does.
+// Parameters:
+//     fs - The format specifier for what to load.
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold an integer.
+bool load_argv_unsigned_integer(const format_specifier *fs, 
+								const printf_arg *arg, uintmax_t *value)
+{
+	uintmax_t raw = 0;
+	
+	if (!argv_is_integer(arg)) {
+		return false;
+	}
+	if (argv_is_signed(arg)) {
+		raw = (uintmax_t) arg->value.integer;
+	} else {
+		raw = arg->value.unsigned_integer;
+	}
+	
+	switch (fs->length) {
+		case LENGTH_none:
+			*value = (unsigned int) raw;
+			break;
+		case LENGTH_hh:
+			*value = (unsigned char) raw;
+			break;
+		case LENGTH_h:
+			*value = (unsigned short) raw;
+			break;
+		case LENGTH_l:
+			*value = (unsigned long int) raw;
+			break;
+		case LENGTH_ll:
+			*value = (unsigned long long int) raw;
+			break;
+		case LENGTH_z:
+			*value = (size_t) raw;
+			break;
+		case LENGTH_t:
+			*value = (size_t) (ptrdiff_t) raw;
+			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			*value = truncate_width_unsigned_integer(raw, fs->length);
+			break;
+		default:
+			*value = raw;
+			break;
+	}
+	return true;
+}
+
+
+
+// Loads a character from a tagged argument.
+// Parameters:
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold an integer.
+bool load_argv_character(const printf_arg *arg, uintmax_t *value)
+{
+	if (!argv_is_integer(arg)) {
+		return false;
+	}
+	if (argv_is_signed(arg)) {
+		*value = (unsigned char) arg->value.integer;
+	} else {
+		*value = (unsigned char) arg->value.unsigned_integer;
+	}
+	return true;
+}
+
+
+
+// Loads a string from a tagged argument.
+// Parameters:
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold a string.
+bool load_argv_string(const printf_arg *arg, const char **value)
+{
+	if (arg->type != TYPE_s) {
+		return false;
+	}
+	*value = arg->value.string;
+	return true;
+}
+
+
+
+// Loads a pointer from a tagged argument, for "%p". Strings are pointers too.
+// Parameters:
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold a pointer.
+bool load_argv_pointer(const printf_arg *arg, void **value)
+{
+	if (arg->type == TYPE_s) {
+		*value = (void*) arg->value.string;
+	} else if (arg->type == TYPE_p || arg->type == TYPE_n) {
+		*value = arg->value.pointer;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+
+// Loads a pointer for "%n" from a tagged argument.
+// Parameters:
+//     fs - The format specifier for what to load.
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold a "%n" pointer of the length
+//     in fs.
+bool load_argv_n_pointer(const format_specifier *fs, const printf_arg *arg, 
+						 void **value)
+{
+	if (arg->type != TYPE_n || arg->length != fs->length) {
+		return false;
+	}
+	*value = arg->value.pointer;
+	return true;
+}
+
+
+
+// Loads a '*' width or precision from a tagged argument.
+// Parameters:
+//     arg - The tagged argument.
+//     value - Where to store the value.
+// Returns:
+//     true on success, false if arg doesn't hold an integer.
+bool load_argv_width_precision(const printf_arg *arg, int *value)
+{
+	if (!argv_is_integer(arg)) {
+		return false;
+	}
+	if (argv_is_signed(arg)) {
+		*value = (int) arg->value.integer;
+	} else {
+		*value = (int) arg->value.unsigned_integer;
+	}
+	return true;
+}
+
+
+
+// Loads the argument of a registered conversion from a tagged argument, as 
+// the conversion's argument type says.
+// Parameters:
+//     fs - The format specifier for what to load, of TYPE_custom.
+//     arg - The tagged argument.
+//     argument - Where to store the argument.
+// Returns:
+//     true on success, false if arg doesn't hold the right type.
+bool load_argv_custom(const format_specifier *fs, const printf_arg *arg, 
+					  printf_arg *argument)
+{
+	const char *string_value = NULL;
+
+	argument->type = fs->custom->argument;
+	argument->length = fs->length;
+	switch (fs->custom->argument) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			return load_argv_integer(fs, arg, &argument->value.integer);
+		case TYPE_c:
+			return load_argv_character(arg, &argument->value.unsigned_integer);
+		case TYPE_s:
+			if (!load_argv_string(arg, &string_value)) {
+				return false;
+			}
+			argument->value.string = string_value;
+			return true;
+		case TYPE_p:
+			return load_argv_pointer(arg, &argument->value.pointer);
+		default:
+			return load_argv_unsigned_integer(
+				fs, arg, &argument->value.unsigned_integer);
+	}
+}
+
+
+
+// Whether a tagged argument holds an integer.
+// Parameters:
+//     arg - The tagged argument.
+// Returns:
+//     true if it does, false if not.
+static bool argv_is_integer(const printf_arg *arg)
+{
+	return (argv_is_signed(arg) || arg->type == TYPE_u || 
+			arg->type == TYPE_o || arg->type == TYPE_x || 
+			arg->type == TYPE_X || arg->type == TYPE_b || 
+			arg->type == TYPE_B
+			);
+}
+
+
+
+// Whether a tagged argument holds a signed integer, in value.integer.
+// Parameters:
+//     arg - The tagged argument.
+// Returns:
+//     true if it does, false if not.
+static bool argv_is_signed(const printf_arg *arg)
+{
+	return (arg->type == TYPE_d || arg->type == TYPE_i || 
+			arg->type == TYPE_c
+			);
+}
+
+
+
+// Pops a "%wNd" or "%wfNd" integer off the valist. Types narrower than int 
+// were promoted to int, so are popped as int and converted back.
+// Parameters:
+//     valist - Struct holding a va_list for us to pop off of.
+//     length - The length, LENGTH_w8 to LENGTH_wf64.
+// Returns:
+//     The value popped.
+static intmax_t pop_width_integer(va_list_s *valist, 
+								  format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_w8:
+			return (int8_t) va_arg(valist->valist, int);
+		case LENGTH_w16:
+			return (int16_t) va_arg(valist->valist, int);
+		case LENGTH_w32:
+			return va_arg(valist->valist, int32_t);
+		case LENGTH_w64:
+			return va_arg(valist->valist, int64_t);
+		case LENGTH_wf8:
+#if INT_FAST8_MAX <= INT_MAX
+			return (int_fast8_t) va_arg(valist->valist, int);
+#else
+			return va_arg(valist->valist, int_fast8_t);
+#endif
+		case LENGTH_wf16:
+#if INT_FAST16_MAX <= INT_MAX
+			return (int_fast16_t) va_arg(valist->valist, int);
+#else
+			return va_arg(valist->valist, int_fast16_t);
+#endif
+		case LENGTH_wf32:
+#if INT_FAST32_MAX <= INT_MAX
+			return (int_fast32_t) va_arg(valist->valist, int);
+#else
+			return va_arg(valist->valist, int_fast32_t);
+#endif
+		case LENGTH_wf64:
+			return va_arg(valist->valist, int_fast64_t);
+		default:
+			// Should never be called, means an error elsewhere in the code.
+			break;
+	}
+	return 0;
+}
+
+
+
+// Pops a "%wNu" or "%wfNu" integer off the valist, as pop_width_integer.
+// Parameters:
+//     valist - Struct holding a va_list for us to pop off of.
+//     length - The length, LENGTH_w8 to LENGTH_wf64.
+// Returns:
+//     The value popped.
+static uintmax_t pop_width_unsigned_integer(va_list_s *valist, 
+											format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_w8:
+			return (uint8_t) va_arg(valist->valist, unsigned int);
+		case LENGTH_w16:
+			return (uint16_t) va_arg(valist->valist, unsigned int);
+		case LENGTH_w32:
+			return va_arg(valist->valist, uint32_t);
+		case LENGTH_w64:
+			return va_arg(valist->valist, uint64_t);
+		case LENGTH_wf8:
+#if UINT_FAST8_MAX <= UINT_MAX
+			return (uint_fast8_t) va_arg(valist->valist, unsigned int);
+#else
+			return va_arg(valist->valist, uint_fast8_t);
+#endif
+		case LENGTH_wf16:
+#if UINT_FAST16_MAX <= UINT_MAX
+			return (uint_fast16_t) va_arg(valist->valist, unsigned int);
+#else
+			return va_arg(valist->valist, uint_fast16_t);
+#endif
+		case LENGTH_wf32:
+#if UINT_FAST32_MAX <= UINT_MAX
+			return (uint_fast32_t) va_arg(valist->valist, unsigned int);
+#else
+			return va_arg(valist->valist, uint_fast32_t);
+#endif
+		case LENGTH_wf64:
+			return va_arg(valist->valist, uint_fast64_t);
+		default:
+			// Should never be called, means an error elsewhere in the code.
+			break;
+	}
+	return 0;
+}
+
+
+
+// Pops a "%wNn" or "%wfNn" pointer off the valist.
+// Parameters:
+//     valist - Struct holding a va_list for us to pop off of.
+//     length - The length, LENGTH_w8 to LENGTH_wf64.
+// Returns:
+//     The pointer popped as void*.
+static void* pop_width_n_pointer(va_list_s *valist, 
+								 format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_w8:
+			return va_arg(valist->valist, int8_t*);
+		case LENGTH_w16:
+			return va_arg(valist->valist, int16_t*);
+		case LENGTH_w32:
+			return va_arg(valist->valist, int32_t*);
+		case LENGTH_w64:
+			return va_arg(valist->valist, int64_t*);
+		case LENGTH_wf8:
+			return va_arg(valist->valist, int_fast8_t*);
+		case LENGTH_wf16:
+			return va_arg(valist->valist, int_fast16_t*);
+		case LENGTH_wf32:
+			return va_arg(valist->valist, int_fast32_t*);
+		case LENGTH_wf64:
+			return va_arg(valist->valist, int_fast64_t*);
+#ifdef PRINTF_INT128
+		case LENGTH_w128:
+			return va_arg(valist->valist, printf_int128*);
+#endif
+		default:
+			// Should never be called, means an error elsewhere in the code.
+			break;
+	}
+	return NULL;
+}
+
+
+
+#ifdef PRINTF_DECIMAL_FLOAT
+// The decimal types are only standard from C2X, so named once here as an 
+// extension, as printf_int128 is.
+__extension__ typedef _Decimal32 printf_decimal32;
+__extension__ typedef _Decimal64 printf_decimal64;
+__extension__ typedef _Decimal128 printf_decimal128;
+
+
+
+// Pops a "%Hf", "%Df" or "%DDf" decimal floating point number off the valist.
+// _Decimal32 isn't promoted when passed to printf, so it is popped as itself.
+// Parameters:
+//     valist - Struct holding a va_list for us to pop off of.
+//     length - The length, LENGTH_H, LENGTH_D or LENGTH_DD.
+// Returns:
+//     The BID encoding of the value, in the low 32, 64 or 128 bits.
+static printf_uint128 pop_decimal_floating_point(va_list_s *valist, 
+											format_string_lengths length)
+{
+	printf_decimal32 value32;
+	printf_decimal64 value64;
+	printf_decimal128 value128;
+	uint32_t bits32 = 0;
+	uint64_t bits64 = 0;
+	printf_uint128 bits128 = 0;
+
+	switch (length) {
+		case LENGTH_H:
+			value32 = va_arg(valist->valist, printf_decimal32);
+			memcpy(&bits32, &value32, sizeof(bits32));
+			return bits32;
+		case LENGTH_D:
+			value64 = va_arg(valist->valist, printf_decimal64);
+			memcpy(&bits64, &value64, sizeof(bits64));
+			return bits64;
+		case LENGTH_DD:
+			value128 = va_arg(valist->valist, printf_decimal128);
+			memcpy(&bits128, &value128, sizeof(bits128));
+			return bits128;
+		default:
+			// Should never be called, means an error elsewhere in the code.
+			break;
+	}
+	return 0;
+}
+#endif
+
+
+
+// Converts an integer to a "%wNd" or "%wfNd" length, for tagged arguments.
+// Parameters:
+//     value - The integer.
+//     length - The length, LENGTH_w8 to LENGTH_wf64.
+// Returns:
+//     The value converted.
+static intmax_t truncate_width_integer(intmax_t value, 
+									   format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_w8:
+			return (int8_t) value;
+		case LENGTH_w16:
+			return (int16_t) value;
+		case LENGTH_w32:
+			return (int32_t) value;
+		case LENGTH_w64:
+			return (int64_t) value;
+		case LENGTH_wf8:
+			return (int_fast8_t) value;
+		case LENGTH_wf16:
+			return (int_fast16_t) value;
+		case LENGTH_wf32:
+			return (int_fast32_t) value;
+		case LENGTH_wf64:
+			return (int_fast64_t) value;
+		default:
+			break;
+	}
+	return value;
+}
+
+
+
+// Converts an integer to a "%wNu" or "%wfNu" length, for tagged arguments.
+// Parameters:
+//     value - The integer.
+//     length - The length, LENGTH_w8 to LENGTH_wf64.
+// Returns:
+//     The value converted.
+static uintmax_t truncate_width_unsigned_integer(uintmax_t value, 
+												format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_w8:
+			return (uint8_t) value;
+		case LENGTH_w16:
+			return (uint16_t) value;
+		case LENGTH_w32:
+			return (uint32_t) value;
+		case LENGTH_w64:
+			return (uint64_t) value;
+		case LENGTH_wf8:
+			return (uint_fast8_t) value;
+		case LENGTH_wf16:
+			return (uint_fast16_t) value;
+		case LENGTH_wf32:
+			return (uint_fast32_t) value;
+		case LENGTH_wf64:
+			return (uint_fast64_t) value;
+		default:
+			break;
+	}
+	return value;
+}
+
+
+
 // Pops an integer off the valist and stores it in the positional_info.
 // Parameters:
 //     current_item - A positional_info item in the relevant place in the
 //         positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_integer(positional_info *current_item, 
-								  va_list_s *valist)
+								  va_list_s *valist, 
+								  const printf_allocator *allocator)
 {
 	int *p_int;
     long int *p_l_int;
@@ -589,6 +1379,9 @@ static bool pop_and_store_integer(positional_info *current_item,
     intmax_t *p_intmax;
     size_t *p_size;
     ptrdiff_t *p_ptrdiff;
+#ifdef PRINTF_INT128
+	printf_int128 *p_int128;
+#endif
 	
 	switch (current_item->length) {
 		case LENGTH_none:
@@ -596,7 +1389,7 @@ static bool pop_and_store_integer(positional_info *current_item,
 		case LENGTH_hh:
 			// PASS-THROUGH
 		case LENGTH_h:
-			p_int = malloc(sizeof(int));
+			p_int = printf_allocate(allocator, sizeof(int));
 			if (p_int == NULL) {
 				return false;
 			}
@@ -604,7 +1397,7 @@ static bool pop_and_store_integer(positional_info *current_item,
 			current_item->item = (void*) p_int;
 			break;
 		case LENGTH_l:
-			p_l_int = malloc(sizeof(long int));
+			p_l_int = printf_allocate(allocator, sizeof(long int));
 			if (p_l_int == NULL) {
 				return false;
 			}
@@ -612,7 +1405,7 @@ static bool pop_and_store_integer(positional_info *current_item,
 			current_item->item = (void*) p_l_int;
 			break;
 		case LENGTH_ll:
-			p_ll_int = malloc(sizeof(long long int));
+			p_ll_int = printf_allocate(allocator, sizeof(long long int));
 			if (p_ll_int == NULL) {
 				return false;
 			}
@@ -620,7 +1413,7 @@ static bool pop_and_store_integer(positional_info *current_item,
 			current_item->item = (void*) p_ll_int;
 			break;
 		case LENGTH_j:
-			p_intmax = malloc(sizeof(intmax_t));
+			p_intmax = printf_allocate(allocator, sizeof(intmax_t));
 			if (p_intmax == NULL) {
 				return false;
 			}
@@ -628,7 +1421,7 @@ static bool pop_and_store_integer(positional_info *current_item,
 			current_item->item = (void*) p_intmax;
 			break;
 		case LENGTH_z:
-			p_size = malloc(sizeof(size_t));
+			p_size = printf_allocate(allocator, sizeof(size_t));
 			if (p_size == NULL) {
 				return false;
 			}
@@ -636,13 +1429,45 @@ static bool pop_and_store_integer(positional_info *current_item,
 			current_item->item = (void*) p_size;
 			break;
 		case LENGTH_t:
-			p_ptrdiff = malloc(sizeof(ptrdiff_t));
+			p_ptrdiff = printf_allocate(allocator, sizeof(ptrdiff_t));
 			if (p_ptrdiff == NULL) {
 				return false;
 			}
 			*p_ptrdiff = va_arg(valist->valist, ptrdiff_t);
 			current_item->item = (void*) p_ptrdiff;
 			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			p_intmax = printf_allocate(allocator, sizeof(intmax_t));
+			if (p_intmax == NULL) {
+				return false;
+			}
+			*p_intmax = pop_width_integer(valist, current_item->length);
+			current_item->item = (void*) p_intmax;
+			break;
+#ifdef PRINTF_INT128
+		case LENGTH_w128:
+			p_int128 = printf_allocate(allocator, sizeof(printf_int128));
+			if (p_int128 == NULL) {
+				return false;
+			}
+			*p_int128 = va_arg(valist->valist, printf_int128);
+			current_item->item = (void*) p_int128;
+			break;
+#endif
 		default:
 			// This should never be called.
 			return false;
@@ -658,10 +1483,12 @@ static bool pop_and_store_integer(positional_info *current_item,
 //     current_item - A positional_info item in the relevant place in the 
 //         positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_unsigned_integer(positional_info *current_item, 
-										   va_list_s *valist)
+										   va_list_s *valist, 
+										   const printf_allocator *allocator)
 {
 	size_t *p_size;
     ptrdiff_t *p_ptrdiff;
@@ -669,6 +1496,9 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
     unsigned long int *p_l_uint;
     unsigned long long int *p_ll_uint; 
     uintmax_t *p_uintmax;
+#ifdef PRINTF_INT128
+	printf_uint128 *p_uint128;
+#endif
 	
 	// Determine the right type to get.
 	switch (current_item->length) {
@@ -677,7 +1507,7 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 		case LENGTH_hh:
 			// PASS-THROUGH
 		case LENGTH_h:
-			p_uint = malloc(sizeof(unsigned int));
+			p_uint = printf_allocate(allocator, sizeof(unsigned int));
 			if (p_uint == NULL) {
 				return false;
 			}
@@ -685,7 +1515,7 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 			current_item->item = (void*) p_uint;
 			break;
 		case LENGTH_l:
-			p_l_uint = malloc(sizeof(unsigned long int));
+			p_l_uint = printf_allocate(allocator, sizeof(unsigned long int));
 			if (p_l_uint == NULL) {
 				return false;
 			}
@@ -693,7 +1523,8 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 			current_item->item = (void*) p_l_uint;
 			break;
 		case LENGTH_ll:
-			p_ll_uint = malloc(sizeof(unsigned long long int));
+			p_ll_uint = printf_allocate(allocator, 
+										sizeof(unsigned long long int));
 			if (p_ll_uint == NULL) {
 				return false;
 			}
@@ -701,7 +1532,7 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 			current_item->item = (void*) p_ll_uint;
 			break;
 		case LENGTH_j:
-			p_uintmax = malloc(sizeof(uintmax_t));
+			p_uintmax = printf_allocate(allocator, sizeof(uintmax_t));
 			if (p_uintmax == NULL) {
 				return false;
 			}
@@ -709,7 +1540,7 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 			current_item->item = (void*) p_uintmax;
 			break;
 		case LENGTH_z:
-			p_size = malloc(sizeof(size_t));
+			p_size = printf_allocate(allocator, sizeof(size_t));
 			if (p_size == NULL) {
 				return false;
 			}
@@ -717,13 +1548,46 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 			current_item->item = (void*) p_size;
 			break;
 		case LENGTH_t:
-			p_ptrdiff = malloc(sizeof(ptrdiff_t));
+			p_ptrdiff = printf_allocate(allocator, sizeof(ptrdiff_t));
 			if (p_ptrdiff == NULL) {
 				return false;
 			}
 			*p_ptrdiff = va_arg(valist->valist, ptrdiff_t);
 			current_item->item = (void*) p_ptrdiff;
 			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			p_uintmax = printf_allocate(allocator, sizeof(uintmax_t));
+			if (p_uintmax == NULL) {
+				return false;
+			}
+			*p_uintmax = pop_width_unsigned_integer(valist, 
+													current_item->length);
+			current_item->item = (void*) p_uintmax;
+			break;
+#ifdef PRINTF_INT128
+		case LENGTH_w128:
+			p_uint128 = printf_allocate(allocator, sizeof(printf_uint128));
+			if (p_uint128 == NULL) {
+				return false;
+			}
+			*p_uint128 = va_arg(valist->valist, printf_uint128);
+			current_item->item = (void*) p_uint128;
+			break;
+#endif
 		default:
 			// This should never be called.
 			return false;
@@ -740,17 +1604,22 @@ static bool pop_and_store_unsigned_integer(positional_info *current_item,
 //     current_item - A positional_info item in the relevant place in the
 //         positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_floating_point(positional_info *current_item, 
-										 va_list_s *valist)
+										 va_list_s *valist, 
+										 const printf_allocator *allocator)
 {
 	double *p_double;
 	long double *p_l_double;
+#ifdef PRINTF_DECIMAL_FLOAT
+	printf_uint128 *p_decimal;
+#endif
 	
 	switch (current_item->length) {
 		case LENGTH_none:
-			p_double = malloc(sizeof(double));
+			p_double = printf_allocate(allocator, sizeof(double));
 			if (p_double == NULL) {
 				return false;
 			}
@@ -758,13 +1627,29 @@ static bool pop_and_store_floating_point(positional_info *current_item,
 			current_item->item = (void*) p_double;
 			break;
 		case LENGTH_L:
-			p_l_double = malloc(sizeof(long double));
+			p_l_double = printf_allocate(allocator, sizeof(long double));
 			if (p_l_double == NULL) {
 				return false;
 			}
 			*p_l_double = va_arg(valist->valist, double);
 			current_item->item = (void*) p_l_double;
 			break;
+#ifdef PRINTF_DECIMAL_FLOAT
+		case LENGTH_H:
+			// PASS-THROUGH
+		case LENGTH_D:
+			// PASS-THROUGH
+		case LENGTH_DD:
+			// Stored as its encoding, for pop_or_load_decimal_floating_point.
+			p_decimal = printf_allocate(allocator, sizeof(printf_uint128));
+			if (p_decimal == NULL) {
+				return false;
+			}
+			*p_decimal = pop_decimal_floating_point(valist, 
+													current_item->length);
+			current_item->item = (void*) p_decimal;
+			break;
+#endif
 		default:
 			// This should never be called.
 			return false;
@@ -780,12 +1665,14 @@ static bool pop_and_store_floating_point(positional_info *current_item,
 //     current_item - A positional_info item in the relevant place in
 //         the positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_character(positional_info *current_item, 
-									va_list_s *valist)
+									va_list_s *valist, 
+									const printf_allocator *allocator)
 {
-	int *p_int = malloc(sizeof(int));
+	int *p_int = printf_allocate(allocator, sizeof(int));
 	if (p_int == NULL) {
 		return false;
 	}
@@ -801,12 +1688,14 @@ static bool pop_and_store_character(positional_info *current_item,
 //     current_item - A positional_info item in the relevant place in
 //         the positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_pointer(positional_info *current_item, 
-								  va_list_s *valist)
+								  va_list_s *valist, 
+								  const printf_allocator *allocator)
 {
-	void **pp_void = malloc(sizeof(void*));
+	void **pp_void = printf_allocate(allocator, sizeof(void*));
 	if (pp_void == NULL) {
 		return false;
 	}
@@ -822,12 +1711,14 @@ static bool pop_and_store_pointer(positional_info *current_item,
 //     current_item - A positional_info item in the relevant place in
 //         the positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_string(positional_info *current_item, 
-								 va_list_s *valist)
+								 va_list_s *valist, 
+								 const printf_allocator *allocator)
 {
-	char **pp_char = malloc(sizeof(char*));
+	char **pp_char = printf_allocate(allocator, sizeof(char*));
 	if (pp_char == NULL) {
 		return false;
 	}
@@ -843,10 +1734,12 @@ static bool pop_and_store_string(positional_info *current_item,
 //     current_item - A positional_info item in the relevant place in
 //         the positional_info_array.
 //     valist - Struct holding a va_list for us to pop off of.
+//     allocator - Where to get the memory to store it in.
 // Returns:
 //     true on success, false on failure.
 static bool pop_and_store_n_pointer(positional_info *current_item, 
-									va_list_s *valist)
+									va_list_s *valist, 
+									const printf_allocator *allocator)
 {
 	signed char **pp_char;
 	short **pp_short;
@@ -856,11 +1749,12 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
     intmax_t **pp_intmax;
     size_t **pp_size;
     ptrdiff_t **pp_ptrdiff;
+	void **pp_width;
 	
 	
 	switch (current_item->length) {
 		case LENGTH_none:
-			pp_int = malloc(sizeof(int*));
+			pp_int = printf_allocate(allocator, sizeof(int*));
 			if (pp_int == NULL) {
 				return false;
 			}
@@ -868,7 +1762,7 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_int;
 			break;
 		case LENGTH_hh:
-			pp_char = malloc(sizeof(signed char*));
+			pp_char = printf_allocate(allocator, sizeof(signed char*));
 			if (pp_char == NULL) {
 				return false;
 			}
@@ -876,7 +1770,7 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_char;
 			break;
 		case LENGTH_h:
-			pp_short = malloc(sizeof(short*));
+			pp_short = printf_allocate(allocator, sizeof(short*));
 			if (pp_short == NULL) {
 				return false;
 			}
@@ -884,7 +1778,7 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_short;
 			break;
 		case LENGTH_l:
-			pp_l_int = malloc(sizeof(long int*));
+			pp_l_int = printf_allocate(allocator, sizeof(long int*));
 			if (pp_l_int == NULL) {
 				return false;
 			}
@@ -892,7 +1786,7 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_l_int;
 			break;
 		case LENGTH_ll:
-			pp_ll_int = malloc(sizeof(long long int*));
+			pp_ll_int = printf_allocate(allocator, sizeof(long long int*));
 			if (pp_ll_int == NULL) {
 				return false;
 			}
@@ -900,7 +1794,7 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_ll_int;
 			break;
 		case LENGTH_j:
-			pp_intmax = malloc(sizeof(intmax_t*));
+			pp_intmax = printf_allocate(allocator, sizeof(intmax_t*));
 			if (pp_intmax == NULL) {
 				return false;
 			}
@@ -908,7 +1802,7 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_intmax;
 			break;
 		case LENGTH_z:
-			pp_size = malloc(sizeof(size_t*));
+			pp_size = printf_allocate(allocator, sizeof(size_t*));
 			if (pp_size == NULL) {
 				return false;
 			}
@@ -916,13 +1810,37 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 			current_item->item = (void*) pp_size;
 			break;
 		case LENGTH_t:
-			pp_ptrdiff = malloc(sizeof(ptrdiff_t*));
+			pp_ptrdiff = printf_allocate(allocator, sizeof(ptrdiff_t*));
 			if (pp_ptrdiff == NULL) {
 				return false;
 			}
 			*pp_ptrdiff = va_arg(valist->valist, ptrdiff_t*);
 			current_item->item = (void*) pp_ptrdiff;
 			break;
+		case LENGTH_w8:
+			// PASS-THROUGH
+		case LENGTH_w16:
+			// PASS-THROUGH
+		case LENGTH_w32:
+			// PASS-THROUGH
+		case LENGTH_w64:
+			// PASS-THROUGH
+		case LENGTH_wf8:
+			// PASS-THROUGH
+		case LENGTH_wf16:
+			// PASS-THROUGH
+		case LENGTH_wf32:
+			// PASS-THROUGH
+		case LENGTH_wf64:
+			// PASS-THROUGH
+		case LENGTH_w128:
+			pp_width = printf_allocate(allocator, sizeof(void*));
+			if (pp_width == NULL) {
+				return false;
+			}
+			*pp_width = pop_width_n_pointer(valist, current_item->length);
+			current_item->item = (void*) pp_width;
+			break;
 		default:
 			// This should never be called.
 			return false;
@@ -939,13 +1857,27 @@ static bool pop_and_store_n_pointer(positional_info *current_item,
 //     count - The number of items parsed.
 void pop_and_store_cleanup(positional_info_array *pia, int count)          
 {
-	for (int i = 0; i < count - 1; i++) {
-		free((pia->array + i)->item);
+	for (int i = 0; i < count; i++) {
+		printf_deallocate(pia->allocator, (pia->array + i)->item);
+		(pia->array + i)->item = NULL;
 	}
 }
 
 
 
+// Frees the array of a positional_info_array. Items stored in it must already 
+// have been freed with pop_and_store_cleanup.
+// Parameters:
+//     pia - The positional_info_array to free.
+void pia_free(positional_info_array *pia)
+{
+	printf_deallocate(pia->allocator, pia->array);
+	pia->array = NULL;
+	pia->size = 0;
+}
+
+
+
 // Debug function - Prints out a positional_info_array.
 // Parameters:
 //     items - A positional_info_array of parsed items.
@@ -987,6 +1919,42 @@ void print_positional_info_stuff(const positional_info *items, int count)
 			case LENGTH_L:
 				printf("L\n");
 				break;
+			case LENGTH_w8:
+				printf("w8\n");
+				break;
+			case LENGTH_w16:
+				printf("w16\n");
+				break;
+			case LENGTH_w32:
+				printf("w32\n");
+				break;
+			case LENGTH_w64:
+				printf("w64\n");
+				break;
+			case LENGTH_wf8:
+				printf("wf8\n");
+				break;
+			case LENGTH_wf16:
+				printf("wf16\n");
+				break;
+			case LENGTH_wf32:
+				printf("wf32\n");
+				break;
+			case LENGTH_wf64:
+				printf("wf64\n");
+				break;
+			case LENGTH_w128:
+				printf("w128\n");
+				break;
+			case LENGTH_H:
+				printf("H\n");
+				break;
+			case LENGTH_D:
+				printf("D\n");
+				break;
+			case LENGTH_DD:
+				printf("DD\n");
+				break;
 			default:
 				printf("Error\n");
 				break;
@@ -1011,6 +1979,12 @@ void print_positional_info_stuff(const positional_info *items, int count)
 			case TYPE_X:
 				printf("X\n");
 				break;
+			case TYPE_b:
+				printf("b\n");
+				break;
+			case TYPE_B:
+				printf("B\n");
+				break;
 			case TYPE_f:
 				printf("f\n");
 				break;
@@ -1082,7 +2056,9 @@ static bool pia_check_size_and_update(positional_info_array *pia,
 			current_size *= 2;
 		}
 		
-		new_array = realloc(pia->array, sizeof(positional_info) * current_size);
+		new_array = printf_reallocate(pia->allocator, pia->array, 
+									  sizeof(positional_info) * pia->size, 
+									  sizeof(positional_info) * current_size);
 		if (new_array == NULL) {
 			return false;
 		}
@@ -1105,12 +2081,13 @@ static bool pia_check_size_and_update(positional_info_array *pia,
 
 // Creates and initialises a new positional_info_array.
 // Parameters:
-//     pia - Pointer to the positional_info_array.
+//     pia - Pointer to the positional_info_array. Its allocator must be set.
 // Returns:
 //     true on success, false on failure.
 static bool pia_initialise(positional_info_array *pia)
 {		
-	pia->array = malloc(sizeof(positional_info) * DEFAULT_PIA_SIZE);
+	pia->array = printf_allocate(pia->allocator, 
+								 sizeof(positional_info) * DEFAULT_PIA_SIZE);
 	if (pia->array == NULL) {
 		return false;
 	}
@@ -1133,7 +2110,8 @@ static bool pia_initialise(positional_info_array *pia)
 // them in a list so we can pop off in positional order.
 // Parameters:
 //     format - The printf format string.
-//     pia - The positional_info_array to store the result in.
+//     pia - The positional_info_array to store the result in. Its allocator 
+//         must be set.
 //     max - Pointer to an int for the return of the number of 
 //         positions.
 // Returns:
@@ -1163,20 +2141,20 @@ bool parse_format_string_for_positions(const char* format,
             format_specifier fs;
             error = read_format_string(format, &fs);
             if (format_error_is_error(error)) {
-				free(pia->array);
+				pia_free(pia);
 				return false;
 			}
 			
 			// Make sure we are using positions.
             if (fs.position == 0) {
-				free(pia->array);
+				pia_free(pia);
 				return false;
 			}
             
             // Check preceding values. 
             if (fs.preceding_width != 0) {
 				if (!pia_check_size_and_update(pia, fs.preceding_width)) {
-					free(pia->array);
+					pia_free(pia);
 					return false;
 				}
 				current_item = pia->array + fs.preceding_width - 1;
@@ -1186,7 +2164,7 @@ bool parse_format_string_for_positions(const char* format,
 					if (current_item->type != TYPE_i ||
 						current_item->length != LENGTH_none)
 					{
-						free(pia->array);
+						pia_free(pia);
 						return false;
 					}
 				}
@@ -1200,7 +2178,7 @@ bool parse_format_string_for_positions(const char* format,
 			
 			if (fs.preceding_precision != 0) {
 				if (!pia_check_size_and_update(pia, fs.preceding_precision)) {
-					free(pia->array);
+					pia_free(pia);
 					return false;
 				}
 				current_item = pia->array + fs.preceding_width - 1;
@@ -1210,7 +2188,7 @@ bool parse_format_string_for_positions(const char* format,
 					if (current_item->type != TYPE_i ||
 						current_item->length != LENGTH_none)
 					{
-						free(pia->array);
+						pia_free(pia);
 						return false;
 					}
 				}
@@ -1225,21 +2203,22 @@ bool parse_format_string_for_positions(const char* format,
 			
 			// For printed type.
 			if (!pia_check_size_and_update(pia, fs.position)) {
-				free(pia->array);
+				pia_free(pia);
 				return false;
 			}
 			current_item = pia->array + fs.position - 1;
 			if (current_item->type != TYPE_ERROR) {
 				// This item has been used before. Check that its length
 				// and type match last time.
-				if (current_item->type != fs.type ||
+				if (current_item->type != format_string_argument_type(&fs) ||
 					current_item->length != fs.length)
 				{
-					free(pia->array);
+					pia_free(pia);
 					return false;
 				}
 			}
-			current_item->type = fs.type;
+			// Registered conversions are stored as what they read.
+			current_item->type = format_string_argument_type(&fs);
 			current_item->length = fs.length;
 			if (fs.position > max_found) {
 				max_found = fs.position;
@@ -1254,7 +2233,7 @@ bool parse_format_string_for_positions(const char* format,
 	for (int i = 0; i < max_found; i++) {
 		current_item = pia->array + i;
 		if (current_item->type == TYPE_ERROR) {
-			free(pia->array);
+			pia_free(pia);
 			return false;
 		}
 	}
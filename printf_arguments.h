@@ -11,6 +11,10 @@ intmax_t pop_or_load_integer(const format_specifier *fs, va_list_s *valist,
 					bool using_positions, positional_info *positional_items);
 uintmax_t pop_or_load_unsigned_integer(const format_specifier *fs, 
 	va_list_s *valist, bool using_positions, positional_info *positional_items);
+#ifdef PRINTF_INT128
+printf_uint128 pop_or_load_integer128(const format_specifier *fs, 
+	va_list_s *valist, bool using_positions, positional_info *positional_items);
+#endif
 uintmax_t pop_or_load_character(const format_specifier *fs, va_list_s *valist, 
 					bool using_positions, positional_info *positional_items);
 char* pop_or_load_string(const format_specifier *fs, va_list_s *valist, 
@@ -19,12 +23,34 @@ void* pop_or_load_pointer(const format_specifier *fs, va_list_s *valist,
 					bool using_positions, positional_info *positional_items);
 long double pop_or_load_floating_point(const format_specifier *fs, 
 	va_list_s *valist, bool using_positions, positional_info *positional_items);
+#ifdef PRINTF_DECIMAL_FLOAT
+printf_uint128 pop_or_load_decimal_floating_point(const format_specifier *fs, 
+	va_list_s *valist, bool using_positions, positional_info *positional_items);
+#endif
 int pop_or_load_width_precision(va_list_s *valist, bool using_positions, 
 							positional_info *positional_items, int position);
 void* pop_or_load_n_pointer(const format_specifier *fs, va_list_s *valist, 
 					bool using_positions, positional_info *positional_items);
+void pop_or_load_custom(const format_specifier *fs, va_list_s *valist, 
+						bool using_positions, 
+						positional_info *positional_items, 
+						printf_arg *argument);
+
+bool load_argv_integer(const format_specifier *fs, const printf_arg *arg, 
+					   intmax_t *value);
+bool load_argv_unsigned_integer(const format_specifier *fs, 
+								const printf_arg *arg, uintmax_t *value);
+bool load_argv_character(const printf_arg *arg, uintmax_t *value);
+bool load_argv_string(const printf_arg *arg, const char **value);
+bool load_argv_pointer(const printf_arg *arg, void **value);
+bool load_argv_n_pointer(const format_specifier *fs, const printf_arg *arg, 
+						 void **value);
+bool load_argv_width_precision(const printf_arg *arg, int *value);
+bool load_argv_custom(const format_specifier *fs, const printf_arg *arg, 
+					  printf_arg *argument);
 
 void pop_and_store_cleanup(positional_info_array *pia, int count);
+void pia_free(positional_info_array *pia);
 
 void print_positional_info_stuff(const positional_info *items, int count);
 
@@ -1,7 +1,8 @@
 // Part of printf function suite. Handles the output for most printf format
-// specifiers, namely "%d/i", "%x/X", "%o", "%p", "%s", "%c", "%n". Does not
-// include floating point output. Functions print according to the 
-// format_specifier structs given to them.
+// specifiers, namely "%d/i", "%x/X", "%o", "%b/B", "%p", "%s", "%c", "%n". 
+// Does not include floating point output. Functions print according to the 
+// format_specifier structs given to them. Decimal digits are grouped for the 
+// ' flag as printf_locale.c says.
 //
 // Copyright 2017 - Elliot Dawber. MIT licensed.
 
@@ -18,13 +19,32 @@
 
 #include "printf_definitions.h"
 #include "printf_basic_output.h"
+#include "printf_format.h"
+#include "printf_decimal.h"
+#include "printf_cpu.h"
+#include "printf_locale.h"
 
 char* base_conversion_small = "0123456789abcdef";
 char* base_conversion_capital = "0123456789ABCDEF";
 char* null_pointer_string = "(nil)";
 char* null_string_string = "(null)";
 
-#define BUFFER_SIZE 128
+// Room for 128 binary digits, or a 128 bit decimal number grouped with a 
+// separator between every digit.
+#define BUFFER_SIZE 256
+
+// The bits of each byte as characters, lowest bit first as the buffers here 
+// are written backwards, so "%b" can write 8 bits at a time.
+#define BINARY_BITS_1(s) "0" s, "1" s
+#define BINARY_BITS_2(s) BINARY_BITS_1("0" s), BINARY_BITS_1("1" s)
+#define BINARY_BITS_3(s) BINARY_BITS_2("0" s), BINARY_BITS_2("1" s)
+#define BINARY_BITS_4(s) BINARY_BITS_3("0" s), BINARY_BITS_3("1" s)
+#define BINARY_BITS_5(s) BINARY_BITS_4("0" s), BINARY_BITS_4("1" s)
+#define BINARY_BITS_6(s) BINARY_BITS_5("0" s), BINARY_BITS_5("1" s)
+#define BINARY_BITS_7(s) BINARY_BITS_6("0" s), BINARY_BITS_6("1" s)
+static const char binary_bytes[256][9] = {
+	BINARY_BITS_7("0"), BINARY_BITS_7("1")
+};
 
 
 
@@ -35,6 +55,14 @@ static int write_integer_backwards(char *buffer, uintmax_t value,
 
 static int strnlen_safe(const char* str, size_t max);
 
+static unsigned int binary_bit_length(uintmax_t value);
+
+static unsigned int group_backwards_buffer(char *buffer, unsigned int length);
+#ifdef PRINTF_INT128
+static int write_integer128_backwards(char *buffer, printf_uint128 value, 
+									  const format_specifier *fs);
+#endif
+
 
 static bool pad_output(output_specifier *output, int length, 
 					   char pad_character);
@@ -55,6 +83,8 @@ bool write_integer_positive(output_specifier *output, uintmax_t value,
 							format_specifier *fs);
 bool write_hexadecimal(output_specifier *output, uintmax_t value, 
 					   const format_specifier *fs);
+bool write_binary(output_specifier *output, uintmax_t value, 
+				  const format_specifier *fs);
 bool write_octal(output_specifier *output, uintmax_t value, 
 				 format_specifier *fs);
 bool write_string(output_specifier *output, const char *input, 
@@ -79,10 +109,22 @@ static bool write_backwards_buffer_with_padding(output_specifier *output,
 static bool write_backwards_buffer(output_specifier *output, const char *buffer, 
 								   int length) 
 {
-	for (int i = 0; i < length; i++) {
-		if (!printf_output(output, buffer[length - 1 - i])) {
+	// Holds a forwards copy of the buffer so we can output it as a span.
+	char forwards[BUFFER_SIZE];
+	int chunk = 0;
+	
+	while (length > 0) {
+		chunk = length;
+		if (chunk > BUFFER_SIZE) {
+			chunk = BUFFER_SIZE;
+		}
+		for (int i = 0; i < chunk; i++) {
+			forwards[i] = buffer[length - 1 - i];
+		}
+		if (!printf_output_span(output, forwards, chunk)) {
 			return false;
-		}	
+		}
+		length -= chunk;
 	}
 	return true;
 }
@@ -100,12 +142,7 @@ static bool write_backwards_buffer(output_specifier *output, const char *buffer,
 static bool write_forwards_buffer(output_specifier *output, const char *buffer, 
 								  int length) 
 {
-	for (int i = 0; i < length; i++) {
-		if (!printf_output(output, buffer[i])) {
-			return false;
-		}
-	}
-	return true;
+	return printf_output_span(output, buffer, length);
 }
 
 
@@ -212,18 +249,14 @@ static bool write_backwards_buffer_with_padding(output_specifier *output,
 
 // Finds the length of the string, or max, whichever is smaller. If max is 0 
 // then it is safe to call when str is NULL, which is not guaranteed by other 
-// strnlen definitions.
+// strnlen definitions. Uses the strnlen kernel printf_cpu picked.
 // Parameters:
 //     str - The string to find the length of.
 //     max - The maximum number of characters in str to read.
 // Returns:
 //     The length of the string, or max, whichever is smaller.
 static int strnlen_safe(const char* str, size_t max) {
-    size_t count = 0;
-    while (count < max && *str++) {
-        count++;
-    }
-    return count;
+    return printf_cpu()->strnlen(str, max);
 }
 
 
@@ -371,6 +404,35 @@ bool write_characters_written(output_specifier *output, void *pointer,
 			p_ptrdiff = (ptrdiff_t*) pointer;
 			*p_ptrdiff = output->characters_written;
 			break;
+		case LENGTH_w8:
+			*((int8_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_w16:
+			*((int16_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_w32:
+			*((int32_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_w64:
+			*((int64_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_wf8:
+			*((int_fast8_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_wf16:
+			*((int_fast16_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_wf32:
+			*((int_fast32_t*) pointer) = output->characters_written;
+			break;
+		case LENGTH_wf64:
+			*((int_fast64_t*) pointer) = output->characters_written;
+			break;
+#ifdef PRINTF_INT128
+		case LENGTH_w128:
+			*((printf_int128*) pointer) = output->characters_written;
+			break;
+#endif
 		default:
 			// Note: this should never be reached, any errors should have been 
 			// caught earlier.
@@ -520,6 +582,152 @@ bool write_hexadecimal(output_specifier *output, uintmax_t value,
 
 
 
+// Writes out the value as a binary number to our output according to the 
+// options in the format specifier. This is for "%b". Rather than dividing, 
+// the number of bits is found from the highest set bit and they are written 
+// 8 at a time from a table.
+// Parameters:
+//     output - Where we should output to.
+//     value - The value to write out.
+//     fs - The format specifier for how we should write it.
+// Returns:
+//     true on success, false on error.
+bool write_binary(output_specifier *output, uintmax_t value, 
+				  const format_specifier *fs) 
+{
+	// Buffer for holding it backwards.
+	char buffer[BUFFER_SIZE];
+	// The length of our buffer.
+	unsigned int length = 0;
+	// The length of our buffer, or it padded, which ever is longer.
+	unsigned int precision_length = 0;
+	// Amount to pad with ' '/'0'.
+	unsigned int padding_amount = 0;
+	// Amount to pad our number to match precision.
+	unsigned int precision_padding = 0;
+	// Prefix characters.
+	char zero_char = 0;
+	char b_char = 0;
+	
+	// Determine prefix characters. Unlike "%#x", 0 has no prefix, as C23 
+	// says.
+	if (fs->alternate_form && value != 0) {
+		if (fs->type == TYPE_B) {
+			b_char = 'B';
+		} else {
+			b_char = 'b';
+		}
+		zero_char = '0';
+	}
+	
+	// Write it backwards into our buffer, whole bytes at a time, then cut it 
+	// down to the bits there are.
+	// For precision and value of 0 we print nothing, not '0'.
+	if (fs->precision == 0 && value == 0) {
+		length = 0;
+	} else {
+		length = binary_bit_length(value);
+		for (unsigned int i = 0; i < length; i += 8) {
+			memcpy(buffer + i, binary_bytes[(value >> i) & 0xff], 8);
+		}
+	}
+	
+	// Determine if we need to pad our number up to precision.
+	if (fs->precision == -1) {
+		precision_length = length;
+	} else {
+		if ((unsigned int) fs->precision > length) {
+			precision_length = fs->precision;
+			precision_padding = fs->precision - length;
+		} else {
+			precision_length = length;
+		}
+	}
+	
+	// Determine if we need to pad our number up to width.
+	if (zero_char != 0) {
+		if (fs->width > precision_length + 2) {
+			padding_amount = fs->width - precision_length - 2;
+		}
+	} else {
+		if (fs->width > precision_length) {
+			padding_amount = fs->width - precision_length;
+		}
+	}
+	
+	return write_backwards_buffer_with_padding(output, buffer, length, fs, 
+						zero_char, b_char, padding_amount, precision_padding);
+}
+
+
+
+// Finds the number of binary digits in a value.
+// Parameters:
+//     value - The value.
+// Returns:
+//     The number of bits up to and including the highest set bit, 1 for 0.
+static unsigned int binary_bit_length(uintmax_t value)
+{
+	unsigned int length = 1;
+	
+	if (value == 0) {
+		return 1;
+	}
+#if defined(__GNUC__) && UINTMAX_MAX == ULLONG_MAX
+	length = sizeof(unsigned long long) * CHAR_BIT - __builtin_clzll(value);
+#else
+	while ((value >>= 1) != 0) {
+		length++;
+	}
+#endif
+	return length;
+}
+
+
+
+// Adds the locale's thousands separators to decimal digits, for the ' flag.
+// The digits are moved up the buffer from the most significant down, with
+// separators where the grouping's boundaries say, so no second buffer is
+// needed.
+// Parameters:
+//     buffer - The digits, stored backwards, with room for BUFFER_SIZE.
+//     length - The number of digits.
+// Returns:
+//     The number of characters in buffer once grouped.
+static unsigned int group_backwards_buffer(char *buffer, unsigned int length)
+{
+	const printf_grouping *grouping = printf_locale_grouping();
+	// Only boundaries with a digit either side of them.
+	uint64_t boundaries = 0;
+	unsigned int grouped = 0;
+	unsigned int to = 0;
+
+	if (length < 2 || grouping->boundaries == 0) {
+		return length;
+	}
+	assert(length < 64);
+	boundaries = grouping->boundaries & (((uint64_t) 1 << length) - 1);
+	for (uint64_t rest = boundaries; rest != 0; rest &= rest - 1) {
+		grouped += grouping->separator_length;
+	}
+	grouped += length;
+	assert(grouped <= BUFFER_SIZE);
+
+	to = grouped;
+	for (unsigned int i = length; i > 0; i--) {
+		buffer[--to] = buffer[i - 1];
+		if ((boundaries >> (i - 1)) & 1) {
+			// Backwards, so the separator's first byte comes highest.
+			for (size_t j = 0; j < grouping->separator_length; j++) {
+				buffer[--to] = grouping->separator[j];
+			}
+		}
+	}
+	return grouped;
+}
+
+
+
 // Writes out a negative decimal number to our output. This is for '%d' with
 // negative numbers.
 // Parameters:
@@ -544,6 +752,9 @@ bool write_decimal_negative(output_specifier *output, uintmax_t value,
    
     // Write it backwards into our buffer.
     length = write_decimal_negative_backwards(buffer, value);
+    if (fs->thousands_grouping) {
+		length = group_backwards_buffer(buffer, length);
+	}
     
     // Determine whether we need to pad our number up to precision.
     if (fs->precision == -1) {
@@ -598,6 +809,9 @@ bool write_decimal_positive(output_specifier *output, uintmax_t value,
 	} else {
 		length = write_integer_backwards(buffer, value, fs, 10);
 	}
+	if (fs->thousands_grouping) {
+		length = group_backwards_buffer(buffer, length);
+	}
 	
 	// Whether we should pad our number up to precision.
 	if (fs->precision == -1) {
@@ -746,8 +960,81 @@ static int write_integer_backwards(char *buffer, uintmax_t value,
 
 
 
+#ifdef PRINTF_INT128
+// Writes out a 128 bit integer backwards into our buffer, in the base for the 
+// type in fs. Does not terminate the buffer with '\0'. Decimal digits are 
+// found 19 at a time, 10^19 being the largest power of ten in 64 bits, so 
+// there is one 128 bit division per 19 digits and the rest are 64 bit.
+// Parameters:
+//     buffer - Buffer to write backwards into, room for 128 characters.
+//     value - The value to write out.
+//     fs - The format specifier for how we should write it.
+// Returns:
+//     the number of characters written.
+static int write_integer128_backwards(char *buffer, printf_uint128 value, 
+									  const format_specifier *fs)
+{
+	const uint64_t chunk_size = UINT64_C(10000000000000000000);
+	const char *char_values = base_conversion_small;
+	printf_uint128 quotient = 0;
+	uint64_t chunk = 0;
+	unsigned int shift = 0;
+	int length = 0;
+	
+	// "%X" gives uppercase letters.
+	if (fs->type == TYPE_X) {
+		char_values = base_conversion_capital;
+	}
+	switch (fs->type) {
+		case TYPE_o:
+			shift = 3;
+			break;
+		case TYPE_x:
+			// PASS-THROUGH
+		case TYPE_X:
+			shift = 4;
+			break;
+		case TYPE_b:
+			// PASS-THROUGH
+		case TYPE_B:
+			shift = 1;
+			break;
+		default:
+			// Decimal.
+			break;
+	}
+	
+	if (shift != 0) {
+		// Powers of two need no division at all.
+		do {
+			buffer[length++] = char_values[value & ((1u << shift) - 1)];
+			value >>= shift;
+		} while (value != 0);
+		return length;
+	}
+	
+	while (value > UINT64_MAX) {
+		quotient = value / chunk_size;
+		chunk = (uint64_t) (value - quotient * chunk_size);
+		value = quotient;
+		for (int i = 0; i < 19; i++) {
+			buffer[length++] = '0' + chunk % 10;
+			chunk /= 10;
+		}
+	}
+	chunk = (uint64_t) value;
+	do {
+		buffer[length++] = '0' + chunk % 10;
+		chunk /= 10;
+	} while (chunk != 0);
+	return length;
+}
+#endif
+
+
+
 // Writes out a positive integer to our output according to the format 
-// specifier. This is for '%d'/'%x'/'%o'/'%u'.
+// specifier. This is for '%d'/'%x'/'%o'/'%b'/'%u'.
 // Parameters:
 //     output - Where we should output to.
 //     value - The value to write out. Must be negative.
@@ -757,12 +1044,19 @@ static int write_integer_backwards(char *buffer, uintmax_t value,
 bool write_integer_positive(output_specifier *output, uintmax_t value, 
 							format_specifier *fs) 
 {
+	int bits = 0;
+	
     switch(fs->type) {
 		case TYPE_u:
 			// PASS-THROUGH
         case TYPE_d:
             // PASS-THROUGH
         case TYPE_i:
+			// "%w32d" and narrower don't need uintmax_t division.
+			bits = format_string_length_bits(fs->length);
+			if (bits != 0 && bits <= 32 && value <= UINT32_MAX) {
+				return printf_decimal_write_u32(output, value, fs);
+			}
             return write_decimal_positive(output, value, fs);
             break;
         case TYPE_o:
@@ -773,6 +1067,11 @@ bool write_integer_positive(output_specifier *output, uintmax_t value,
         case TYPE_X:
             return write_hexadecimal(output, value, fs);
             break;
+        case TYPE_b:
+            // PASS-THROUGH
+        case TYPE_B:
+            return write_binary(output, value, fs);
+            break;
         default:
 			// Note: Should never be called, this would be an error elsewhere in
 			// the code.
@@ -784,6 +1083,108 @@ bool write_integer_positive(output_specifier *output, uintmax_t value,
 
 
 
+#ifdef PRINTF_INT128
+// Writes out a 128 bit integer to our output according to the format 
+// specifier. This is for "%w128d" and the other "%w128" integer conversions.
+// Parameters:
+//     output - Where we should output to.
+//     value - The value to write out, converted from printf_int128 for '%d'.
+//     fs - The format specifier for how we should write it.
+// Returns:
+//     true on success, false on error.
+bool write_integer128(output_specifier *output, printf_uint128 value, 
+					  const format_specifier *fs)
+{
+	// Buffer for holding it backwards.
+	char buffer[BUFFER_SIZE];
+	// The length of our buffer.
+	unsigned int length = 0;
+	// The length of our buffer, or it padded, which ever is longer.
+	unsigned int precision_length = 0;
+	// Amount to pad with ' '/'0'.
+	unsigned int padding_amount = 0;
+	// Amount to pad our number to match precision.
+	unsigned int precision_padding = 0;
+	// Prefix characters, as the 64 bit write_* functions would give.
+	char prefix = 0;
+	char prefix2 = 0;
+	
+	switch (fs->type) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			if ((printf_int128) value < 0) {
+				prefix = '-';
+				value = -value;
+			} else if (fs->always_sign) {
+				prefix = '+';
+			} else if (fs->empty_sign) {
+				prefix = ' ';
+			}
+			break;
+		case TYPE_x:
+			// PASS-THROUGH
+		case TYPE_X:
+			if (fs->alternate_form) {
+				prefix = '0';
+				prefix2 = (fs->type == TYPE_X) ? 'X' : 'x';
+			}
+			break;
+		case TYPE_b:
+			// PASS-THROUGH
+		case TYPE_B:
+			if (fs->alternate_form && value != 0) {
+				prefix = '0';
+				prefix2 = (fs->type == TYPE_B) ? 'B' : 'b';
+			}
+			break;
+		default:
+			break;
+	}
+	
+	// Write it backwards into our buffer.
+	// For precision and value of 0 we print nothing, not a '0'.
+	if (fs->precision == 0 && value == 0) {
+		length = 0;
+	} else {
+		length = write_integer128_backwards(buffer, value, fs);
+	}
+	if (fs->thousands_grouping) {
+		length = group_backwards_buffer(buffer, length);
+	}
+	
+	// Whether we should pad our number up to precision.
+	if (fs->precision == -1) {
+		precision_length = length;
+	} else {
+		if ((unsigned int) fs->precision > length) {
+			precision_length = fs->precision;
+			precision_padding = fs->precision - length;
+		} else {
+			precision_length = length;
+		}
+	}
+	
+	// "%#o" only needs its '0' if precision hasn't given one.
+	if (fs->type == TYPE_o && fs->alternate_form && 
+		precision_length == length) 
+	{
+		prefix = '0';
+	}
+	
+	// Whether we should pad our number up to width, less the prefix.
+	if (fs->width > precision_length + (prefix != 0) + (prefix2 != 0)) {
+		padding_amount = fs->width - precision_length - (prefix != 0) - 
+			(prefix2 != 0);
+	}
+	
+	return write_backwards_buffer_with_padding(output, buffer, length, fs, 
+							prefix, prefix2, padding_amount, precision_padding);
+}
+#endif
+
+
+
 // Writes out the pad_character to output length times.
 // Parameters:
 //     output - Where we should output to.
@@ -793,10 +1194,25 @@ bool write_integer_positive(output_specifier *output, uintmax_t value,
 //     true on success, false on error.
 static bool pad_output(output_specifier *output, int length, char pad_character)
 {
-	for (int i =  0; i < length; i++) {
-		if(!printf_output(output, pad_character)) {
+	// Holds a run of the pad character so we can output it as spans.
+	char padding[BUFFER_SIZE];
+	int chunk = length;
+	
+	if (chunk > BUFFER_SIZE) {
+		chunk = BUFFER_SIZE;
+	}
+	if (chunk > 0) {
+		memset(padding, pad_character, chunk);
+	}
+	
+	while (length > 0) {
+		if (length < chunk) {
+			chunk = length;
+		}
+		if (!printf_output_span(output, padding, chunk)) {
 			return false;
 		}
+		length -= chunk;
 	}
 	return true;
 }
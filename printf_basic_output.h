@@ -20,8 +20,14 @@ bool write_integer_positive(output_specifier *output, uintmax_t value,
 							format_specifier *fs);
 bool write_hexadecimal(output_specifier *output, uintmax_t value, 
 					   const format_specifier *fs);
+bool write_binary(output_specifier *output, uintmax_t value, 
+				  const format_specifier *fs);
 bool write_octal(output_specifier *output, uintmax_t value, 
 				 format_specifier *fs);
+#ifdef PRINTF_INT128
+bool write_integer128(output_specifier *output, printf_uint128 value, 
+					  const format_specifier *fs);
+#endif
 bool write_string(output_specifier *output, const char *input, 
 				  const format_specifier *fs);
 bool write_character(output_specifier *output, uintmax_t value, 
@@ -0,0 +1,831 @@
+// Part of printf function suite. Formats arrays of records with one format,
+// e.g. for exporters writing many rows the same way. The format is parsed
+// once, each conversion is matched to the type of its field once, and output
+// is collected in one growing buffer and handed to the output in large spans,
+// so parsing, dispatch and writes are shared by the whole batch.
+//
+// Each argument the format uses is a field of the record, given by its offset
+// e.g. from offsetof. Fields have the type printf would take from a va_list,
+// except that lengths are exact: "%hhd" is a signed char, "%hd" a short, "%d"
+// an int, "%c" a char, "%s" a const char* and "%p" a const void*. '*' widths
+// and precisions are ints. "%n" isn't allowed, as records are read only.
+//
+// printf_batch_parallel splits very large batches between threads. Each 
+// thread first counts how long its share of rows comes to, then a prefix sum 
+// of the counts gives each thread where its share starts in one shared 
+// buffer, which they then all write at once. The result is identical to 
+// formatting the rows in order.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "printf_definitions.h"
+#include "printf_basic_output.h"
+#include "printf_format.h"
+#include "printf_allocator.h"
+#include "printf_compile.h"
+#include "printf_batch.h"
+#include "printf_custom.h"
+
+// Collected output is handed on once it is at least this big.
+#define BATCH_FLUSH_SIZE (64 * 1024)
+// Fewer rows than this per thread isn't worth starting a thread for.
+#define BATCH_ROWS_PER_THREAD 4096
+// The most threads printf_batch_parallel will use.
+#define BATCH_MAX_THREADS 256
+
+// One thread's share of a parallel batch.
+typedef struct batch_share_struct {
+	const printf_compiled_format *compiled;
+	const printf_batch_column *columns;
+	const char *rows;
+	size_t stride;
+	size_t count;
+	// The total length of this share's output, from the counting pass.
+	size_t length;
+	// Where this share's output goes, for the writing pass. NULL to count.
+	char *destination;
+	bool result;
+} batch_share;
+
+
+
+static printf_batch_field batch_field_type(const format_specifier *fs);
+static printf_batch_field batch_width_field(const format_specifier *fs,
+											bool is_signed);
+static bool batch_write_custom(output_specifier *output,
+							   const format_specifier *fs,
+							   const printf_batch_column *column,
+							   const char *row);
+static int batch_load_int(const char *row, size_t offset);
+static intmax_t batch_load_signed(const char *row, size_t offset,
+								  printf_batch_field field);
+static uintmax_t batch_load_unsigned(const char *row, size_t offset,
+									 printf_batch_field field);
+static void* batch_share_run(void *share_pointer);
+static bool batch_run_shares(batch_share *shares, int threads);
+
+
+
+// Formats an array of records.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Not
+//         finished, so more can be printed to it.
+//     format - the printf format string.
+//     rows - the first record.
+//     stride - the distance between records, usually their sizeof.
+//     count - the number of records.
+//     ... - a size_t offset within a record for each argument format uses.
+// Returns:
+//     true on success, false on error.
+bool printf_batch(output_specifier *output, const char *format,
+				  const void *rows, size_t stride, size_t count, ...)
+{
+	printf_compiled_format compiled;
+	size_t *offsets = NULL;
+	va_list args;
+	bool result = false;
+
+	assert(output != NULL);
+	assert(format != NULL);
+	if (output == NULL || format == NULL) {
+		return false;
+	}
+
+	if (!printf_compile(&compiled, format, output->allocator)) {
+		return false;
+	}
+	offsets = printf_allocate(output->allocator,
+							  (compiled.argument_count + 1) * sizeof(size_t));
+	if (offsets == NULL) {
+		printf_compiled_free(&compiled);
+		return false;
+	}
+
+	va_start(args, count);
+	for (int i = 0; i < compiled.argument_count; i++) {
+		offsets[i] = va_arg(args, size_t);
+	}
+	va_end(args);
+
+	result = printf_batch_compiled(output, &compiled, rows, stride, count,
+								   offsets);
+
+	printf_deallocate(output->allocator, offsets);
+	printf_compiled_free(&compiled);
+	return result;
+}
+
+
+
+// Formats an array of records, with the field offsets in an array.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Not
+//         finished, so more can be printed to it.
+//     format - the printf format string.
+//     rows - the first record.
+//     stride - the distance between records, usually their sizeof.
+//     count - the number of records.
+//     offsets - the offset within a record of each argument format uses.
+// Returns:
+//     true on success, false on error.
+bool printf_batch_offsets(output_specifier *output, const char *format,
+						  const void *rows, size_t stride, size_t count,
+						  const size_t *offsets)
+{
+	printf_compiled_format compiled;
+	bool result = false;
+
+	assert(output != NULL);
+	assert(format != NULL);
+	if (output == NULL || format == NULL) {
+		return false;
+	}
+
+	if (!printf_compile(&compiled, format, output->allocator)) {
+		return false;
+	}
+	result = printf_batch_compiled(output, &compiled, rows, stride, count,
+								   offsets);
+	printf_compiled_free(&compiled);
+	return result;
+}
+
+
+
+// Formats an array of records with an already compiled format.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Not
+//         finished, so more can be printed to it.
+//     compiled - the compiled format.
+//     rows - the first record.
+//     stride - the distance between records, usually their sizeof.
+//     count - the number of records.
+//     offsets - the offset within a record of each argument compiled uses.
+// Returns:
+//     true on success, false on error.
+bool printf_batch_compiled(output_specifier *output,
+						   const printf_compiled_format *compiled,
+						   const void *rows, size_t stride, size_t count,
+						   const size_t *offsets)
+{
+	printf_batch_column *columns = NULL;
+	output_specifier staging;
+	bool result = true;
+
+	assert(rows != NULL || count == 0);
+	assert(offsets != NULL || compiled->argument_count == 0);
+	if (count == 0) {
+		return true;
+	}
+
+	columns = printf_batch_columns(compiled, offsets, output->allocator);
+	if (columns == NULL) {
+		return false;
+	}
+	if (!printf_output_initialise_allocated_string(&staging,
+												   output->allocator))
+	{
+		printf_deallocate(output->allocator, columns);
+		return false;
+	}
+
+	for (size_t i = 0; i < count && result; i++) {
+		result = printf_batch_row(&staging, compiled, columns,
+								  (const char*) rows + i * stride);
+		if (result && staging.characters_written >= BATCH_FLUSH_SIZE) {
+			result = printf_output_span(output, staging.string,
+										staging.characters_written);
+			staging.characters_written = 0;
+		}
+	}
+	if (result && staging.characters_written != 0) {
+		result = printf_output_span(output, staging.string,
+									staging.characters_written);
+	}
+
+	printf_deallocate(output->allocator, staging.string);
+	printf_deallocate(output->allocator, columns);
+	return result;
+}
+
+
+
+// Formats an array of records using several threads. The output is the 
+// same as printf_batch_compiled gives, collected in one buffer and handed to 
+// output as a single span.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Not
+//         finished, so more can be printed to it.
+//     compiled - the compiled format.
+//     rows - the first record.
+//     stride - the distance between records, usually their sizeof.
+//     count - the number of records.
+//     offsets - the offset within a record of each argument compiled uses.
+//     threads - how many threads to use, 0 for one per online processor. 
+//         Fewer are used for small batches.
+// Returns:
+//     true on success, false on error.
+bool printf_batch_parallel(output_specifier *output,
+						   const printf_compiled_format *compiled,
+						   const void *rows, size_t stride, size_t count,
+						   const size_t *offsets, int threads)
+{
+	batch_share shares[BATCH_MAX_THREADS];
+	printf_batch_column *columns = NULL;
+	char *buffer = NULL;
+	size_t total = 0;
+	size_t share_size = 0;
+	size_t first = 0;
+	bool result = false;
+
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if ((size_t) threads > count / BATCH_ROWS_PER_THREAD) {
+		threads = count / BATCH_ROWS_PER_THREAD;
+	}
+	if (threads > BATCH_MAX_THREADS) {
+		threads = BATCH_MAX_THREADS;
+	}
+	if (threads <= 1) {
+		return printf_batch_compiled(output, compiled, rows, stride, count,
+									 offsets);
+	}
+
+	columns = printf_batch_columns(compiled, offsets, output->allocator);
+	if (columns == NULL) {
+		return false;
+	}
+
+	// Contiguous shares, the first ones a row bigger if it doesn't divide.
+	share_size = count / threads;
+	for (int i = 0; i < threads; i++) {
+		shares[i].compiled = compiled;
+		shares[i].columns = columns;
+		shares[i].rows = (const char*) rows + first * stride;
+		shares[i].stride = stride;
+		shares[i].count = share_size + ((size_t) i < count % threads);
+		shares[i].length = 0;
+		shares[i].destination = NULL;
+		shares[i].result = false;
+		first += shares[i].count;
+	}
+
+	// Count, then place each share after the ones before it.
+	if (!batch_run_shares(shares, threads)) {
+		printf_deallocate(output->allocator, columns);
+		return false;
+	}
+	for (int i = 0; i < threads; i++) {
+		total += shares[i].length;
+	}
+	// Room for the '\0' the string outputs keep back.
+	buffer = printf_allocate(output->allocator, total + 1);
+	if (buffer != NULL) {
+		total = 0;
+		for (int i = 0; i < threads; i++) {
+			shares[i].destination = buffer + total;
+			total += shares[i].length;
+		}
+		result = batch_run_shares(shares, threads) &&
+				 printf_output_span(output, buffer, total);
+	}
+
+	printf_deallocate(output->allocator, buffer);
+	printf_deallocate(output->allocator, columns);
+	return result;
+}
+
+
+
+// Matches each node of a compiled format to the fields it reads, once per
+// batch.
+// Parameters:
+//     compiled - the compiled format.
+//     offsets - the offset within a record of each argument compiled uses.
+//     allocator - where to get the columns from.
+// Returns:
+//     A column for each node, to be given back to allocator. NULL on running
+//     out of memory, or if a conversion isn't allowed in a batch.
+printf_batch_column* printf_batch_columns(
+	const printf_compiled_format *compiled, const size_t *offsets,
+	const printf_allocator *allocator)
+{
+	printf_batch_column *columns = NULL;
+	const printf_format_node *node = NULL;
+
+	columns = printf_allocate(allocator,
+						(compiled->node_count + 1) * sizeof(*columns));
+	if (columns == NULL) {
+		return NULL;
+	}
+	for (size_t i = 0; i < compiled->node_count; i++) {
+		node = compiled->nodes + i;
+		columns[i].field = BATCH_FIELD_none;
+		columns[i].offset = 0;
+		columns[i].width_offset = 0;
+		columns[i].precision_offset = 0;
+		if (node->literal) {
+			continue;
+		}
+		columns[i].field = batch_field_type(&node->fs);
+		if (columns[i].field == BATCH_FIELD_none) {
+			printf_deallocate(allocator, columns);
+			return NULL;
+		}
+		columns[i].offset = offsets[node->argument];
+		if (node->width_argument != -1) {
+			columns[i].width_offset = offsets[node->width_argument];
+		}
+		if (node->precision_argument != -1) {
+			columns[i].precision_offset = offsets[node->precision_argument];
+		}
+	}
+	return columns;
+}
+
+
+
+// Formats one record.
+// Parameters:
+//     output - where to write to.
+//     compiled - the compiled format.
+//     columns - from printf_batch_columns.
+//     row - the record.
+// Returns:
+//     true on success, false on error.
+bool printf_batch_row(output_specifier *output,
+					  const printf_compiled_format *compiled,
+					  const printf_batch_column *columns, const char *row)
+{
+	const printf_format_node *node = NULL;
+	const printf_batch_column *column = NULL;
+	format_specifier fs;
+	intmax_t int_value = 0;
+	int width = 0;
+	int precision = 0;
+	const char *string_value = NULL;
+	const void *pointer_value = NULL;
+	bool result = true;
+
+	for (size_t i = 0; i < compiled->node_count && result; i++) {
+		node = compiled->nodes + i;
+		column = columns + i;
+		if (node->literal) {
+			result = printf_output_span(output,
+										compiled->format + node->offset,
+										node->length);
+			continue;
+		}
+
+		fs = node->fs;
+		if (node->width_argument != -1 || node->precision_argument != -1) {
+			if (node->width_argument != -1) {
+				width = batch_load_int(row, column->width_offset);
+				// If width is negative then that is taken as a positive
+				// value and a '-' flag.
+				if (width >= 0) {
+					fs.width = width;
+				} else {
+					fs.left_justify = true;
+					fs.width = (width == INT_MIN) ? INT_MAX : -width;
+				}
+			}
+			if (node->precision_argument != -1) {
+				precision = batch_load_int(row, column->precision_offset);
+				// Explicit precision values of < 0 are ignored.
+				if (precision >= 0) {
+					fs.precision = precision;
+				}
+			}
+			format_string_check_unused_values(&fs);
+		}
+
+		if (fs.type == TYPE_custom) {
+			result = batch_write_custom(output, &fs, column, row);
+			continue;
+		}
+		switch (column->field) {
+			case BATCH_FIELD_signed_char:
+				// PASS-THROUGH
+			case BATCH_FIELD_short:
+				// PASS-THROUGH
+			case BATCH_FIELD_int:
+				// PASS-THROUGH
+			case BATCH_FIELD_long:
+				// PASS-THROUGH
+			case BATCH_FIELD_long_long:
+				// PASS-THROUGH
+			case BATCH_FIELD_intmax:
+				// PASS-THROUGH
+			case BATCH_FIELD_ptrdiff:
+				// PASS-THROUGH
+			case BATCH_FIELD_signed_size:
+				int_value = batch_load_signed(row, column->offset,
+											  column->field);
+				if (fs.type == TYPE_d || fs.type == TYPE_i) {
+					if (int_value >= 0) {
+						result = write_decimal_positive(output, int_value,
+														&fs);
+					} else {
+						result = write_decimal_negative(output, int_value,
+														&fs);
+					}
+				} else {
+					// e.g. "%tx", the bits as unsigned.
+					result = write_integer_positive(output,
+							(uintmax_t) int_value, &fs);
+				}
+				break;
+			case BATCH_FIELD_unsigned_char:
+				// PASS-THROUGH
+			case BATCH_FIELD_unsigned_short:
+				// PASS-THROUGH
+			case BATCH_FIELD_unsigned_int:
+				// PASS-THROUGH
+			case BATCH_FIELD_unsigned_long:
+				// PASS-THROUGH
+			case BATCH_FIELD_unsigned_long_long:
+				// PASS-THROUGH
+			case BATCH_FIELD_uintmax:
+				// PASS-THROUGH
+			case BATCH_FIELD_size:
+				result = write_integer_positive(output,
+						batch_load_unsigned(row, column->offset,
+											column->field), &fs);
+				break;
+			case BATCH_FIELD_char:
+				result = write_character(output,
+						(unsigned char) row[column->offset], &fs);
+				break;
+			case BATCH_FIELD_string:
+				memcpy(&string_value, row + column->offset,
+					   sizeof(string_value));
+				result = write_string(output, string_value, &fs);
+				break;
+			case BATCH_FIELD_pointer:
+				memcpy(&pointer_value, row + column->offset,
+					   sizeof(pointer_value));
+				result = write_pointer(output, pointer_value, &fs);
+				break;
+			default:
+				result = false;
+				break;
+		}
+	}
+	return result;
+}
+
+
+
+// Works out the field type for a conversion. Registered conversions have the 
+// field type of what they read.
+// Parameters:
+//     fs - the conversion.
+// Returns:
+//     The field type, BATCH_FIELD_none if the conversion isn't allowed.
+static printf_batch_field batch_field_type(const format_specifier *fs)
+{
+	switch (format_string_argument_type(fs)) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			if (format_string_length_bits(fs->length) != 0) {
+				return batch_width_field(fs, true);
+			}
+			switch (fs->length) {
+				case LENGTH_hh: return BATCH_FIELD_signed_char;
+				case LENGTH_h: return BATCH_FIELD_short;
+				case LENGTH_l: return BATCH_FIELD_long;
+				case LENGTH_ll: return BATCH_FIELD_long_long;
+				case LENGTH_j: return BATCH_FIELD_intmax;
+				case LENGTH_z: return BATCH_FIELD_signed_size;
+				case LENGTH_t: return BATCH_FIELD_ptrdiff;
+				default: return BATCH_FIELD_int;
+			}
+		case TYPE_u:
+			// PASS-THROUGH
+		case TYPE_o:
+			// PASS-THROUGH
+		case TYPE_x:
+			// PASS-THROUGH
+		case TYPE_X:
+			// PASS-THROUGH
+		case TYPE_b:
+			// PASS-THROUGH
+		case TYPE_B:
+			if (format_string_length_bits(fs->length) != 0) {
+				return batch_width_field(fs, false);
+			}
+			switch (fs->length) {
+				case LENGTH_hh: return BATCH_FIELD_unsigned_char;
+				case LENGTH_h: return BATCH_FIELD_unsigned_short;
+				case LENGTH_l: return BATCH_FIELD_unsigned_long;
+				case LENGTH_ll: return BATCH_FIELD_unsigned_long_long;
+				case LENGTH_j: return BATCH_FIELD_uintmax;
+				case LENGTH_z: return BATCH_FIELD_size;
+				case LENGTH_t: return BATCH_FIELD_ptrdiff;
+				default: return BATCH_FIELD_unsigned_int;
+			}
+		case TYPE_c:
+			return BATCH_FIELD_char;
+		case TYPE_s:
+			return BATCH_FIELD_string;
+		case TYPE_p:
+			return BATCH_FIELD_pointer;
+		default:
+			// "%n", and floating point which isn't supported yet.
+			return BATCH_FIELD_none;
+	}
+}
+
+
+
+// Works out the field type for a "%wN" or "%wfN" integer conversion, the 
+// standard integer type of the same size.
+// Parameters:
+//     fs - the conversion.
+//     is_signed - whether the conversion is signed.
+// Returns:
+//     The field type, BATCH_FIELD_none if no standard type is that size.
+static printf_batch_field batch_width_field(const format_specifier *fs,
+											bool is_signed)
+{
+	int bits = format_string_length_bits(fs->length);
+
+	if (bits == CHAR_BIT) {
+		return is_signed ? BATCH_FIELD_signed_char : 
+			BATCH_FIELD_unsigned_char;
+	} else if (bits == sizeof(short) * CHAR_BIT) {
+		return is_signed ? BATCH_FIELD_short : BATCH_FIELD_unsigned_short;
+	} else if (bits == sizeof(int) * CHAR_BIT) {
+		return is_signed ? BATCH_FIELD_int : BATCH_FIELD_unsigned_int;
+	} else if (bits == sizeof(long int) * CHAR_BIT) {
+		return is_signed ? BATCH_FIELD_long : BATCH_FIELD_unsigned_long;
+	} else if (bits == sizeof(long long int) * CHAR_BIT) {
+		return is_signed ? BATCH_FIELD_long_long : 
+			BATCH_FIELD_unsigned_long_long;
+	}
+	return BATCH_FIELD_none;
+}
+
+
+
+// Writes a registered conversion, passing it the field as a tagged argument.
+// Parameters:
+//     output - where to write to.
+//     fs - the conversion, of TYPE_custom.
+//     column - where and how to read the field.
+//     row - the record.
+// Returns:
+//     true on success, false on error.
+static bool batch_write_custom(output_specifier *output,
+							   const format_specifier *fs,
+							   const printf_batch_column *column,
+							   const char *row)
+{
+	printf_arg argument;
+
+	argument.type = fs->custom->argument;
+	argument.length = fs->length;
+	switch (column->field) {
+		case BATCH_FIELD_char:
+			argument.value.unsigned_integer =
+				(unsigned char) row[column->offset];
+			break;
+		case BATCH_FIELD_string:
+			memcpy(&argument.value.string, row + column->offset,
+				   sizeof(argument.value.string));
+			break;
+		case BATCH_FIELD_pointer:
+			memcpy(&argument.value.pointer, row + column->offset,
+				   sizeof(argument.value.pointer));
+			break;
+		default:
+			// The signed fields come before BATCH_FIELD_unsigned_char. The 
+			// union holds the same bits either way.
+			if (column->field < BATCH_FIELD_unsigned_char) {
+				argument.value.integer = batch_load_signed(row,
+											column->offset, column->field);
+			} else {
+				argument.value.unsigned_integer = batch_load_unsigned(row,
+											column->offset, column->field);
+			}
+			break;
+	}
+	return printf_custom_write(output, fs, &argument);
+}
+
+
+
+// Loads an int field, for '*' widths and precisions.
+// Parameters:
+//     row - the record.
+//     offset - where the field is in the record.
+// Returns:
+//     The field.
+static int batch_load_int(const char *row, size_t offset)
+{
+	int value = 0;
+	memcpy(&value, row + offset, sizeof(value));
+	return value;
+}
+
+
+
+// Loads a signed field. Fields may be unaligned, so they are copied out.
+// Parameters:
+//     row - the record.
+//     offset - where the field is in the record.
+//     field - the type of the field.
+// Returns:
+//     The field.
+static intmax_t batch_load_signed(const char *row, size_t offset,
+								  printf_batch_field field)
+{
+	const char *pointer = row + offset;
+
+	switch (field) {
+		case BATCH_FIELD_signed_char: {
+			signed char value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_short: {
+			short value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_int: {
+			int value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_long: {
+			long int value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_long_long: {
+			long long int value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_ptrdiff: {
+			ptrdiff_t value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_signed_size: {
+			// The signed type the size of a size_t, as for "%zd".
+			size_t value;
+			memcpy(&value, pointer, sizeof(value));
+			if (value > SIZE_MAX / 2) {
+				return -(intmax_t) (SIZE_MAX - value) - 1;
+			}
+			return (intmax_t) value;
+		}
+		default: {
+			intmax_t value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+	}
+}
+
+
+
+// Loads an unsigned field. Fields may be unaligned, so they are copied out.
+// Parameters:
+//     row - the record.
+//     offset - where the field is in the record.
+//     field - the type of the field.
+// Returns:
+//     The field.
+static uintmax_t batch_load_unsigned(const char *row, size_t offset,
+									 printf_batch_field field)
+{
+	const char *pointer = row + offset;
+
+	switch (field) {
+		case BATCH_FIELD_unsigned_char:
+			return (unsigned char) *pointer;
+		case BATCH_FIELD_unsigned_short: {
+			unsigned short value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_unsigned_int: {
+			unsigned int value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_unsigned_long: {
+			unsigned long int value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_unsigned_long_long: {
+			unsigned long long int value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		case BATCH_FIELD_size: {
+			size_t value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+		default: {
+			uintmax_t value;
+			memcpy(&value, pointer, sizeof(value));
+			return value;
+		}
+	}
+}
+
+
+
+// Runs a pass of a parallel batch, each share in its own thread.
+// Parameters:
+//     shares - the shares.
+//     threads - the number of shares.
+// Returns:
+//     true if every share succeeded, false if not.
+static bool batch_run_shares(batch_share *shares, int threads)
+{
+	pthread_t ids[BATCH_MAX_THREADS];
+	bool result = true;
+	int started = 0;
+
+	// The calling thread does the first share itself.
+	for (started = 1; started < threads; started++) {
+		if (pthread_create(ids + started, NULL, batch_share_run,
+						   shares + started) != 0)
+		{
+			break;
+		}
+	}
+	batch_share_run(shares);
+	// Do any that couldn't get a thread here too.
+	for (int i = started; i < threads; i++) {
+		batch_share_run(shares + i);
+	}
+	for (int i = 1; i < started; i++) {
+		pthread_join(ids[i], NULL);
+	}
+
+	for (int i = 0; i < threads; i++) {
+		if (!shares[i].result) {
+			result = false;
+		}
+	}
+	return result;
+}
+
+
+
+// Thread function for a share of a parallel batch. Counts the length of the 
+// share if it has no destination yet, otherwise writes it there.
+// Parameters:
+//     share_pointer - the batch_share.
+// Returns:
+//     NULL, the result is stored in the share.
+static void* batch_share_run(void *share_pointer)
+{
+	batch_share *share = share_pointer;
+	output_specifier output;
+
+	// A string output given no room counts, like snprintf(NULL, 0, ...).
+	if (share->destination == NULL) {
+		printf_output_initialise_string(&output, NULL, 0);
+	} else {
+		printf_output_initialise_string(&output, share->destination,
+										share->length + 1);
+	}
+
+	share->result = true;
+	for (size_t i = 0; i < share->count && share->result; i++) {
+		share->result = printf_batch_row(&output, share->compiled,
+							share->columns, share->rows + i * share->stride);
+	}
+
+	if (share->destination == NULL) {
+		share->length = output.characters_written;
+	} else if (output.characters_written != share->length) {
+		// The rows changed between passes.
+		share->result = false;
+	}
+	return NULL;
+}
@@ -0,0 +1,32 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_BATCH_H
+#define PRINTF_BATCH_H
+
+#include "printf_definitions.h"
+
+bool printf_batch(output_specifier *output, const char *format, 
+				  const void *rows, size_t stride, size_t count, ...);
+bool printf_batch_offsets(output_specifier *output, const char *format, 
+						  const void *rows, size_t stride, size_t count, 
+						  const size_t *offsets);
+bool printf_batch_compiled(output_specifier *output, 
+						   const printf_compiled_format *compiled, 
+						   const void *rows, size_t stride, size_t count, 
+						   const size_t *offsets);
+
+bool printf_batch_parallel(output_specifier *output, 
+						   const printf_compiled_format *compiled, 
+						   const void *rows, size_t stride, size_t count, 
+						   const size_t *offsets, int threads);
+
+printf_batch_column* printf_batch_columns(
+	const printf_compiled_format *compiled, const size_t *offsets, 
+	const printf_allocator *allocator);
+bool printf_batch_row(output_specifier *output, 
+					  const printf_compiled_format *compiled, 
+					  const printf_batch_column *columns, const char *row);
+
+#endif // PRINTF_BATCH_H
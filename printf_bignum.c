@@ -0,0 +1,996 @@
+// Part of printf function suite. Writes arbitrary precision unsigned integers,
+// for the built in named conversions:
+//     %{bignum} - in decimal.
+//     %{bignumhex} - in lowercase hexadecimal.
+// Each takes a pointer to an array of uint64_t limbs, least significant
+// first, and the number of limbs as its precision, e.g.
+//     new_printf("n = %.*{bignum}\n", 64, modulus);
+// prints a 4096 bit modulus. Without a precision nothing is written and
+// printing fails. Width pads what is written, as for "%s". Leading zero limbs
+// are allowed, and a value of zero is written as "0".
+//
+// Hexadecimal is written straight from the limbs. Decimal works on 32 bit
+// words and splits the value in two by a power of ten, 10^(9 * 2^k), each
+// half giving exactly half the digits, until the pieces are small enough to
+// divide by 10^9 a word at a time. Splitting is done with Barrett reduction,
+// two multiplies by the power and its reciprocal, and multiplying uses
+// Karatsuba once both numbers are long, so converting takes O(M(n) log n)
+// rather than the O(n^2) of dividing by 10^9 throughout. The powers and
+// their reciprocals are worked out once, by long division, and kept for
+// later calls. Scratch memory for a conversion is one block from the
+// output's allocator, used as a stack. The kept powers come from malloc, not
+// the output's allocator, as they are shared by every thread for the life of
+// the process and an arena could be reset under them.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "printf_definitions.h"
+#include "printf_bignum.h"
+#include "printf_allocator.h"
+
+// Output is collected in a buffer of this size before being handed on.
+#define BIGNUM_BUFFER_SIZE 4096
+// Values of up to this many words are converted by dividing by 10^9.
+#define BIGNUM_BASE_WORDS 48
+// Multiplies where the shorter number has fewer words are done schoolbook.
+#define BIGNUM_KARATSUBA_WORDS 32
+// The most powers of ten kept, enough for any precision.
+#define BIGNUM_MAX_LEVELS 40
+// 10^9, the largest power of ten in a word.
+#define BIGNUM_BILLION 1000000000u
+// Room for the digits of a value of BIGNUM_BASE_WORDS words, in groups of 9.
+#define BIGNUM_SMALL_DIGITS \
+	((BIGNUM_BASE_WORDS + BIGNUM_BASE_WORDS / 8 + 1) * 9)
+
+// Decimal conversion works in these, with products in a bignum_double.
+typedef uint32_t bignum_word;
+typedef uint64_t bignum_double;
+
+// A power of ten, 10^(9 * 2^k), and its reciprocal for Barrett reduction.
+typedef struct bignum_power_struct {
+	bignum_word *value;
+	size_t length;
+	// floor(2^(64 * length) / value), NULL for 10^9.
+	bignum_word *reciprocal;
+	size_t reciprocal_length;
+} bignum_power;
+
+// Scratch words for a conversion, taken and given back as a stack.
+typedef struct bignum_scratch_struct {
+	bignum_word *words;
+	size_t size;
+	size_t used;
+} bignum_scratch;
+
+// Powers of ten worked out so far, shared by all threads. Entries below
+// bignum_level_count don't change once added.
+static bignum_power bignum_powers[BIGNUM_MAX_LEVELS];
+static int bignum_level_count = 0;
+static pthread_mutex_t bignum_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+static bool bignum_write_padded(output_specifier *output,
+								const format_specifier *fs,
+								const char *digits, size_t length);
+static bool bignum_pad(output_specifier *output, size_t length);
+static size_t bignum_from_limbs(const uint64_t *limbs, size_t count,
+								bignum_word *words);
+static bool bignum_fill(bignum_word *x, size_t length, int level,
+						char *digits, bignum_scratch *scratch);
+static void bignum_fill_base(bignum_word *x, size_t length, char *digits,
+							 size_t digit_count);
+static bool bignum_split(bignum_word *x, size_t length,
+						 const bignum_power *power, bignum_word *quotient,
+						 size_t *quotient_length, bignum_scratch *scratch);
+static bool bignum_ensure_levels(int level,
+								 const printf_allocator *allocator);
+static bool bignum_add_level(const printf_allocator *allocator);
+static void bignum_divide(const bignum_word *u, size_t u_length,
+						  const bignum_word *v, size_t v_length,
+						  bignum_word *quotient, bignum_word *work);
+static bool bignum_multiply(const bignum_word *a, size_t a_length,
+							const bignum_word *b, size_t b_length,
+							bignum_word *product, bignum_scratch *scratch);
+static bool bignum_karatsuba(const bignum_word *a, const bignum_word *b,
+							 size_t length, bignum_word *product,
+							 bignum_scratch *scratch);
+static void bignum_schoolbook(const bignum_word *a, size_t a_length,
+							  const bignum_word *b, size_t b_length,
+							  bignum_word *product);
+static bignum_word bignum_add(bignum_word *x, size_t x_length,
+							  const bignum_word *y, size_t y_length);
+static bignum_word bignum_subtract(bignum_word *x, size_t x_length,
+								   const bignum_word *y, size_t y_length);
+static int bignum_compare(const bignum_word *x, size_t x_length,
+						  const bignum_word *y, size_t y_length);
+static size_t bignum_trim(const bignum_word *x, size_t length);
+static bignum_word* bignum_push(bignum_scratch *scratch, size_t count);
+static size_t bignum_multiply_scratch(size_t length);
+
+
+
+// Writes an arbitrary precision integer in decimal, as a
+// printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of limbs.
+//     argument - the limbs, in argument->value.pointer.
+//     context - unused.
+// Returns:
+//     true on success, false on error, including when there is no precision.
+bool printf_bignum_write(output_specifier *output, const format_specifier *fs,
+						 const printf_arg *argument, void *context)
+{
+	const uint64_t *limbs = argument->value.pointer;
+	bignum_scratch scratch;
+	bignum_word *x = NULL;
+	char *digits = NULL;
+	size_t count = 0;
+	size_t length = 0;
+	size_t digit_count = 0;
+	size_t skip = 0;
+	int level = 0;
+	bool result = false;
+
+	(void) context;
+	if (fs->precision < 0 || (limbs == NULL && fs->precision != 0)) {
+		return false;
+	}
+	count = fs->precision;
+	while (count > 0 && limbs[count - 1] == 0) {
+		count--;
+	}
+	if (count == 0) {
+		return bignum_write_padded(output, fs, "0", 1);
+	}
+
+	// Small values are done with the words in hand and no scratch memory.
+	if (count * 2 <= BIGNUM_BASE_WORDS) {
+		bignum_word words[BIGNUM_BASE_WORDS];
+		char small_digits[BIGNUM_SMALL_DIGITS];
+
+		length = bignum_from_limbs(limbs, count, words);
+		// A word is less than 9/8 of 9 digits.
+		digit_count = (length + length / 8 + 1) * 9;
+		bignum_fill_base(words, length, small_digits, digit_count);
+		while (small_digits[skip] == '0') {
+			skip++;
+		}
+		return bignum_write_padded(output, fs, small_digits + skip,
+								   digit_count - skip);
+	}
+
+	// 10^(9 * 2^level) squared must be more than the value, and the value
+	// is less than 2^(32 * words).
+	length = count * 2;
+	while (level < BIGNUM_MAX_LEVELS - 1) {
+		if (!bignum_ensure_levels(level, output->allocator)) {
+			return false;
+		}
+		if (2 * (bignum_powers[level].length - 1) >= length) {
+			break;
+		}
+		level++;
+	}
+	digit_count = (size_t) 18 << level;
+
+	scratch.size = length + digit_count / sizeof(bignum_word) + 1 +
+				   bignum_multiply_scratch(length) * 2 + 2 * length +
+				   4 * (size_t) level;
+	scratch.used = 0;
+	scratch.words = printf_allocate(output->allocator,
+									scratch.size * sizeof(bignum_word));
+	if (scratch.words == NULL) {
+		return false;
+	}
+	x = bignum_push(&scratch, length);
+	digits = (char*) bignum_push(&scratch,
+								 digit_count / sizeof(bignum_word) + 1);
+
+	if (x != NULL && digits != NULL) {
+		length = bignum_from_limbs(limbs, count, x);
+		result = bignum_fill(x, length, level, digits, &scratch);
+	}
+	if (result) {
+		while (digits[skip] == '0') {
+			skip++;
+		}
+		result = bignum_write_padded(output, fs, digits + skip,
+									 digit_count - skip);
+	}
+	printf_deallocate(output->allocator, scratch.words);
+	return result;
+}
+
+
+
+// Writes an arbitrary precision integer in lowercase hexadecimal, as a
+// printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of limbs.
+//     argument - the limbs, in argument->value.pointer.
+//     context - unused.
+// Returns:
+//     true on success, false on error, including when there is no precision.
+bool printf_bignum_hex_write(output_specifier *output,
+							 const format_specifier *fs,
+							 const printf_arg *argument, void *context)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+	const uint64_t *limbs = argument->value.pointer;
+	char buffer[BIGNUM_BUFFER_SIZE];
+	size_t count = 0;
+	size_t length = 0;
+	size_t padding = 0;
+	size_t used = 0;
+	uint64_t limb = 0;
+	int digits = 0;
+	int i = 0;
+
+	(void) context;
+	if (fs->precision < 0 || (limbs == NULL && fs->precision != 0)) {
+		return false;
+	}
+	count = fs->precision;
+	while (count > 0 && limbs[count - 1] == 0) {
+		count--;
+	}
+	if (count == 0) {
+		return bignum_write_padded(output, fs, "0", 1);
+	}
+
+	// The top limb without its leading zeros, the rest with 16 digits each.
+	limb = limbs[count - 1];
+	digits = 16 - __builtin_clzll(limb) / 4;
+	length = (count - 1) * 16 + digits;
+	if (fs->width > length) {
+		padding = fs->width - length;
+	}
+	if (!fs->left_justify && !bignum_pad(output, padding)) {
+		return false;
+	}
+	while (count > 0) {
+		limb = limbs[count - 1];
+		for (i = digits - 1; i >= 0; i--) {
+			buffer[used + i] = hex_digits[limb & 15];
+			limb >>= 4;
+		}
+		used += digits;
+		digits = 16;
+		count--;
+		if (used > BIGNUM_BUFFER_SIZE - 16 || count == 0) {
+			if (!printf_output_span(output, buffer, used)) {
+				return false;
+			}
+			used = 0;
+		}
+	}
+	if (fs->left_justify && !bignum_pad(output, padding)) {
+		return false;
+	}
+	return true;
+}
+
+
+
+// Writes digits, padded to the width.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, for the width.
+//     digits - the digits.
+//     length - the number of digits.
+// Returns:
+//     true on success, false on error.
+static bool bignum_write_padded(output_specifier *output,
+								const format_specifier *fs,
+								const char *digits, size_t length)
+{
+	size_t padding = 0;
+
+	if (fs->width > length) {
+		padding = fs->width - length;
+	}
+	if (!fs->left_justify && !bignum_pad(output, padding)) {
+		return false;
+	}
+	if (!printf_output_span(output, digits, length)) {
+		return false;
+	}
+	if (fs->left_justify && !bignum_pad(output, padding)) {
+		return false;
+	}
+	return true;
+}
+
+
+
+// Writes spaces, for width.
+// Parameters:
+//     output - where to write to.
+//     length - the number of spaces, may be 0.
+// Returns:
+//     true on success, false on error.
+static bool bignum_pad(output_specifier *output, size_t length)
+{
+	char spaces[64];
+	size_t chunk = 0;
+
+	memset(spaces, ' ', sizeof(spaces));
+	while (length > 0) {
+		chunk = length < sizeof(spaces) ? length : sizeof(spaces);
+		if (!printf_output_span(output, spaces, chunk)) {
+			return false;
+		}
+		length -= chunk;
+	}
+	return true;
+}
+
+
+
+// Splits 64 bit limbs into 32 bit words.
+// Parameters:
+//     limbs - the limbs, least significant first.
+//     count - the number of limbs.
+//     words - where to write the words, room for 2 * count.
+// Returns:
+//     the number of words, without leading zeros.
+static size_t bignum_from_limbs(const uint64_t *limbs, size_t count,
+								bignum_word *words)
+{
+	size_t i = 0;
+
+	for (i = 0; i < count; i++) {
+		words[2 * i] = (bignum_word) limbs[i];
+		words[2 * i + 1] = (bignum_word) (limbs[i] >> 32);
+	}
+	return bignum_trim(words, count * 2);
+}
+
+
+
+// Writes exactly 18 * 2^level decimal digits of a value, with leading zeros,
+// by splitting it in two with 10^(9 * 2^level) until the pieces are small.
+// Parameters:
+//     x - the value, less than 10^(9 * 2^(level + 1)). It is overwritten.
+//     length - the number of words in x.
+//     level - which power of ten to split by.
+//     digits - where to write the digits.
+//     scratch - scratch memory.
+// Returns:
+//     true on success, false if scratch memory ran out.
+static bool bignum_fill(bignum_word *x, size_t length, int level,
+						char *digits, bignum_scratch *scratch)
+{
+	size_t half = (size_t) 9 << level;
+	size_t mark = scratch->used;
+	bignum_word *quotient = NULL;
+	size_t quotient_length = 0;
+	bool result = false;
+
+	length = bignum_trim(x, length);
+	if (length <= BIGNUM_BASE_WORDS || level == 0) {
+		bignum_fill_base(x, length, digits, half * 2);
+		return true;
+	}
+	if (bignum_compare(x, length, bignum_powers[level].value,
+					   bignum_powers[level].length) < 0)
+	{
+		// Only the lower half has anything in it.
+		memset(digits, '0', half);
+		return bignum_fill(x, length, level - 1, digits + half, scratch);
+	}
+	quotient = bignum_push(scratch, bignum_powers[level].length + 1);
+	if (quotient == NULL) {
+		return false;
+	}
+	// x is then the remainder, giving the lower half of the digits.
+	result = bignum_split(x, length, &bignum_powers[level], quotient,
+						  &quotient_length, scratch) &&
+			 bignum_fill(quotient, quotient_length, level - 1, digits,
+						 scratch) &&
+			 bignum_fill(x, bignum_powers[level].length, level - 1,
+						 digits + half, scratch);
+	scratch->used = mark;
+	return result;
+}
+
+
+
+// Writes a fixed number of decimal digits of a value, with leading zeros,
+// dividing by 10^9 for each 9 digits.
+// Parameters:
+//     x - the value, less than 10^digit_count. It is overwritten.
+//     length - the number of words in x, may be 0.
+//     digits - where to write the digits.
+//     digit_count - the number of digits to write, a multiple of 9.
+static void bignum_fill_base(bignum_word *x, size_t length, char *digits,
+							 size_t digit_count)
+{
+	bignum_double remainder = 0;
+	bignum_word group = 0;
+	size_t i = 0;
+	int j = 0;
+
+	length = bignum_trim(x, length);
+	while (length > 0) {
+		assert(digit_count >= 9);
+		remainder = 0;
+		for (i = length; i > 0; i--) {
+			remainder = (remainder << 32) | x[i - 1];
+			x[i - 1] = (bignum_word) (remainder / BIGNUM_BILLION);
+			remainder %= BIGNUM_BILLION;
+		}
+		if (x[length - 1] == 0) {
+			length--;
+		}
+		group = (bignum_word) remainder;
+		digit_count -= 9;
+		for (j = 8; j >= 0; j--) {
+			digits[digit_count + j] = '0' + group % 10;
+			group /= 10;
+		}
+	}
+	memset(digits, '0', digit_count);
+}
+
+
+
+// Divides by a power of ten, using Barrett reduction.
+// Parameters:
+//     x - the value, less than the power squared. It is overwritten with the
+//         remainder, which has as many words as the power.
+//     length - the number of words in x, without leading zeros, at least as
+//         many as the power has.
+//     power - the power of ten.
+//     quotient - where to write the quotient, room for power->length + 1
+//         words.
+//     quotient_length - where to write the number of words in the quotient.
+//     scratch - scratch memory.
+// Returns:
+//     true on success, false if scratch memory ran out.
+static bool bignum_split(bignum_word *x, size_t length,
+						 const bignum_power *power, bignum_word *quotient,
+						 size_t *quotient_length, bignum_scratch *scratch)
+{
+	size_t m = power->length;
+	size_t mark = scratch->used;
+	bignum_word *estimate = NULL;
+	bignum_word *product = NULL;
+	size_t top_length = 0;
+	size_t estimate_length = 0;
+	size_t product_length = 0;
+	bignum_word one = 1;
+
+	assert(length >= m);
+	memset(quotient, 0, (m + 1) * sizeof(bignum_word));
+
+	// The quotient is within 2 of
+	//     floor(floor(x / 2^(32 * (m - 1))) * reciprocal / 2^(32 * (m + 1))).
+	top_length = length - (m - 1);
+	estimate_length = top_length + power->reciprocal_length;
+	estimate = bignum_push(scratch, estimate_length);
+	if (estimate == NULL ||
+		!bignum_multiply(x + m - 1, top_length, power->reciprocal,
+						 power->reciprocal_length, estimate, scratch))
+	{
+		scratch->used = mark;
+		return false;
+	}
+	*quotient_length = 0;
+	if (estimate_length > m + 1) {
+		*quotient_length = bignum_trim(estimate + m + 1,
+									   estimate_length - (m + 1));
+		memcpy(quotient, estimate + m + 1,
+			   *quotient_length * sizeof(bignum_word));
+	}
+	scratch->used = mark;
+
+	if (*quotient_length > 0) {
+		product_length = *quotient_length + m;
+		product = bignum_push(scratch, product_length);
+		if (product == NULL ||
+			!bignum_multiply(quotient, *quotient_length, power->value, m,
+							 product, scratch))
+		{
+			scratch->used = mark;
+			return false;
+		}
+		product_length = bignum_trim(product, product_length);
+		bignum_subtract(x, length, product, product_length);
+	}
+	while (bignum_compare(x, length, power->value, m) >= 0) {
+		bignum_subtract(x, length, power->value, m);
+		bignum_add(quotient, m + 1, &one, 1);
+	}
+	scratch->used = mark;
+	*quotient_length = bignum_trim(quotient, m + 1);
+	return true;
+}
+
+
+
+// Makes sure powers of ten up to a level have been worked out.
+// Parameters:
+//     level - the highest level needed.
+//     allocator - for the memory used while working them out.
+// Returns:
+//     true on success, false if memory ran out.
+static bool bignum_ensure_levels(int level,
+								 const printf_allocator *allocator)
+{
+	bool result = true;
+
+	// Entries are never changed once counted, so can be read unlocked.
+	if (__atomic_load_n(&bignum_level_count, __ATOMIC_ACQUIRE) > level) {
+		return true;
+	}
+	pthread_mutex_lock(&bignum_mutex);
+	while (result && bignum_level_count <= level) {
+		result = bignum_add_level(allocator);
+	}
+	pthread_mutex_unlock(&bignum_mutex);
+	return result;
+}
+
+
+
+// Works out the next power of ten and its reciprocal. Called with
+// bignum_mutex held. The power and reciprocal are kept, so come from malloc,
+// and only the working memory from the allocator.
+// Parameters:
+//     allocator - for the memory used while working them out.
+// Returns:
+//     true on success, false if memory ran out.
+static bool bignum_add_level(const printf_allocator *allocator)
+{
+	bignum_power power = {NULL, 0, NULL, 0};
+	const bignum_power *previous = NULL;
+	bignum_scratch scratch = {NULL, 0, 0};
+	bignum_word *numerator = NULL;
+	bignum_word *work = NULL;
+	size_t m = 0;
+	int level = bignum_level_count;
+
+	if (level == 0) {
+		power.value = malloc(sizeof(bignum_word));
+		if (power.value == NULL) {
+			return false;
+		}
+		power.value[0] = BIGNUM_BILLION;
+		power.length = 1;
+		bignum_powers[0] = power;
+		__atomic_store_n(&bignum_level_count, 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	// Squaring the previous power.
+	previous = &bignum_powers[level - 1];
+	power.value = malloc(previous->length * 2 * sizeof(bignum_word));
+	scratch.size = bignum_multiply_scratch(previous->length);
+	scratch.words = printf_allocate(allocator,
+									scratch.size * sizeof(bignum_word));
+	if (power.value == NULL || scratch.words == NULL ||
+		!bignum_multiply(previous->value, previous->length, previous->value,
+						 previous->length, power.value, &scratch))
+	{
+		free(power.value);
+		printf_deallocate(allocator, scratch.words);
+		return false;
+	}
+	printf_deallocate(allocator, scratch.words);
+	power.length = bignum_trim(power.value, previous->length * 2);
+	m = power.length;
+
+	// The reciprocal is 2^(64 * m) divided by the power.
+	power.reciprocal_length = m + 2;
+	power.reciprocal = malloc(power.reciprocal_length * sizeof(bignum_word));
+	numerator = printf_allocate(allocator,
+								(2 * m + 1) * sizeof(bignum_word));
+	work = printf_allocate(allocator, (3 * m + 2) * sizeof(bignum_word));
+	if (power.reciprocal == NULL || numerator == NULL || work == NULL) {
+		free(power.value);
+		free(power.reciprocal);
+		printf_deallocate(allocator, numerator);
+		printf_deallocate(allocator, work);
+		return false;
+	}
+	memset(numerator, 0, 2 * m * sizeof(bignum_word));
+	numerator[2 * m] = 1;
+	bignum_divide(numerator, 2 * m + 1, power.value, m, power.reciprocal,
+				  work);
+	power.reciprocal_length = bignum_trim(power.reciprocal, m + 2);
+	printf_deallocate(allocator, numerator);
+	printf_deallocate(allocator, work);
+
+	bignum_powers[level] = power;
+	__atomic_store_n(&bignum_level_count, level + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+
+
+// Long division, Knuth's algorithm D. Only used for the reciprocals, once.
+// Parameters:
+//     u - the dividend.
+//     u_length - the number of words in u.
+//     v - the divisor, its top word not 0.
+//     v_length - the number of words in v, at least 2, no more than
+//         u_length.
+//     quotient - where to write the quotient, u_length - v_length + 1 words.
+//     work - room for u_length + v_length + 1 words.
+static void bignum_divide(const bignum_word *u, size_t u_length,
+						  const bignum_word *v, size_t v_length,
+						  bignum_word *quotient, bignum_word *work)
+{
+	const bignum_double base = (bignum_double) 1 << 32;
+	bignum_word *un = work;
+	bignum_word *vn = work + u_length + 1;
+	size_t n = v_length;
+	size_t i = 0;
+	size_t j = 0;
+	int shift = __builtin_clz(v[n - 1]);
+	bignum_double numerator = 0;
+	bignum_double estimate = 0;
+	bignum_double remainder = 0;
+	bignum_double product = 0;
+	int64_t borrow = 0;
+	int64_t difference = 0;
+	bignum_double carry = 0;
+
+	assert(n >= 2 && u_length >= n);
+	// Normalised so the divisor's top bit is set.
+	for (i = n - 1; i > 0; i--) {
+		vn[i] = (v[i] << shift) |
+				(shift == 0 ? 0 : v[i - 1] >> (32 - shift));
+	}
+	vn[0] = v[0] << shift;
+	un[u_length] = shift == 0 ? 0 : u[u_length - 1] >> (32 - shift);
+	for (i = u_length - 1; i > 0; i--) {
+		un[i] = (u[i] << shift) |
+				(shift == 0 ? 0 : u[i - 1] >> (32 - shift));
+	}
+	un[0] = u[0] << shift;
+
+	for (j = u_length - n + 1; j > 0; j--) {
+		// Estimates each quotient word from the top two words, then fixes it.
+		numerator = ((bignum_double) un[j - 1 + n] << 32) | un[j + n - 2];
+		estimate = numerator / vn[n - 1];
+		remainder = numerator % vn[n - 1];
+		while (estimate >= base ||
+			   estimate * vn[n - 2] > ((remainder << 32) | un[j + n - 3]))
+		{
+			estimate--;
+			remainder += vn[n - 1];
+			if (remainder >= base) {
+				break;
+			}
+		}
+
+		borrow = 0;
+		for (i = 0; i < n; i++) {
+			product = estimate * vn[i];
+			difference = (int64_t) un[i + j - 1] - borrow -
+						 (int64_t) (product & 0xffffffff);
+			un[i + j - 1] = (bignum_word) difference;
+			borrow = (int64_t) (product >> 32) - (difference >> 32);
+		}
+		difference = (int64_t) un[j - 1 + n] - borrow;
+		un[j - 1 + n] = (bignum_word) difference;
+		quotient[j - 1] = (bignum_word) estimate;
+
+		if (difference < 0) {
+			// Subtracted once too many, so adds the divisor back.
+			quotient[j - 1]--;
+			carry = 0;
+			for (i = 0; i < n; i++) {
+				carry += (bignum_double) un[i + j - 1] + vn[i];
+				un[i + j - 1] = (bignum_word) carry;
+				carry >>= 32;
+			}
+			un[j - 1 + n] += (bignum_word) carry;
+		}
+	}
+}
+
+
+
+// Multiplies two numbers.
+// Parameters:
+//     a - a number.
+//     a_length - the number of words in a.
+//     b - a number.
+//     b_length - the number of words in b.
+//     product - where to write a * b, a_length + b_length words. Mustn't
+//         overlap a or b.
+//     scratch - scratch memory, see bignum_multiply_scratch.
+// Returns:
+//     true on success, false if scratch memory ran out.
+static bool bignum_multiply(const bignum_word *a, size_t a_length,
+							const bignum_word *b, size_t b_length,
+							bignum_word *product, bignum_scratch *scratch)
+{
+	size_t mark = scratch->used;
+	bignum_word *piece = NULL;
+	size_t piece_length = 0;
+	size_t i = 0;
+
+	if (a_length < b_length) {
+		return bignum_multiply(b, b_length, a, a_length, product, scratch);
+	}
+	if (b_length < BIGNUM_KARATSUBA_WORDS) {
+		bignum_schoolbook(a, a_length, b, b_length, product);
+		return true;
+	}
+	if (a_length == b_length) {
+		return bignum_karatsuba(a, b, a_length, product, scratch);
+	}
+
+	// The longer number is multiplied a piece as long as the shorter at a
+	// time.
+	memset(product, 0, (a_length + b_length) * sizeof(bignum_word));
+	piece = bignum_push(scratch, b_length * 2);
+	if (piece == NULL) {
+		return false;
+	}
+	for (i = 0; i < a_length; i += b_length) {
+		piece_length = a_length - i < b_length ? a_length - i : b_length;
+		if (!bignum_multiply(a + i, piece_length, b, b_length, piece,
+							 scratch))
+		{
+			scratch->used = mark;
+			return false;
+		}
+		bignum_add(product + i, a_length + b_length - i, piece,
+				   piece_length + b_length);
+	}
+	scratch->used = mark;
+	return true;
+}
+
+
+
+// Multiplies two numbers of the same length, with Karatsuba's method of
+// three half length multiplies rather than four.
+// Parameters:
+//     a - a number.
+//     b - a number.
+//     length - the number of words in a and b.
+//     product - where to write a * b, 2 * length words.
+//     scratch - scratch memory.
+// Returns:
+//     true on success, false if scratch memory ran out.
+static bool bignum_karatsuba(const bignum_word *a, const bignum_word *b,
+							 size_t length, bignum_word *product,
+							 bignum_scratch *scratch)
+{
+	size_t low = length / 2;
+	size_t high = length - low;
+	size_t mark = scratch->used;
+	bignum_word *a_sum = NULL;
+	bignum_word *b_sum = NULL;
+	bignum_word *middle = NULL;
+	size_t middle_length = 0;
+
+	if (length < BIGNUM_KARATSUBA_WORDS) {
+		bignum_schoolbook(a, length, b, length, product);
+		return true;
+	}
+
+	// a * b = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B + a0 b0.
+	if (!bignum_karatsuba(a, b, low, product, scratch) ||
+		!bignum_karatsuba(a + low, b + low, high, product + 2 * low, scratch))
+	{
+		return false;
+	}
+	a_sum = bignum_push(scratch, high + 1);
+	b_sum = bignum_push(scratch, high + 1);
+	middle = bignum_push(scratch, 2 * (high + 1));
+	if (a_sum == NULL || b_sum == NULL || middle == NULL) {
+		scratch->used = mark;
+		return false;
+	}
+	memcpy(a_sum, a + low, high * sizeof(bignum_word));
+	memcpy(b_sum, b + low, high * sizeof(bignum_word));
+	a_sum[high] = bignum_add(a_sum, high, a, low);
+	b_sum[high] = bignum_add(b_sum, high, b, low);
+	if (!bignum_karatsuba(a_sum, b_sum, high + 1, middle, scratch)) {
+		scratch->used = mark;
+		return false;
+	}
+	bignum_subtract(middle, 2 * (high + 1), product, 2 * low);
+	bignum_subtract(middle, 2 * (high + 1), product + 2 * low, 2 * high);
+	middle_length = bignum_trim(middle, 2 * (high + 1));
+	bignum_add(product + low, 2 * length - low, middle, middle_length);
+	scratch->used = mark;
+	return true;
+}
+
+
+
+// Multiplies two numbers, a word at a time.
+// Parameters:
+//     a - a number.
+//     a_length - the number of words in a.
+//     b - a number.
+//     b_length - the number of words in b.
+//     product - where to write a * b, a_length + b_length words.
+static void bignum_schoolbook(const bignum_word *a, size_t a_length,
+							  const bignum_word *b, size_t b_length,
+							  bignum_word *product)
+{
+	bignum_double carry = 0;
+	size_t i = 0;
+	size_t j = 0;
+
+	memset(product, 0, (a_length + b_length) * sizeof(bignum_word));
+	for (i = 0; i < a_length; i++) {
+		carry = 0;
+		for (j = 0; j < b_length; j++) {
+			carry += (bignum_double) a[i] * b[j] + product[i + j];
+			product[i + j] = (bignum_word) carry;
+			carry >>= 32;
+		}
+		product[i + b_length] = (bignum_word) carry;
+	}
+}
+
+
+
+// Adds a number to another.
+// Parameters:
+//     x - the number added to.
+//     x_length - the number of words in x.
+//     y - the number to add.
+//     y_length - the number of words in y, no more than x_length.
+// Returns:
+//     the carry out of the top of x.
+static bignum_word bignum_add(bignum_word *x, size_t x_length,
+							  const bignum_word *y, size_t y_length)
+{
+	bignum_double carry = 0;
+	size_t i = 0;
+
+	assert(y_length <= x_length);
+	for (i = 0; i < y_length; i++) {
+		carry += (bignum_double) x[i] + y[i];
+		x[i] = (bignum_word) carry;
+		carry >>= 32;
+	}
+	for (; carry != 0 && i < x_length; i++) {
+		carry += x[i];
+		x[i] = (bignum_word) carry;
+		carry >>= 32;
+	}
+	return (bignum_word) carry;
+}
+
+
+
+// Subtracts a number from another.
+// Parameters:
+//     x - the number subtracted from.
+//     x_length - the number of words in x.
+//     y - the number to subtract.
+//     y_length - the number of words in y, no more than x_length.
+// Returns:
+//     the borrow out of the top of x.
+static bignum_word bignum_subtract(bignum_word *x, size_t x_length,
+								   const bignum_word *y, size_t y_length)
+{
+	bignum_word borrow = 0;
+	bignum_double difference = 0;
+	size_t i = 0;
+
+	assert(y_length <= x_length);
+	for (i = 0; i < y_length; i++) {
+		difference = (bignum_double) x[i] - y[i] - borrow;
+		x[i] = (bignum_word) difference;
+		borrow = (bignum_word) (difference >> 63);
+	}
+	for (; borrow != 0 && i < x_length; i++) {
+		borrow = x[i] == 0;
+		x[i]--;
+	}
+	return borrow;
+}
+
+
+
+// Compares two numbers.
+// Parameters:
+//     x - a number.
+//     x_length - the number of words in x.
+//     y - a number.
+//     y_length - the number of words in y.
+// Returns:
+//     less than 0, 0 or more than 0 as x is less than, equal to or more
+//     than y.
+static int bignum_compare(const bignum_word *x, size_t x_length,
+						  const bignum_word *y, size_t y_length)
+{
+	size_t i = 0;
+
+	x_length = bignum_trim(x, x_length);
+	y_length = bignum_trim(y, y_length);
+	if (x_length != y_length) {
+		return x_length < y_length ? -1 : 1;
+	}
+	for (i = x_length; i > 0; i--) {
+		if (x[i - 1] != y[i - 1]) {
+			return x[i - 1] < y[i - 1] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+
+
+// Finds the length of a number without leading zero words.
+// Parameters:
+//     x - the number.
+//     length - the number of words in x.
+// Returns:
+//     the number of words up to and including the top non zero one.
+static size_t bignum_trim(const bignum_word *x, size_t length)
+{
+	while (length > 0 && x[length - 1] == 0) {
+		length--;
+	}
+	return length;
+}
+
+
+
+// Takes words from the top of the scratch stack. They are given back by
+// setting scratch->used to what it was before.
+// Parameters:
+//     scratch - the scratch memory.
+//     count - the number of words.
+// Returns:
+//     the words, or NULL if there aren't that many left, which means the
+//     scratch memory was sized wrongly.
+static bignum_word* bignum_push(bignum_scratch *scratch, size_t count)
+{
+	bignum_word *words = scratch->words + scratch->used;
+
+	if (count > scratch->size - scratch->used) {
+		return NULL;
+	}
+	scratch->used += count;
+	return words;
+}
+
+
+
+// Works out how much scratch memory multiplying numbers of up to a length
+// can need.
+// Parameters:
+//     length - the number of words in the shorter number.
+// Returns:
+//     the number of words.
+static size_t bignum_multiply_scratch(size_t length)
+{
+	size_t words = 2 * length;
+
+	// Each level of Karatsuba takes 4 * (half + 1) words, the halves
+	// shrinking towards 2 words.
+	while (length >= BIGNUM_KARATSUBA_WORDS) {
+		length = length - length / 2 + 1;
+		words += 4 * (length + 1);
+	}
+	return words + 64;
+}
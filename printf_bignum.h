@@ -0,0 +1,16 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_BIGNUM_H
+#define PRINTF_BIGNUM_H
+
+#include "printf_definitions.h"
+
+bool printf_bignum_write(output_specifier *output, const format_specifier *fs,
+						 const printf_arg *argument, void *context);
+bool printf_bignum_hex_write(output_specifier *output,
+							 const format_specifier *fs,
+							 const printf_arg *argument, void *context);
+
+#endif // PRINTF_BIGNUM_H
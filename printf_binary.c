@@ -0,0 +1,436 @@
+// Part of printf function suite. Writes binary buffers as text, for the built
+// in named conversions:
+//     %{hex} - two lowercase hexadecimal digits per byte.
+//     %{HEX} - two uppercase hexadecimal digits per byte.
+//     %{base64} - base64, padded with '=', RFC 4648 section 4.
+//     %{base64url} - the URL and filename safe alphabet, not padded, as used
+//         in URLs and JWTs, RFC 4648 section 5.
+// Each takes a pointer to the bytes, and the number of bytes as its
+// precision, e.g.
+//     new_printf("%.*{hex}\n", (int) length, packet);
+// Without a precision nothing is written and printing fails. Width pads what
+// is written, as for "%s".
+//
+// The bytes are encoded a chunk at a time into a buffer, which is handed on
+// whole. Kernels encode 16 or 32 bytes at a time, as picked by printf_cpu.c:
+// hexadecimal with SSSE3 or AVX2, looking up both digits of every byte with a
+// shuffle, and base64 with SSSE3, moving each 6 bits into its own byte with
+// multiplies before looking them up the same way.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_binary.h"
+#include "printf_cpu.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BINARY_X86
+#include <immintrin.h>
+#endif
+
+// Output is collected in a buffer of this size before being handed on.
+#define BINARY_BUFFER_SIZE 4096
+
+// How a conversion encodes its bytes.
+typedef struct binary_encoding_struct {
+	bool base64;
+	// 16 digits, or 64 base64 characters.
+	const char *alphabet;
+	// Whether base64 is padded with '=' to a multiple of 4 characters.
+	bool padded;
+} binary_encoding;
+
+static const char binary_lower[] = "0123456789abcdef";
+static const char binary_upper[] = "0123456789ABCDEF";
+static const char binary_base64[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char binary_base64url[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+
+
+static bool binary_write(output_specifier *output, const format_specifier *fs,
+						 const printf_arg *argument,
+						 const binary_encoding *encoding);
+static size_t binary_length(size_t count, const binary_encoding *encoding);
+static bool binary_pad(output_specifier *output, char *buffer, size_t length);
+
+
+
+// Writes bytes in lowercase hexadecimal, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of bytes.
+//     argument - the bytes, in argument->value.pointer.
+//     context - unused.
+// Returns:
+//     true on success, false on error.
+bool printf_binary_hex_write(output_specifier *output,
+							 const format_specifier *fs,
+							 const printf_arg *argument, void *context)
+{
+	static const binary_encoding encoding = {false, binary_lower, false};
+
+	(void) context;
+	return binary_write(output, fs, argument, &encoding);
+}
+
+
+
+// Writes bytes in uppercase hexadecimal, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of bytes.
+//     argument - the bytes, in argument->value.pointer.
+//     context - unused.
+// Returns:
+//     true on success, false on error.
+bool printf_binary_hex_upper_write(output_specifier *output,
+								   const format_specifier *fs,
+								   const printf_arg *argument, void *context)
+{
+	static const binary_encoding encoding = {false, binary_upper, false};
+
+	(void) context;
+	return binary_write(output, fs, argument, &encoding);
+}
+
+
+
+// Writes bytes in padded base64, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of bytes.
+//     argument - the bytes, in argument->value.pointer.
+//     context - unused.
+// Returns:
+//     true on success, false on error.
+bool printf_binary_base64_write(output_specifier *output,
+								const format_specifier *fs,
+								const printf_arg *argument, void *context)
+{
+	static const binary_encoding encoding = {true, binary_base64, true};
+
+	(void) context;
+	return binary_write(output, fs, argument, &encoding);
+}
+
+
+
+// Writes bytes in unpadded URL safe base64, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of bytes.
+//     argument - the bytes, in argument->value.pointer.
+//     context - unused.
+// Returns:
+//     true on success, false on error.
+bool printf_binary_base64url_write(output_specifier *output,
+								   const format_specifier *fs,
+								   const printf_arg *argument, void *context)
+{
+	static const binary_encoding encoding = {true, binary_base64url, false};
+
+	(void) context;
+	return binary_write(output, fs, argument, &encoding);
+}
+
+
+
+// Encodes bytes as hexadecimal.
+// Parameters:
+//     bytes - the bytes.
+//     count - the number of bytes.
+//     digits - where to write, room for count * 2 characters.
+//     alphabet - the 16 digits.
+void printf_binary_hex_scalar(const unsigned char *bytes, size_t count,
+							  char *digits, const char *alphabet)
+{
+	for (size_t i = 0; i < count; i++) {
+		digits[i * 2] = alphabet[bytes[i] >> 4];
+		digits[i * 2 + 1] = alphabet[bytes[i] & 15];
+	}
+}
+
+
+
+// Encodes bytes as base64, with no padding.
+// Parameters:
+//     bytes - the bytes.
+//     count - the number of bytes, a multiple of 3.
+//     characters - where to write, room for count / 3 * 4 characters.
+//     alphabet - the 64 characters.
+void printf_binary_base64_scalar(const unsigned char *bytes, size_t count,
+								 char *characters, const char *alphabet)
+{
+	uint32_t group = 0;
+
+	for (size_t i = 0; i + 3 <= count; i += 3) {
+		group = (uint32_t) bytes[i] << 16 | (uint32_t) bytes[i + 1] << 8 |
+				bytes[i + 2];
+		characters[0] = alphabet[group >> 18];
+		characters[1] = alphabet[(group >> 12) & 63];
+		characters[2] = alphabet[(group >> 6) & 63];
+		characters[3] = alphabet[group & 63];
+		characters += 4;
+	}
+}
+
+
+
+#ifdef BINARY_X86
+// printf_binary_hex_scalar 16 bytes at a time with SSSE3.
+// Parameters:
+//     bytes - the bytes.
+//     count - the number of bytes.
+//     digits - where to write, room for count * 2 characters.
+//     alphabet - the 16 digits.
+__attribute__((target("ssse3")))
+void printf_binary_hex_ssse3(const unsigned char *bytes, size_t count,
+							 char *digits, const char *alphabet)
+{
+	const __m128i lookup = _mm_loadu_si128((const __m128i*) alphabet);
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	__m128i chunk;
+	__m128i high;
+	__m128i low;
+	size_t done = 0;
+
+	for (; done + 16 <= count; done += 16) {
+		chunk = _mm_loadu_si128((const __m128i*) (bytes + done));
+		high = _mm_shuffle_epi8(lookup,
+			_mm_and_si128(_mm_srli_epi16(chunk, 4), nibble));
+		low = _mm_shuffle_epi8(lookup, _mm_and_si128(chunk, nibble));
+		_mm_storeu_si128((__m128i*) (digits + done * 2),
+						 _mm_unpacklo_epi8(high, low));
+		_mm_storeu_si128((__m128i*) (digits + done * 2 + 16),
+						 _mm_unpackhi_epi8(high, low));
+	}
+	printf_binary_hex_scalar(bytes + done, count - done, digits + done * 2,
+							 alphabet);
+}
+
+
+
+// printf_binary_hex_scalar 32 bytes at a time with AVX2.
+// Parameters:
+//     bytes - the bytes.
+//     count - the number of bytes.
+//     digits - where to write, room for count * 2 characters.
+//     alphabet - the 16 digits.
+__attribute__((target("avx2")))
+void printf_binary_hex_avx2(const unsigned char *bytes, size_t count,
+							char *digits, const char *alphabet)
+{
+	const __m256i lookup = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128((const __m128i*) alphabet));
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	__m256i chunk;
+	__m256i high;
+	__m256i low;
+	__m256i first;
+	__m256i second;
+	size_t done = 0;
+
+	for (; done + 32 <= count; done += 32) {
+		chunk = _mm256_loadu_si256((const __m256i*) (bytes + done));
+		high = _mm256_shuffle_epi8(lookup,
+			_mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+		low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(chunk, nibble));
+		// Unpacking works within each half, so put the halves back in order.
+		first = _mm256_unpacklo_epi8(high, low);
+		second = _mm256_unpackhi_epi8(high, low);
+		_mm256_storeu_si256((__m256i*) (digits + done * 2),
+							_mm256_permute2x128_si256(first, second, 0x20));
+		_mm256_storeu_si256((__m256i*) (digits + done * 2 + 32),
+							_mm256_permute2x128_si256(first, second, 0x31));
+	}
+	printf_binary_hex_scalar(bytes + done, count - done, digits + done * 2,
+							 alphabet);
+}
+
+
+
+// printf_binary_base64_scalar 12 bytes at a time with SSSE3. Only the last
+// two characters of the alphabet may differ from the standard one.
+// Parameters:
+//     bytes - the bytes.
+//     count - the number of bytes, a multiple of 3.
+//     characters - where to write, room for count / 3 * 4 characters.
+//     alphabet - the 64 characters.
+__attribute__((target("ssse3")))
+void printf_binary_base64_ssse3(const unsigned char *bytes, size_t count,
+								char *characters, const char *alphabet)
+{
+	// What to add to each index, by range: 'A' to 'Z' are 13, 'a' to 'z' 0,
+	// '0' to '9' 1 to 10, then the last two characters 11 and 12.
+	const __m128i offsets = _mm_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		alphabet[62] - 62, alphabet[63] - 63, 'A', 0, 0);
+	__m128i chunk;
+	__m128i indices;
+	__m128i range;
+	size_t done = 0;
+
+	// Each step reads 16 bytes but only uses 12.
+	for (; done + 16 <= count; done += 12) {
+		chunk = _mm_loadu_si128((const __m128i*) (bytes + done));
+		// Each group of 3 bytes into a 32 bit lane, as bytes 1, 0, 2, 1.
+		chunk = _mm_shuffle_epi8(chunk, _mm_setr_epi8(
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+		// Then shift each 6 bits to the bottom of its own byte.
+		indices = _mm_or_si128(
+			_mm_mulhi_epu16(_mm_and_si128(chunk, _mm_set1_epi32(0x0fc0fc00)),
+							_mm_set1_epi32(0x04000040)),
+			_mm_mullo_epi16(_mm_and_si128(chunk, _mm_set1_epi32(0x003f03f0)),
+							_mm_set1_epi32(0x01000010)));
+		range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		range = _mm_or_si128(range, _mm_and_si128(
+			_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+		_mm_storeu_si128((__m128i*) (characters + done / 3 * 4),
+			_mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices));
+	}
+	printf_binary_base64_scalar(bytes + done, count - done,
+								characters + done / 3 * 4, alphabet);
+}
+#endif
+
+
+
+// Writes bytes with an encoding.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of bytes.
+//     argument - the bytes, in argument->value.pointer.
+//     encoding - how to encode them.
+// Returns:
+//     true on success, false on error, including when there is no precision.
+static bool binary_write(output_specifier *output, const format_specifier *fs,
+						 const printf_arg *argument,
+						 const binary_encoding *encoding)
+{
+	const printf_cpu_kernels *kernels = printf_cpu();
+	const unsigned char *bytes = argument->value.pointer;
+	char buffer[BINARY_BUFFER_SIZE];
+	// Bytes per chunk, each filling the buffer, a multiple of 3 for base64.
+	size_t chunk = encoding->base64 ? BINARY_BUFFER_SIZE / 4 * 3 :
+									  BINARY_BUFFER_SIZE / 2;
+	size_t count = 0;
+	size_t length = 0;
+	size_t padding = 0;
+	size_t written = 0;
+	size_t tail = 0;
+	uint32_t group = 0;
+
+	if (fs->precision < 0 || (bytes == NULL && fs->precision != 0)) {
+		return false;
+	}
+	count = fs->precision;
+	length = binary_length(count, encoding);
+	if (fs->width > length) {
+		padding = fs->width - length;
+	}
+	if (!fs->left_justify && !binary_pad(output, buffer, padding)) {
+		return false;
+	}
+
+	if (encoding->base64) {
+		// The last 1 or 2 bytes are written below.
+		tail = count % 3;
+		count -= tail;
+	}
+	while (count > 0) {
+		if (chunk > count) {
+			chunk = count;
+		}
+		if (encoding->base64) {
+			kernels->base64(bytes, chunk, buffer, encoding->alphabet);
+			written = chunk / 3 * 4;
+		} else {
+			kernels->hex(bytes, chunk, buffer, encoding->alphabet);
+			written = chunk * 2;
+		}
+		if (!printf_output_span(output, buffer, written)) {
+			return false;
+		}
+		bytes += chunk;
+		count -= chunk;
+	}
+	if (tail != 0) {
+		group = (uint32_t) bytes[0] << 16;
+		if (tail == 2) {
+			group |= (uint32_t) bytes[1] << 8;
+		}
+		buffer[0] = encoding->alphabet[group >> 18];
+		buffer[1] = encoding->alphabet[(group >> 12) & 63];
+		buffer[2] = (tail == 2) ? encoding->alphabet[(group >> 6) & 63] : '=';
+		buffer[3] = '=';
+		written = encoding->padded ? 4 : tail + 1;
+		if (!printf_output_span(output, buffer, written)) {
+			return false;
+		}
+	}
+
+	if (fs->left_justify && !binary_pad(output, buffer, padding)) {
+		return false;
+	}
+	return true;
+}
+
+
+
+// Works out how many characters bytes are encoded as.
+// Parameters:
+//     count - the number of bytes.
+//     encoding - how they are encoded.
+// Returns:
+//     the number of characters.
+static size_t binary_length(size_t count, const binary_encoding *encoding)
+{
+	if (!encoding->base64) {
+		return count * 2;
+	} else if (encoding->padded) {
+		return (count + 2) / 3 * 4;
+	} else if (count % 3 != 0) {
+		return count / 3 * 4 + count % 3 + 1;
+	}
+	return count / 3 * 4;
+}
+
+
+
+// Writes spaces, for width.
+// Parameters:
+//     output - where to write to.
+//     buffer - BINARY_BUFFER_SIZE characters to use.
+//     length - the number of spaces, may be 0.
+// Returns:
+//     true on success, false on error.
+static bool binary_pad(output_specifier *output, char *buffer, size_t length)
+{
+	size_t chunk = 0;
+
+	chunk = length < BINARY_BUFFER_SIZE ? length : BINARY_BUFFER_SIZE;
+	memset(buffer, ' ', chunk);
+	while (length > 0) {
+		if (chunk > length) {
+			chunk = length;
+		}
+		if (!printf_output_span(output, buffer, chunk)) {
+			return false;
+		}
+		length -= chunk;
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_BINARY_H
+#define PRINTF_BINARY_H
+
+#include "printf_definitions.h"
+
+bool printf_binary_hex_write(output_specifier *output,
+							 const format_specifier *fs,
+							 const printf_arg *argument, void *context);
+bool printf_binary_hex_upper_write(output_specifier *output,
+								   const format_specifier *fs,
+								   const printf_arg *argument, void *context);
+bool printf_binary_base64_write(output_specifier *output,
+								const format_specifier *fs,
+								const printf_arg *argument, void *context);
+bool printf_binary_base64url_write(output_specifier *output,
+								   const format_specifier *fs,
+								   const printf_arg *argument, void *context);
+
+void printf_binary_hex_scalar(const unsigned char *bytes, size_t count,
+							  char *digits, const char *alphabet);
+void printf_binary_hex_ssse3(const unsigned char *bytes, size_t count,
+							 char *digits, const char *alphabet);
+void printf_binary_hex_avx2(const unsigned char *bytes, size_t count,
+							char *digits, const char *alphabet);
+void printf_binary_base64_scalar(const unsigned char *bytes, size_t count,
+								 char *characters, const char *alphabet);
+void printf_binary_base64_ssse3(const unsigned char *bytes, size_t count,
+								char *characters, const char *alphabet);
+
+#endif // PRINTF_BINARY_H
@@ -0,0 +1,182 @@
+// Part of printf function suite. Parses a whole format string once, splitting
+// it into literal runs and conversions, and working out which argument each
+// conversion uses. The result, a printf_compiled_format, can be printed many
+// times without parsing again, or turned into C source by
+// printf_compile_generator.c.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_format.h"
+#include "printf_allocator.h"
+#include "printf_compile.h"
+#include "printf_cpu.h"
+
+
+
+static bool compile_walk(const char *format, printf_format_node *nodes,
+						 size_t *node_count, int *argument_count);
+
+
+
+// Compiles a format string.
+// Parameters:
+//     compiled - where to store the result.
+//     format - the printf format string, must outlive compiled.
+//     allocator - where to get memory from, NULL for this thread's.
+// Returns:
+//     true on success, false if format has an error or on running out of
+//     memory. Nothing needs freeing on failure.
+bool printf_compile(printf_compiled_format *compiled, const char *format,
+					const printf_allocator *allocator)
+{
+	size_t node_count = 0;
+	int argument_count = 0;
+
+	assert(compiled != NULL);
+	assert(format != NULL);
+	if (compiled == NULL || format == NULL) {
+		return false;
+	}
+
+	if (allocator == NULL) {
+		allocator = printf_thread_allocator();
+	}
+	compiled->format = format;
+	compiled->nodes = NULL;
+	compiled->node_count = 0;
+	compiled->argument_count = 0;
+	compiled->allocator = allocator;
+
+	// Once to count and check, once to fill in.
+	if (!compile_walk(format, NULL, &node_count, &argument_count)) {
+		return false;
+	}
+	if (node_count != 0) {
+		compiled->nodes = printf_allocate(allocator,
+									node_count * sizeof(printf_format_node));
+		if (compiled->nodes == NULL) {
+			return false;
+		}
+		compile_walk(format, compiled->nodes, &node_count, &argument_count);
+	}
+	compiled->node_count = node_count;
+	compiled->argument_count = argument_count;
+	return true;
+}
+
+
+
+// Frees a compiled format.
+// Parameters:
+//     compiled - the compiled format, may have no nodes.
+void printf_compiled_free(printf_compiled_format *compiled)
+{
+	if (compiled->nodes != NULL) {
+		printf_deallocate(compiled->allocator, compiled->nodes);
+	}
+	compiled->nodes = NULL;
+	compiled->node_count = 0;
+}
+
+
+
+// Walks a whole format string, in the same way as generic_printf.
+// Parameters:
+//     format - the printf format string.
+//     nodes - where to store the nodes, or NULL to just count them.
+//     node_count - where to store the number of nodes.
+//     argument_count - where to store the number of arguments used.
+// Returns:
+//     true on success, false if format has an error, or mixes positional and
+//     plain conversions.
+static bool compile_walk(const char *format, printf_format_node *nodes,
+						 size_t *node_count, int *argument_count)
+{
+	const char *start = format;
+	printf_format_node node;
+	// Whether we are using positional parameters.
+	bool using_positions = false;
+	bool first_element = true;
+	// The next argument when not using positions.
+	int next = 0;
+	int highest = 0;
+
+	*node_count = 0;
+	*argument_count = 0;
+
+	while (*format != '\0') {
+		node.literal = false;
+		node.offset = 0;
+		node.length = 0;
+		node.argument = -1;
+		node.width_argument = -1;
+		node.precision_argument = -1;
+
+		if (*format == '%' && *(format + 1) == '%') {
+			// Escaped % - "%%", output the second one.
+			node.literal = true;
+			node.offset = (format + 1) - start;
+			node.length = 1;
+			format += 2;
+		} else if (*format == '%') {
+			format++;
+			if (format_error_is_error(read_format_string(format, &node.fs))) {
+				return false;
+			}
+			if (first_element) {
+				using_positions = (node.fs.position != 0);
+				first_element = false;
+			}
+			if ((node.fs.position != 0) != using_positions) {
+				// All or nothing for positions.
+				return false;
+			}
+			if (node.fs.preceding_width != 0) {
+				node.width_argument = using_positions ?
+									  node.fs.preceding_width - 1 : next++;
+			}
+			if (node.fs.preceding_precision != 0) {
+				node.precision_argument = using_positions ?
+										  node.fs.preceding_precision - 1 :
+										  next++;
+			}
+			node.argument = using_positions ? node.fs.position - 1 : next++;
+			format_string_check_unused_values(&node.fs);
+
+			highest = node.argument;
+			if (node.width_argument > highest) {
+				highest = node.width_argument;
+			}
+			if (node.precision_argument > highest) {
+				highest = node.precision_argument;
+			}
+			if (highest + 1 > *argument_count) {
+				*argument_count = highest + 1;
+			}
+			format += node.fs.input_length;
+		} else {
+			// Just normal letters, up to the next '%'.
+			node.literal = true;
+			node.offset = format - start;
+			node.length = printf_cpu()->find_percent(format);
+			format += node.length;
+		}
+
+		if (nodes != NULL) {
+			nodes[*node_count] = node;
+		}
+		(*node_count)++;
+	}
+	return true;
+}
@@ -0,0 +1,14 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_COMPILE_H
+#define PRINTF_COMPILE_H
+
+#include "printf_definitions.h"
+
+bool printf_compile(printf_compiled_format *compiled, const char *format, 
+					const printf_allocator *allocator);
+void printf_compiled_free(printf_compiled_format *compiled);
+
+#endif // PRINTF_COMPILE_H
@@ -0,0 +1,756 @@
+// Generates specialised C for printf format strings known at build time, see
+// printf_compile.c. Each format in a manifest becomes a function that prints
+// it to an output, with the format already parsed: literal runs are output as
+// they are, and each conversion calls its write_* function directly with a
+// constant format_specifier. Arguments are checked by the C compiler, as each
+// is a typed parameter instead of part of a va_list.
+//
+// Usage: printf_compile_generator manifest output.c output.h
+//
+// Each line of the manifest is a function name then the format as a C string
+// literal, e.g.
+//     log_request "%s %-6s %5d %.3s\n"
+// which generates
+//     bool log_request(output_specifier *output, const char *a1,
+//                      const char *a2, int a3, const char *a4);
+// Arguments are named a1, a2... in the order printf would take them. Blank
+// lines and lines starting with '#' are ignored. The generated functions
+// return false on error, and like printf_output_* don't finish the output, so
+// set it up with a printf_output_initialise_* function and finish it with
+// printf_output_finish. Floating point conversions aren't supported.
+// Named conversions such as "%{json}" or "%ll{fixed:2}" take the argument
+// their conversion reads, and are looked up by name with printf_custom_find
+// each time the function runs, so one registered later by the program is
+// found too. Letter conversions from printf_register_conversion aren't known
+// when generating, so can't be used.
+//
+// There is no build system, so build and run it by hand. It needs the rest of
+// the suite, as the built in named conversions are parsed along with the
+// standard ones, e.g.
+//     cc -o printf_compile_generator $(ls printf*.c | grep -v consumer)
+//         -lpthread -lrt
+//     ./printf_compile_generator formats.txt formats.c formats.h
+// then compile formats.c along with the rest of the printf suite.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include "printf_definitions.h"
+#include "printf_compile.h"
+#include "printf_format.h"
+#include "printf_custom.h"
+
+// The longest manifest line.
+#define LINE_SIZE 4096
+
+
+
+static bool read_manifest_line(const char *line, char *name, char *format);
+static const char* argument_type(const format_specifier *fs);
+static bool argument_types(const printf_compiled_format *compiled,
+						   const char **types);
+static void write_prototype(FILE *out, const char *name, const char **types,
+							int count);
+static void write_escaped(FILE *out, const char *span, size_t length);
+static void write_literal(FILE *out, const char *span, size_t length);
+static void write_custom_argument(FILE *out, const format_specifier *fs,
+								  int value);
+static void write_conversion(FILE *out, const printf_format_node *node);
+static bool write_function(FILE *source, FILE *header, const char *name,
+						   const char *format);
+static void write_header_guard(FILE *header, const char *path);
+
+
+
+int main(int argc, char **argv)
+{
+	FILE *manifest = NULL;
+	FILE *source = NULL;
+	FILE *header = NULL;
+	char line[LINE_SIZE];
+	char name[LINE_SIZE];
+	char format[LINE_SIZE];
+	const char *header_name = NULL;
+	int line_number = 0;
+	bool result = true;
+
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s manifest output.c output.h\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	manifest = fopen(argv[1], "r");
+	source = fopen(argv[2], "w");
+	header = fopen(argv[3], "w");
+	if (manifest == NULL || source == NULL || header == NULL) {
+		fprintf(stderr, "Couldn't open files\n");
+		return EXIT_FAILURE;
+	}
+
+	header_name = strrchr(argv[3], '/');
+	header_name = (header_name == NULL) ? argv[3] : header_name + 1;
+
+	fprintf(source, "// Generated by printf_compile_generator from %s, do not "
+			"edit.\n\n", argv[1]);
+	fprintf(source, "#include <stdint.h>\n#include <stdio.h>\n"
+			"#include <stdbool.h>\n#include <stddef.h>\n"
+			"#include <limits.h>\n\n#include \"printf_definitions.h\"\n"
+			"#include \"printf_basic_output.h\"\n"
+			"#include \"printf_format.h\"\n#include \"printf_custom.h\"\n"
+			"#include \"%s\"\n\n", header_name);
+	fprintf(source, "static bool generated_write_signed(output_specifier "
+			"*output, intmax_t value,\n\t\t\t\t\t\t\t\t   "
+			"format_specifier *fs)\n{\n\tif (value >= 0) {\n\t\treturn "
+			"write_integer_positive(output, value, fs);\n\t}\n\treturn "
+			"write_decimal_negative(output, value, fs);\n}\n");
+
+	fprintf(header, "// Generated by printf_compile_generator from %s, do not "
+			"edit.\n\n", argv[1]);
+	write_header_guard(header, header_name);
+	fprintf(header, "#include \"printf_definitions.h\"\n\n");
+
+	while (result && fgets(line, sizeof(line), manifest) != NULL) {
+		line_number++;
+		if (!read_manifest_line(line, name, format)) {
+			fprintf(stderr, "%s:%d: expected a name then a string\n",
+					argv[1], line_number);
+			result = false;
+		} else if (name[0] != '\0') {
+			result = write_function(source, header, name, format);
+			if (!result) {
+				fprintf(stderr, "%s:%d: can't compile \"%s\"\n", argv[1],
+						line_number, format);
+			}
+		}
+	}
+
+	fprintf(header, "\n#endif\n");
+	fclose(manifest);
+	if (fclose(source) != 0 || fclose(header) != 0) {
+		result = false;
+	}
+	if (!result) {
+		remove(argv[2]);
+		remove(argv[3]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+
+
+// Reads a manifest line, a name then a C string literal. Adjacent string
+// literals are joined, as in C.
+// Parameters:
+//     line - the line.
+//     name - where to store the name, at least as big as line. Empty for a
+//         blank line or comment.
+//     format - where to store the format, at least as big as line.
+// Returns:
+//     true on success, false if the line is malformed.
+static bool read_manifest_line(const char *line, char *name, char *format)
+{
+	char *end = NULL;
+	int value = 0;
+	int digits = 0;
+
+	*name = '\0';
+	*format = '\0';
+	while (isspace((unsigned char) *line)) {
+		line++;
+	}
+	if (*line == '\0' || *line == '#') {
+		return true;
+	}
+
+	if (!isalpha((unsigned char) *line) && *line != '_') {
+		return false;
+	}
+	while (isalnum((unsigned char) *line) || *line == '_') {
+		*name++ = *line++;
+	}
+	*name = '\0';
+
+	while (isspace((unsigned char) *line)) {
+		line++;
+	}
+	if (*line != '"') {
+		return false;
+	}
+	while (*line == '"') {
+		line++;
+		while (*line != '"') {
+			if (*line == '\0' || *line == '\n') {
+				return false;
+			} else if (*line != '\\') {
+				*format++ = *line++;
+				continue;
+			}
+			line++;
+			switch (*line) {
+				case 'n': *format++ = '\n'; line++; break;
+				case 't': *format++ = '\t'; line++; break;
+				case 'r': *format++ = '\r'; line++; break;
+				case 'a': *format++ = '\a'; line++; break;
+				case 'b': *format++ = '\b'; line++; break;
+				case 'f': *format++ = '\f'; line++; break;
+				case 'v': *format++ = '\v'; line++; break;
+				case '\\': *format++ = '\\'; line++; break;
+				case '"': *format++ = '"'; line++; break;
+				case '\'': *format++ = '\''; line++; break;
+				case '?': *format++ = '?'; line++; break;
+				case 'x':
+					value = strtol(line + 1, &end, 16);
+					if (end == line + 1) {
+						return false;
+					}
+					*format++ = value;
+					line = end;
+					break;
+				default:
+					value = 0;
+					for (digits = 0; digits < 3 && *line >= '0' &&
+						 *line <= '7'; digits++)
+					{
+						value = value * 8 + (*line++ - '0');
+					}
+					if (digits == 0) {
+						return false;
+					}
+					*format++ = value;
+					break;
+			}
+		}
+		line++;
+		while (isspace((unsigned char) *line)) {
+			line++;
+		}
+	}
+	*format = '\0';
+	// Nothing may follow the string.
+	return *line == '\0';
+}
+
+
+
+// Works out the C type of the argument for a conversion, as printf would take
+// it from a va_list.
+// Parameters:
+//     fs - the conversion.
+// Returns:
+//     The type, or NULL if the conversion isn't supported.
+static const char* argument_type(const format_specifier *fs)
+{
+	format_specifier argument_fs;
+
+	switch (fs->type) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			switch (fs->length) {
+				case LENGTH_l: return "long int";
+				case LENGTH_ll: return "long long int";
+				case LENGTH_j: return "intmax_t";
+				case LENGTH_z: return "size_t";
+				case LENGTH_t: return "ptrdiff_t";
+				case LENGTH_w8: return "int8_t";
+				case LENGTH_w16: return "int16_t";
+				case LENGTH_w32: return "int32_t";
+				case LENGTH_w64: return "int64_t";
+				case LENGTH_wf8: return "int_fast8_t";
+				case LENGTH_wf16: return "int_fast16_t";
+				case LENGTH_wf32: return "int_fast32_t";
+				case LENGTH_wf64: return "int_fast64_t";
+				case LENGTH_w128: return "printf_int128";
+				default: return "int";
+			}
+		case TYPE_u:
+			// PASS-THROUGH
+		case TYPE_o:
+			// PASS-THROUGH
+		case TYPE_x:
+			// PASS-THROUGH
+		case TYPE_X:
+			// PASS-THROUGH
+		case TYPE_b:
+			// PASS-THROUGH
+		case TYPE_B:
+			switch (fs->length) {
+				case LENGTH_l: return "unsigned long int";
+				case LENGTH_ll: return "unsigned long long int";
+				case LENGTH_j: return "uintmax_t";
+				case LENGTH_z: return "size_t";
+				case LENGTH_t: return "ptrdiff_t";
+				case LENGTH_w8: return "uint8_t";
+				case LENGTH_w16: return "uint16_t";
+				case LENGTH_w32: return "uint32_t";
+				case LENGTH_w64: return "uint64_t";
+				case LENGTH_wf8: return "uint_fast8_t";
+				case LENGTH_wf16: return "uint_fast16_t";
+				case LENGTH_wf32: return "uint_fast32_t";
+				case LENGTH_wf64: return "uint_fast64_t";
+				case LENGTH_w128: return "printf_uint128";
+				default: return "unsigned int";
+			}
+		case TYPE_c:
+			return "int";
+		case TYPE_s:
+			return "const char*";
+		case TYPE_p:
+			return "const void*";
+		case TYPE_n:
+			switch (fs->length) {
+				case LENGTH_hh: return "signed char*";
+				case LENGTH_h: return "short*";
+				case LENGTH_l: return "long int*";
+				case LENGTH_ll: return "long long int*";
+				case LENGTH_j: return "intmax_t*";
+				case LENGTH_z: return "size_t*";
+				case LENGTH_t: return "ptrdiff_t*";
+				case LENGTH_w8: return "int8_t*";
+				case LENGTH_w16: return "int16_t*";
+				case LENGTH_w32: return "int32_t*";
+				case LENGTH_w64: return "int64_t*";
+				case LENGTH_wf8: return "int_fast8_t*";
+				case LENGTH_wf16: return "int_fast16_t*";
+				case LENGTH_wf32: return "int_fast32_t*";
+				case LENGTH_wf64: return "int_fast64_t*";
+				case LENGTH_w128: return "printf_int128*";
+				default: return "int*";
+			}
+		case TYPE_custom:
+			// Only named conversions are known here.
+			if (fs->custom->name[0] == '\0') {
+				return NULL;
+			}
+			// As the conversion the argument is read as, e.g. "%ll{fixed:2}"
+			// takes a long long int like "%lld".
+			argument_fs = *fs;
+			argument_fs.type = fs->custom->argument;
+			return argument_type(&argument_fs);
+		default:
+			// FIXME Floating point, once printf supports it.
+			return NULL;
+	}
+}
+
+
+
+// Works out the C type of every argument of a compiled format.
+// Parameters:
+//     compiled - the compiled format.
+//     types - where to store the types, argument_count long.
+// Returns:
+//     true on success, false if an argument is unused, used as two different
+//     types, or its conversion isn't supported.
+static bool argument_types(const printf_compiled_format *compiled,
+						   const char **types)
+{
+	const printf_format_node *node = NULL;
+	const char *type = NULL;
+	int index = 0;
+
+	for (int i = 0; i < compiled->argument_count; i++) {
+		types[i] = NULL;
+	}
+	for (size_t i = 0; i < compiled->node_count; i++) {
+		node = compiled->nodes + i;
+		if (node->literal) {
+			continue;
+		}
+		// Up to three arguments each, the width, precision and value.
+		for (int which = 0; which < 3; which++) {
+			if (which == 0) {
+				index = node->width_argument;
+				type = "int";
+			} else if (which == 1) {
+				index = node->precision_argument;
+				type = "int";
+			} else {
+				index = node->argument;
+				type = argument_type(&node->fs);
+			}
+			if (index == -1) {
+				continue;
+			}
+			if (type == NULL ||
+				(types[index] != NULL && strcmp(types[index], type) != 0))
+			{
+				return false;
+			}
+			types[index] = type;
+		}
+	}
+	for (int i = 0; i < compiled->argument_count; i++) {
+		if (types[i] == NULL) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+// Writes the prototype of a generated function, without the ';' or body.
+// Parameters:
+//     out - where to write.
+//     name - the function name.
+//     types - the argument types.
+//     count - the number of arguments.
+static void write_prototype(FILE *out, const char *name, const char **types,
+							int count)
+{
+	char parameter[64];
+	size_t length = 0;
+	int column = 0;
+
+	column = fprintf(out, "bool %s(output_specifier *output", name);
+	for (int i = 0; i < count; i++) {
+		// Pointers as "char *a1", not "char* a1".
+		length = strlen(types[i]);
+		if (types[i][length - 1] == '*') {
+			snprintf(parameter, sizeof(parameter), "%.*s *a%d",
+					 (int) length - 1, types[i], i + 1);
+		} else {
+			snprintf(parameter, sizeof(parameter), "%s a%d", types[i], i + 1);
+		}
+		// Keep within 80 columns.
+		if (column + strlen(parameter) + 3 > 80) {
+			column = fprintf(out, ",\n\t\t%s", parameter) + 6;
+		} else {
+			column += fprintf(out, ", %s", parameter);
+		}
+	}
+	fprintf(out, ")");
+}
+
+
+
+// Writes characters as the inside of a C string literal.
+// Parameters:
+//     out - where to write.
+//     span - the characters.
+//     length - the number of characters in span.
+static void write_escaped(FILE *out, const char *span, size_t length)
+{
+	unsigned char c = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		c = span[i];
+		if (c == '\\' || c == '"') {
+			fprintf(out, "\\%c", c);
+		} else if (c == '\n') {
+			fprintf(out, "\\n");
+		} else if (c == '\t') {
+			fprintf(out, "\\t");
+		} else if (c == '?') {
+			// Avoid trigraphs.
+			fprintf(out, "\\?");
+		} else if (isprint(c)) {
+			fputc(c, out);
+		} else {
+			fprintf(out, "\\%03o", c);
+		}
+	}
+}
+
+
+
+// Writes code to output a literal run.
+// Parameters:
+//     out - where to write.
+//     span - the literal characters.
+//     length - the number of characters in span.
+static void write_literal(FILE *out, const char *span, size_t length)
+{
+	fprintf(out, "\tif (!printf_output_span(output, \"");
+	write_escaped(out, span, length);
+	fprintf(out, "\", %zu)) {\n\t\treturn false;\n\t}\n", length);
+}
+
+
+
+// Writes code to fill in the tagged argument for a named conversion, as
+// pop_or_load_custom would from a va_list.
+// Parameters:
+//     out - where to write.
+//     fs - the conversion, of TYPE_custom.
+//     value - the number of its argument, from 1.
+static void write_custom_argument(FILE *out, const format_specifier *fs,
+								  int value)
+{
+	const char *types[] = {"TYPE_d", "TYPE_i", "TYPE_u", "TYPE_o", "TYPE_x",
+						   "TYPE_X", "TYPE_b", "TYPE_B", "TYPE_f", "TYPE_F",
+						   "TYPE_e", "TYPE_E", "TYPE_g", "TYPE_G", "TYPE_a",
+						   "TYPE_A", "TYPE_c", "TYPE_s", "TYPE_p", "TYPE_n",
+						   "TYPE_custom", "TYPE_ERROR"};
+	const char *lengths[] = {"LENGTH_none", "LENGTH_hh", "LENGTH_h",
+							 "LENGTH_l", "LENGTH_ll", "LENGTH_j", "LENGTH_z",
+							 "LENGTH_t", "LENGTH_L", "LENGTH_w8", "LENGTH_w16",
+							 "LENGTH_w32", "LENGTH_w64", "LENGTH_wf8",
+							 "LENGTH_wf16", "LENGTH_wf32", "LENGTH_wf64",
+							 "LENGTH_w128", "LENGTH_H", "LENGTH_D",
+							 "LENGTH_DD"};
+
+	fprintf(out, "\targument.type = %s;\n\targument.length = %s;\n",
+			types[fs->custom->argument], lengths[fs->length]);
+	switch (fs->custom->argument) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			// Cut down to intmax_t, as pop_or_load_integer does for "w128".
+			fprintf(out, "\targument.value.integer = (intmax_t) %sa%d;\n",
+					(fs->length == LENGTH_hh) ? "(signed char) " :
+					(fs->length == LENGTH_h) ? "(short) " : "", value);
+			break;
+		case TYPE_c:
+			fprintf(out, "\targument.value.unsigned_integer = (unsigned char) "
+					"a%d;\n", value);
+			break;
+		case TYPE_s:
+			fprintf(out, "\targument.value.string = a%d;\n", value);
+			break;
+		case TYPE_p:
+			fprintf(out, "\targument.value.pointer = (void*) a%d;\n", value);
+			break;
+		default:
+			fprintf(out, "\targument.value.unsigned_integer = (uintmax_t) "
+					"%sa%d;\n", (fs->length == LENGTH_hh) ? "(unsigned char) " :
+					(fs->length == LENGTH_h) ? "(unsigned short) " : "",
+					value);
+			break;
+	}
+}
+
+
+
+// Writes code to output a conversion.
+// Parameters:
+//     out - where to write.
+//     node - the conversion.
+static void write_conversion(FILE *out, const printf_format_node *node)
+{
+	const format_specifier *fs = &node->fs;
+	const char *bools[] = {"false", "true"};
+	const char *lengths[] = {"LENGTH_none", "LENGTH_hh", "LENGTH_h",
+							 "LENGTH_l", "LENGTH_ll", "LENGTH_j", "LENGTH_z",
+							 "LENGTH_t", "LENGTH_L", "LENGTH_w8", "LENGTH_w16",
+							 "LENGTH_w32", "LENGTH_w64", "LENGTH_wf8",
+							 "LENGTH_wf16", "LENGTH_wf32", "LENGTH_wf64",
+							 "LENGTH_w128", "LENGTH_H", "LENGTH_D",
+							 "LENGTH_DD"};
+	const char *types[] = {"TYPE_d", "TYPE_i", "TYPE_u", "TYPE_o", "TYPE_x",
+						   "TYPE_X", "TYPE_b", "TYPE_B", "TYPE_f", "TYPE_F",
+						   "TYPE_e", "TYPE_E", "TYPE_g", "TYPE_G", "TYPE_a",
+						   "TYPE_A", "TYPE_c", "TYPE_s", "TYPE_p", "TYPE_n",
+						   "TYPE_custom", "TYPE_ERROR"};
+	const char *casts[] = {"", "(signed char) ", "(short) ", "", "", "", "",
+						   "", "", "", "", "", "", "", "", "", "", "", "",
+						   "", ""};
+	const char *unsigned_casts[] = {"", "(unsigned char) ",
+									"(unsigned short) ", "", "", "", "", "",
+									"", "", "", "", "", "", "", "", "", "",
+									"", "", ""};
+	int bits = format_string_length_bits(fs->length);
+	int value = node->argument + 1;
+
+	fprintf(out, "\tfs = (format_specifier) {\n"
+			"\t\t.input_length = %d, .left_justify = %s, .always_sign = %s,\n"
+			"\t\t.empty_sign = %s, .alternate_form = %s, .zero_padded = %s,\n"
+			"\t\t.thousands_grouping = %s,\n"
+			"\t\t.preceding_width = %d, .width = %u, "
+			".preceding_precision = %d,\n"
+			"\t\t.precision = %d, .length = %s, .type = %s, "
+			".position = %d\n\t};\n",
+			fs->input_length, bools[fs->left_justify],
+			bools[fs->always_sign], bools[fs->empty_sign],
+			bools[fs->alternate_form], bools[fs->zero_padded],
+			bools[fs->thousands_grouping],
+			fs->preceding_width, fs->width, fs->preceding_precision,
+			fs->precision, lengths[fs->length], types[fs->type],
+			fs->position);
+	if (fs->type == TYPE_custom) {
+		// Found at run time, as the conversion may be registered by then.
+		fprintf(out, "\tfs.custom = printf_custom_find(\"");
+		write_escaped(out, fs->custom->name, strlen(fs->custom->name));
+		fprintf(out, "\", %zu);\n\tfs.custom_option = %d;\n",
+				strlen(fs->custom->name), fs->custom_option);
+	}
+
+	if (node->width_argument != -1) {
+		// If width is negative then that is taken as a positive value and a
+		// '-' flag.
+		int argument = node->width_argument + 1;
+		fprintf(out, "\tif (a%d >= 0) {\n\t\tfs.width = a%d;\n"
+				"\t} else {\n\t\tfs.left_justify = true;\n"
+				"\t\tfs.width = (a%d == INT_MIN) ? INT_MAX : -a%d;\n\t}\n",
+				argument, argument, argument, argument);
+	}
+	if (node->precision_argument != -1) {
+		// Explicit precision values of < 0 are ignored.
+		int argument = node->precision_argument + 1;
+		fprintf(out, "\tif (a%d >= 0) {\n\t\tfs.precision = a%d;\n\t}\n",
+				argument, argument);
+	}
+	if (node->width_argument != -1 || node->precision_argument != -1) {
+		fprintf(out, "\tformat_string_check_unused_values(&fs);\n");
+	}
+
+	if (fs->type == TYPE_custom) {
+		write_custom_argument(out, fs, value);
+		fprintf(out, "\tif (fs.custom == NULL ||\n\t\t"
+				"!printf_custom_write(output, &fs, &argument)) {\n"
+				"\t\treturn false;\n\t}\n");
+		return;
+	}
+
+	fprintf(out, "\tif (!");
+	if (fs->length == LENGTH_w128 && fs->type != TYPE_n) {
+		// Too wide for intmax_t, so written whole.
+		fprintf(out, "write_integer128(output, a%d, &fs)) {\n\t\treturn false;"
+				"\n\t}\n", value);
+		return;
+	}
+	switch (fs->type) {
+		case TYPE_d:
+			// PASS-THROUGH
+		case TYPE_i:
+			fprintf(out, "generated_write_signed(output, %sa%d, &fs)",
+					casts[fs->length], value);
+			break;
+		case TYPE_u:
+			// "%w32u" and narrower take the 32 bit path.
+			fprintf(out, "%s(output, %sa%d, &fs)",
+					(bits != 0 && bits <= 32) ? "write_integer_positive" :
+					"write_decimal_positive",
+					unsigned_casts[fs->length], value);
+			break;
+		case TYPE_o:
+			fprintf(out, "write_octal(output, %sa%d, &fs)",
+					unsigned_casts[fs->length], value);
+			break;
+		case TYPE_x:
+			// PASS-THROUGH
+		case TYPE_X:
+			fprintf(out, "write_hexadecimal(output, %sa%d, &fs)",
+					unsigned_casts[fs->length], value);
+			break;
+		case TYPE_b:
+			// PASS-THROUGH
+		case TYPE_B:
+			fprintf(out, "write_binary(output, %sa%d, &fs)",
+					unsigned_casts[fs->length], value);
+			break;
+		case TYPE_c:
+			fprintf(out, "write_character(output, (unsigned char) a%d, &fs)",
+					value);
+			break;
+		case TYPE_s:
+			fprintf(out, "write_string(output, a%d, &fs)", value);
+			break;
+		case TYPE_p:
+			fprintf(out, "write_pointer(output, a%d, &fs)", value);
+			break;
+		case TYPE_n:
+			fprintf(out, "write_characters_written(output, a%d, &fs)", value);
+			break;
+		default:
+			// Rejected by argument_types.
+			break;
+	}
+	fprintf(out, ") {\n\t\treturn false;\n\t}\n");
+}
+
+
+
+// Writes a generated function for a format.
+// Parameters:
+//     source - where to write the function.
+//     header - where to write its prototype.
+//     name - the function name.
+//     format - the format string.
+// Returns:
+//     true on success, false if the format can't be compiled.
+static bool write_function(FILE *source, FILE *header, const char *name,
+						   const char *format)
+{
+	printf_compiled_format compiled;
+	const char **types = NULL;
+	const printf_format_node *node = NULL;
+	bool has_conversion = false;
+	bool has_custom = false;
+
+	if (!printf_compile(&compiled, format, NULL)) {
+		return false;
+	}
+	types = malloc((compiled.argument_count + 1) * sizeof(const char*));
+	if (types == NULL || !argument_types(&compiled, types)) {
+		free(types);
+		printf_compiled_free(&compiled);
+		return false;
+	}
+
+	write_prototype(header, name, types, compiled.argument_count);
+	fprintf(header, ";\n");
+
+	fprintf(source, "\n\n\n// \"");
+	write_escaped(source, format, strlen(format));
+	fprintf(source, "\"\n");
+	write_prototype(source, name, types, compiled.argument_count);
+	fprintf(source, "\n{\n");
+	for (size_t i = 0; i < compiled.node_count; i++) {
+		if (!compiled.nodes[i].literal) {
+			has_conversion = true;
+			if (compiled.nodes[i].fs.type == TYPE_custom) {
+				has_custom = true;
+			}
+		}
+	}
+	if (has_conversion) {
+		fprintf(source, "\tformat_specifier fs;\n");
+		if (has_custom) {
+			fprintf(source, "\tprintf_arg argument;\n");
+		}
+		fprintf(source, "\n");
+	}
+	for (size_t i = 0; i < compiled.node_count; i++) {
+		node = compiled.nodes + i;
+		if (node->literal) {
+			write_literal(source, format + node->offset, node->length);
+		} else {
+			write_conversion(source, node);
+		}
+	}
+	fprintf(source, "\treturn true;\n}\n");
+
+	free(types);
+	printf_compiled_free(&compiled);
+	return true;
+}
+
+
+
+// Writes an include guard for the generated header, from its file name.
+// Parameters:
+//     header - where to write.
+//     path - the file name of the header.
+static void write_header_guard(FILE *header, const char *path)
+{
+	char guard[LINE_SIZE];
+	size_t length = 0;
+
+	for (; *path != '\0' && length < sizeof(guard) - 1; path++) {
+		guard[length++] = isalnum((unsigned char) *path) ?
+						  toupper((unsigned char) *path) : '_';
+	}
+	guard[length] = '\0';
+	fprintf(header, "#ifndef %s\n#define %s\n\n", guard, guard);
+}
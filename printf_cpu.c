@@ -0,0 +1,325 @@
+// Part of printf function suite. Picks the vectorised kernels to use for this
+// processor. Features are checked once, on first use, and a function pointer
+// bound for each kernel, so every module gets the best version the processor
+// runs without checking again.
+//
+// Setting the environment variable PRINTF_CPU limits which features are used,
+// to "scalar", "sse2", "sse4.2", "avx2" or "avx512", e.g. PRINTF_CPU=scalar to
+// test the plain C kernels on any machine. It is read on first use only.
+//
+// Kernels here may read past the end of their input, but only within the
+// aligned block it ends in, which can never cross into another page. That is
+// safe, but isn't understood by AddressSanitizer, so it is turned off for
+// them.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "printf_definitions.h"
+#include "printf_decimal.h"
+#include "printf_json.h"
+#include "printf_binary.h"
+#include "printf_cpu.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_X86
+#include <immintrin.h>
+#endif
+
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+static printf_cpu_kernels cpu_kernels;
+
+
+
+static void cpu_initialise(void);
+static unsigned int cpu_detect_features(void);
+static unsigned int cpu_feature_limit(const char *name);
+static size_t cpu_find_percent_scalar(const char *format);
+static size_t cpu_strnlen_scalar(const char *string, size_t max);
+#ifdef CPU_X86
+static size_t cpu_find_percent_sse2(const char *format);
+static size_t cpu_find_percent_avx2(const char *format);
+static size_t cpu_strnlen_sse2(const char *string, size_t max);
+static size_t cpu_strnlen_avx2(const char *string, size_t max);
+#endif
+
+
+
+// Gets the kernels for this processor, picking them on the first call.
+// Returns:
+//     the kernels, never NULL.
+const printf_cpu_kernels* printf_cpu(void)
+{
+	pthread_once(&cpu_once, cpu_initialise);
+	return &cpu_kernels;
+}
+
+
+
+// Binds the kernels, for pthread_once.
+static void cpu_initialise(void)
+{
+	unsigned int features = cpu_detect_features();
+
+	features &= cpu_feature_limit(getenv("PRINTF_CPU"));
+	cpu_kernels.features = features;
+
+	cpu_kernels.find_percent = cpu_find_percent_scalar;
+	cpu_kernels.strnlen = cpu_strnlen_scalar;
+	cpu_kernels.decimal_u32 = printf_decimal_kernel_scalar;
+	cpu_kernels.json_plain = printf_json_kernel_scalar;
+	cpu_kernels.hex = printf_binary_hex_scalar;
+	cpu_kernels.base64 = printf_binary_base64_scalar;
+#ifdef CPU_X86
+	// Nothing uses AVX-512 yet, those processors get the AVX2 kernels. The
+	// decimal kernel only needs SSE4.1, and the binary kernels SSSE3, which
+	// come with SSE4.2.
+	if (features & CPU_FEATURE_sse2) {
+		cpu_kernels.find_percent = cpu_find_percent_sse2;
+		cpu_kernels.strnlen = cpu_strnlen_sse2;
+		cpu_kernels.json_plain = printf_json_kernel_sse2;
+	}
+	if (features & CPU_FEATURE_sse4_2) {
+		cpu_kernels.decimal_u32 = printf_decimal_kernel_sse41;
+		cpu_kernels.hex = printf_binary_hex_ssse3;
+		cpu_kernels.base64 = printf_binary_base64_ssse3;
+	}
+	if (features & CPU_FEATURE_avx2) {
+		cpu_kernels.find_percent = cpu_find_percent_avx2;
+		cpu_kernels.strnlen = cpu_strnlen_avx2;
+		cpu_kernels.decimal_u32 = printf_decimal_kernel_avx2;
+		cpu_kernels.json_plain = printf_json_kernel_avx2;
+		cpu_kernels.hex = printf_binary_hex_avx2;
+	}
+#endif
+}
+
+
+
+// Asks the processor what it supports. Each feature is only reported along
+// with those below it, so they can be treated as levels.
+// Returns:
+//     the CPU_FEATURE_* flags.
+static unsigned int cpu_detect_features(void)
+{
+	unsigned int features = 0;
+
+#ifdef CPU_X86
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("sse2")) {
+		return features;
+	}
+	features |= CPU_FEATURE_sse2;
+	if (!__builtin_cpu_supports("sse4.2")) {
+		return features;
+	}
+	features |= CPU_FEATURE_sse4_2;
+	if (!__builtin_cpu_supports("avx2")) {
+		return features;
+	}
+	features |= CPU_FEATURE_avx2;
+	if (!__builtin_cpu_supports("avx512f") ||
+		!__builtin_cpu_supports("avx512bw"))
+	{
+		return features;
+	}
+	features |= CPU_FEATURE_avx512;
+#endif
+	return features;
+}
+
+
+
+// Works out which features PRINTF_CPU allows.
+// Parameters:
+//     name - the value of PRINTF_CPU, may be NULL.
+// Returns:
+//     the CPU_FEATURE_* flags allowed, all of them if name is NULL or unknown.
+static unsigned int cpu_feature_limit(const char *name)
+{
+	if (name == NULL) {
+		return UINT_MAX;
+	} else if (strcmp(name, "scalar") == 0) {
+		return 0;
+	} else if (strcmp(name, "sse2") == 0) {
+		return CPU_FEATURE_sse2;
+	} else if (strcmp(name, "sse4.2") == 0) {
+		return CPU_FEATURE_sse2 | CPU_FEATURE_sse4_2;
+	} else if (strcmp(name, "avx2") == 0) {
+		return CPU_FEATURE_sse2 | CPU_FEATURE_sse4_2 | CPU_FEATURE_avx2;
+	} else if (strcmp(name, "avx512") == 0) {
+		return CPU_FEATURE_sse2 | CPU_FEATURE_sse4_2 | CPU_FEATURE_avx2 |
+			   CPU_FEATURE_avx512;
+	}
+	return UINT_MAX;
+}
+
+
+
+// Finds the next '%' in a format string, or its end.
+// Parameters:
+//     format - the format string.
+// Returns:
+//     the number of characters before the '%' or '\0'.
+static size_t cpu_find_percent_scalar(const char *format)
+{
+	return strcspn(format, "%");
+}
+
+
+
+// Finds the length of a string, or max, whichever is smaller. Safe to call
+// with NULL if max is 0.
+// Parameters:
+//     string - the string.
+//     max - the most characters of string to read.
+// Returns:
+//     the length of string, or max, whichever is smaller.
+static size_t cpu_strnlen_scalar(const char *string, size_t max)
+{
+	size_t count = 0;
+
+	while (count < max && string[count] != '\0') {
+		count++;
+	}
+	return count;
+}
+
+
+
+#ifdef CPU_X86
+// cpu_find_percent_scalar 16 characters at a time.
+// Parameters:
+//     format - the format string.
+// Returns:
+//     the number of characters before the '%' or '\0'.
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t cpu_find_percent_sse2(const char *format)
+{
+	const __m128i percent = _mm_set1_epi8('%');
+	const __m128i zero = _mm_setzero_si128();
+	// Start at the aligned block format is in, ignoring what comes before.
+	unsigned int offset = (uintptr_t) format & 15;
+	const char *block = format - offset;
+	__m128i chunk = _mm_load_si128((const __m128i*) block);
+	unsigned int found = _mm_movemask_epi8(_mm_or_si128(
+		_mm_cmpeq_epi8(chunk, percent), _mm_cmpeq_epi8(chunk, zero)));
+
+	found &= UINT_MAX << offset;
+	while (found == 0) {
+		block += 16;
+		chunk = _mm_load_si128((const __m128i*) block);
+		found = _mm_movemask_epi8(_mm_or_si128(
+			_mm_cmpeq_epi8(chunk, percent), _mm_cmpeq_epi8(chunk, zero)));
+	}
+	return block + __builtin_ctz(found) - format;
+}
+
+
+
+// cpu_find_percent_scalar 32 characters at a time.
+// Parameters:
+//     format - the format string.
+// Returns:
+//     the number of characters before the '%' or '\0'.
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t cpu_find_percent_avx2(const char *format)
+{
+	const __m256i percent = _mm256_set1_epi8('%');
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned int offset = (uintptr_t) format & 31;
+	const char *block = format - offset;
+	__m256i chunk = _mm256_load_si256((const __m256i*) block);
+	unsigned int found = _mm256_movemask_epi8(_mm256_or_si256(
+		_mm256_cmpeq_epi8(chunk, percent), _mm256_cmpeq_epi8(chunk, zero)));
+
+	found &= UINT_MAX << offset;
+	while (found == 0) {
+		block += 32;
+		chunk = _mm256_load_si256((const __m256i*) block);
+		found = _mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_cmpeq_epi8(chunk, percent), _mm256_cmpeq_epi8(chunk, zero)));
+	}
+	return block + __builtin_ctz(found) - format;
+}
+
+
+
+// cpu_strnlen_scalar 16 characters at a time.
+// Parameters:
+//     string - the string.
+//     max - the most characters of string to read.
+// Returns:
+//     the length of string, or max, whichever is smaller.
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t cpu_strnlen_sse2(const char *string, size_t max)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int offset = (uintptr_t) string & 15;
+	const char *block = string - offset;
+	unsigned int found = 0;
+	size_t length = 0;
+
+	if (max == 0) {
+		return 0;
+	}
+	found = _mm_movemask_epi8(_mm_cmpeq_epi8(
+		_mm_load_si128((const __m128i*) block), zero));
+	found &= UINT_MAX << offset;
+	while (found == 0) {
+		block += 16;
+		if ((size_t) (block - string) >= max) {
+			return max;
+		}
+		found = _mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_load_si128((const __m128i*) block), zero));
+	}
+	length = block + __builtin_ctz(found) - string;
+	return length < max ? length : max;
+}
+
+
+
+// cpu_strnlen_scalar 32 characters at a time.
+// Parameters:
+//     string - the string.
+//     max - the most characters of string to read.
+// Returns:
+//     the length of string, or max, whichever is smaller.
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t cpu_strnlen_avx2(const char *string, size_t max)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned int offset = (uintptr_t) string & 31;
+	const char *block = string - offset;
+	unsigned int found = 0;
+	size_t length = 0;
+
+	if (max == 0) {
+		return 0;
+	}
+	found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+		_mm256_load_si256((const __m256i*) block), zero));
+	found &= UINT_MAX << offset;
+	while (found == 0) {
+		block += 32;
+		if ((size_t) (block - string) >= max) {
+			return max;
+		}
+		found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			_mm256_load_si256((const __m256i*) block), zero));
+	}
+	length = block + __builtin_ctz(found) - string;
+	return length < max ? length : max;
+}
+#endif
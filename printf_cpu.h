@@ -0,0 +1,12 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_CPU_H
+#define PRINTF_CPU_H
+
+#include "printf_definitions.h"
+
+const printf_cpu_kernels* printf_cpu(void);
+
+#endif // PRINTF_CPU_H
@@ -0,0 +1,375 @@
+// Part of printf function suite. Holds the conversion letters printf knows,
+// and any conversions registered by the user, e.g. "%V" or "%{ipv4}". Each
+// letter after '%' and any length is looked up in a table of 256 types, and
+// each name in a hash table, so adding conversions doesn't slow parsing.
+//
+// A registered conversion reads one argument, as one of the standard
+// conversions would, then its function writes it given the format_specifier,
+// the output and the argument, with no temporary string. Conversions should be
+// registered before printing with them, as the tables aren't locked against
+// printing from other threads while registering.
+//
+// A named conversion may be given a number, "%{name:N}", which its function
+// finds in fs->custom_option.
+//
+// The built in named conversions are added the same way, and may be replaced
+// by registering the same name:
+//     %{json} - a string escaped for JSON, see printf_json.c.
+//     %{hex}, %{HEX}, %{base64}, %{base64url} - bytes, as many as the
+//         precision, see printf_binary.c.
+//     %{bignum}, %{bignumhex} - integers of as many 64 bit limbs as the
+//         precision, see printf_bignum.c.
+//     %{iec}, %{si}, %{fixed} - integers scaled with a binary or SI prefix,
+//         or with implied decimals, see printf_quantity.c.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "printf_definitions.h"
+#include "printf_custom.h"
+#include "printf_json.h"
+#include "printf_binary.h"
+#include "printf_bignum.h"
+#include "printf_quantity.h"
+
+// The most conversions that can be registered.
+#define CUSTOM_MAX 128
+// Slots in the table of names, a power of two with plenty spare.
+#define CUSTOM_TABLE_SIZE 256
+
+static pthread_once_t custom_once = PTHREAD_ONCE_INIT;
+// Held while registering.
+static pthread_mutex_t custom_mutex = PTHREAD_MUTEX_INITIALIZER;
+// The type of each letter, TYPE_ERROR if it isn't a conversion.
+static format_string_types custom_types[256];
+// The conversion of each TYPE_custom letter.
+static const printf_custom_conversion *custom_letters[256];
+// Named conversions by hash, probing linearly from there.
+static const printf_custom_conversion *custom_names[CUSTOM_TABLE_SIZE];
+static printf_custom_conversion custom_conversions[CUSTOM_MAX];
+static size_t custom_count = 0;
+
+// The named conversions there are before any are registered.
+static const struct {
+	const char *name;
+	format_string_types argument;
+	printf_custom_function function;
+} custom_builtins[] = {
+	{"json", TYPE_s, printf_json_write},
+	{"hex", TYPE_p, printf_binary_hex_write},
+	{"HEX", TYPE_p, printf_binary_hex_upper_write},
+	{"base64", TYPE_p, printf_binary_base64_write},
+	{"base64url", TYPE_p, printf_binary_base64url_write},
+	{"bignum", TYPE_p, printf_bignum_write},
+	{"bignumhex", TYPE_p, printf_bignum_hex_write},
+	{"iec", TYPE_u, printf_quantity_iec_write},
+	{"si", TYPE_d, printf_quantity_si_write},
+	{"fixed", TYPE_d, printf_quantity_fixed_write}
+};
+
+
+
+static void custom_initialise(void);
+static uint32_t custom_hash(const char *name, size_t length);
+static bool custom_argument_allowed(format_string_types argument);
+static printf_custom_conversion* custom_new(void);
+static printf_custom_conversion* custom_find(const char *name, size_t length);
+static printf_custom_conversion* custom_add_name(const char *name,
+												 size_t length);
+
+
+
+// Registers a conversion letter, e.g. 'V' for "%V". Registering a letter
+// again replaces it.
+// Parameters:
+//     letter - the letter. Can't be a standard conversion, flag, digit or
+//         length.
+//     argument - how the argument is read: as for TYPE_d, TYPE_i, TYPE_u,
+//         TYPE_c, TYPE_s or TYPE_p.
+//     function - writes the conversion.
+//     context - given to function.
+// Returns:
+//     true on success, false if the letter or argument isn't allowed or too
+//     many conversions are registered.
+bool printf_register_conversion(char letter, format_string_types argument,
+								printf_custom_function function,
+								void *context)
+{
+	unsigned char index = letter;
+	printf_custom_conversion *conversion = NULL;
+	bool result = false;
+
+	if (function == NULL || !custom_argument_allowed(argument) ||
+		letter == '\0' || strchr("-+ #'0123456789.*$hljztLw%{", letter) != NULL)
+	{
+		return false;
+	}
+
+	pthread_once(&custom_once, custom_initialise);
+	pthread_mutex_lock(&custom_mutex);
+	if (custom_types[index] == TYPE_custom) {
+		conversion = (printf_custom_conversion*) custom_letters[index];
+	} else if (custom_types[index] == TYPE_ERROR) {
+		conversion = custom_new();
+	}
+	if (conversion != NULL) {
+		conversion->letter = letter;
+		conversion->argument = argument;
+		conversion->function = function;
+		conversion->context = context;
+		custom_letters[index] = conversion;
+		custom_types[index] = TYPE_custom;
+		result = true;
+	}
+	pthread_mutex_unlock(&custom_mutex);
+	return result;
+}
+
+
+
+// Registers a named conversion, e.g. "ipv4" for "%{ipv4}". Registering a
+// name again replaces it.
+// Parameters:
+//     name - the name, shorter than PRINTF_CUSTOM_NAME_SIZE, without '}' or
+//         ':'.
+//     argument - how the argument is read: as for TYPE_d, TYPE_i, TYPE_u,
+//         TYPE_c, TYPE_s or TYPE_p.
+//     function - writes the conversion.
+//     context - given to function.
+// Returns:
+//     true on success, false if the name or argument isn't allowed or too
+//     many conversions are registered.
+bool printf_register_named_conversion(const char *name,
+									  format_string_types argument,
+									  printf_custom_function function,
+									  void *context)
+{
+	printf_custom_conversion *conversion = NULL;
+	size_t length = 0;
+	bool result = false;
+
+	if (name == NULL || function == NULL ||
+		!custom_argument_allowed(argument))
+	{
+		return false;
+	}
+	length = strlen(name);
+	if (length == 0 || length >= PRINTF_CUSTOM_NAME_SIZE ||
+		strchr(name, '}') != NULL || strchr(name, ':') != NULL)
+	{
+		return false;
+	}
+
+	pthread_once(&custom_once, custom_initialise);
+	pthread_mutex_lock(&custom_mutex);
+	conversion = custom_add_name(name, length);
+	if (conversion != NULL) {
+		conversion->argument = argument;
+		conversion->function = function;
+		conversion->context = context;
+		result = true;
+	}
+	pthread_mutex_unlock(&custom_mutex);
+	return result;
+}
+
+
+
+// Looks up the type of a conversion letter.
+// Parameters:
+//     letter - the letter after '%' and any length.
+//     custom - where to store the conversion for TYPE_custom, NULL otherwise.
+// Returns:
+//     the type, TYPE_ERROR if letter isn't a conversion.
+format_string_types printf_custom_letter(
+	char letter, const printf_custom_conversion **custom)
+{
+	unsigned char index = letter;
+
+	pthread_once(&custom_once, custom_initialise);
+	*custom = custom_letters[index];
+	return custom_types[index];
+}
+
+
+
+// Looks up a named conversion.
+// Parameters:
+//     name - the name, needn't be '\0' terminated.
+//     length - the length of name.
+// Returns:
+//     the conversion, NULL if there is none by that name.
+const printf_custom_conversion* printf_custom_find(const char *name,
+												   size_t length)
+{
+	pthread_once(&custom_once, custom_initialise);
+	return custom_find(name, length);
+}
+
+
+
+// Writes a registered conversion.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, of TYPE_custom.
+//     argument - the argument, as read for fs->custom->argument.
+// Returns:
+//     true on success, false on error.
+bool printf_custom_write(output_specifier *output, const format_specifier *fs,
+						 const printf_arg *argument)
+{
+	return fs->custom->function(output, fs, argument, fs->custom->context);
+}
+
+
+
+// Fills in the standard conversion letters and built in named conversions,
+// for pthread_once.
+static void custom_initialise(void)
+{
+	static const char letters[] = "diuoxXbBfFeEgGaAcspn";
+	static const format_string_types types[] = {
+		TYPE_d, TYPE_i, TYPE_u, TYPE_o, TYPE_x, TYPE_X, TYPE_b, TYPE_B,
+		TYPE_f, TYPE_F, TYPE_e, TYPE_E, TYPE_g, TYPE_G, TYPE_a, TYPE_A,
+		TYPE_c, TYPE_s, TYPE_p, TYPE_n
+	};
+	size_t builtin_count = sizeof(custom_builtins) / sizeof(custom_builtins[0]);
+	printf_custom_conversion *conversion = NULL;
+
+	for (int i = 0; i < 256; i++) {
+		custom_types[i] = TYPE_ERROR;
+	}
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		custom_types[(unsigned char) letters[i]] = types[i];
+	}
+	for (size_t i = 0; i < builtin_count; i++) {
+		conversion = custom_add_name(custom_builtins[i].name,
+									 strlen(custom_builtins[i].name));
+		conversion->argument = custom_builtins[i].argument;
+		conversion->function = custom_builtins[i].function;
+	}
+}
+
+
+
+// Hashes a name, FNV-1a.
+// Parameters:
+//     name - the name, needn't be '\0' terminated.
+//     length - the length of name.
+// Returns:
+//     the hash.
+static uint32_t custom_hash(const char *name, size_t length)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char) name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+
+// Whether a conversion may read its argument as a type.
+// Parameters:
+//     argument - the type.
+// Returns:
+//     true if allowed, false if not.
+static bool custom_argument_allowed(format_string_types argument)
+{
+	return (argument == TYPE_d || argument == TYPE_i || argument == TYPE_u ||
+			argument == TYPE_c || argument == TYPE_s || argument == TYPE_p);
+}
+
+
+
+// Takes an unused conversion. Must hold custom_mutex.
+// Returns:
+//     the conversion, cleared, or NULL if all are used.
+static printf_custom_conversion* custom_new(void)
+{
+	printf_custom_conversion *conversion = NULL;
+
+	if (custom_count == CUSTOM_MAX) {
+		return NULL;
+	}
+	conversion = custom_conversions + custom_count++;
+	memset(conversion, 0, sizeof(*conversion));
+	return conversion;
+}
+
+
+
+// Looks up a named conversion, without making sure the tables are set up.
+// Parameters:
+//     name - the name, needn't be '\0' terminated.
+//     length - the length of name.
+// Returns:
+//     the conversion, NULL if there is none by that name.
+static printf_custom_conversion* custom_find(const char *name, size_t length)
+{
+	uint32_t hash = 0;
+	size_t slot = 0;
+	const printf_custom_conversion *conversion = NULL;
+
+	if (length == 0 || length >= PRINTF_CUSTOM_NAME_SIZE) {
+		return NULL;
+	}
+	hash = custom_hash(name, length);
+	slot = hash & (CUSTOM_TABLE_SIZE - 1);
+	while ((conversion = custom_names[slot]) != NULL) {
+		if (conversion->hash == hash &&
+			strncmp(conversion->name, name, length) == 0 &&
+			conversion->name[length] == '\0')
+		{
+			return (printf_custom_conversion*) conversion;
+		}
+		slot = (slot + 1) & (CUSTOM_TABLE_SIZE - 1);
+	}
+	return NULL;
+}
+
+
+
+// Finds a named conversion to fill in, adding it if there is none. Must hold
+// custom_mutex, or be setting up the tables.
+// Parameters:
+//     name - the name, checked by the caller.
+//     length - the length of name.
+// Returns:
+//     the conversion, or NULL if all are used.
+static printf_custom_conversion* custom_add_name(const char *name,
+												 size_t length)
+{
+	printf_custom_conversion *conversion = custom_find(name, length);
+	size_t slot = 0;
+
+	if (conversion != NULL) {
+		return conversion;
+	}
+	conversion = custom_new();
+	if (conversion == NULL) {
+		return NULL;
+	}
+	memcpy(conversion->name, name, length);
+	conversion->name[length] = '\0';
+	conversion->hash = custom_hash(name, length);
+	// There are always free slots, as there are more than CUSTOM_MAX.
+	slot = conversion->hash & (CUSTOM_TABLE_SIZE - 1);
+	while (custom_names[slot] != NULL) {
+		slot = (slot + 1) & (CUSTOM_TABLE_SIZE - 1);
+	}
+	custom_names[slot] = conversion;
+	return conversion;
+}
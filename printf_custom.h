@@ -0,0 +1,25 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_CUSTOM_H
+#define PRINTF_CUSTOM_H
+
+#include "printf_definitions.h"
+
+bool printf_register_conversion(char letter, format_string_types argument, 
+								printf_custom_function function, 
+								void *context);
+bool printf_register_named_conversion(const char *name, 
+									  format_string_types argument, 
+									  printf_custom_function function, 
+									  void *context);
+
+format_string_types printf_custom_letter(char letter, 
+	const printf_custom_conversion **custom);
+const printf_custom_conversion* printf_custom_find(const char *name, 
+												   size_t length);
+bool printf_custom_write(output_specifier *output, const format_specifier *fs, 
+						 const printf_arg *argument);
+
+#endif // PRINTF_CUSTOM_H
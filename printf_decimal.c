@@ -0,0 +1,574 @@
+// Part of printf function suite. Writes arrays of unsigned integers in
+// decimal, e.g. a column of a CSV export, with a separator between them.
+// Each value is written as "%u" would with the given format_specifier.
+//
+// 32 bit values are converted eight at a time. The kernel splits each value
+// into a high part (up to 42) and eight low digits, using multiplies by
+// reciprocals instead of division, and turns the low digits into characters
+// in vector registers. AVX2 and SSE4.1 kernels are used when the processor
+// has them, as picked by printf_cpu.c, otherwise a scalar kernel does the same
+// with a table of two digit pairs. 64 bit values use the table directly.
+//
+// printf_decimal_write_u32 writes a single value the same way, for "%wNu"
+// and the other lengths of 32 bits or fewer, so they aren't widened and
+// divided as uintmax_t.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_basic_output.h"
+#include "printf_decimal.h"
+#include "printf_cpu.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DECIMAL_X86
+#include <immintrin.h>
+#endif
+
+// Output is collected in a buffer of this size before being handed on.
+#define DECIMAL_BUFFER_SIZE 4096
+// The widest single value, padding included, written without the sink.
+#define DECIMAL_SINGLE_SIZE 32
+// The number of values a kernel converts at once.
+#define DECIMAL_BLOCK 8
+
+// Collects output for a run of values.
+typedef struct decimal_sink_struct {
+	output_specifier *output;
+	char buffer[DECIMAL_BUFFER_SIZE];
+	size_t used;
+	bool result;
+} decimal_sink;
+
+// "00" to "99", for writing two digits at a time.
+static const char decimal_pairs[201] =
+	"00010203040506070809101112131415161718192021222324"
+	"25262728293031323334353637383940414243444546474849"
+	"50515253545556575859606162636465666768697071727374"
+	"75767778798081828384858687888990919293949596979899";
+
+
+
+static int decimal_length_u32(uint32_t value);
+static bool decimal_plain(const format_specifier *fs);
+static void decimal_put(decimal_sink *sink, const char *span, size_t length);
+static void decimal_fill(decimal_sink *sink, char character, size_t length);
+static void decimal_put_padded(decimal_sink *sink, const char *digits,
+							   int length, const format_specifier *fs);
+static bool decimal_flush(decimal_sink *sink);
+
+
+
+// Writes an array of 32 bit unsigned integers in decimal.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Not
+//         finished, so more can be printed to it.
+//     values - the values to write.
+//     count - the number of values.
+//     separator - written between values, may be NULL for nothing.
+//     fs - how to write each value, as for "%u". NULL for plain "%u".
+// Returns:
+//     true on success, false on error.
+bool printf_decimal_u32(output_specifier *output, const uint32_t *values,
+						size_t count, const char *separator,
+						const format_specifier *fs)
+{
+	decimal_sink sink;
+	void (*kernel)(const uint32_t *values, char *digits) = NULL;
+	// Room for a whole block, so the tail can be converted as one.
+	uint32_t block[DECIMAL_BLOCK];
+	// Both have slack so that values can be copied 16 bytes at a time.
+	char digits[DECIMAL_BLOCK * 8 + 16];
+	// A nine or ten digit value, the high part in front of its low digits.
+	char whole[16];
+	const char *source = NULL;
+	unsigned int width = 0;
+	size_t separator_length = 0;
+	size_t done = 0;
+	size_t block_count = 0;
+	uint32_t high = 0;
+	int length = 0;
+
+	assert(output != NULL);
+	assert(values != NULL || count == 0);
+	if (output == NULL) {
+		return false;
+	}
+	if (separator != NULL) {
+		separator_length = strlen(separator);
+	}
+	if (fs != NULL) {
+		width = fs->width;
+	}
+
+	// Anything the kernels don't cover goes the usual way, one at a time.
+	if (fs != NULL && !decimal_plain(fs)) {
+		for (size_t i = 0; i < count; i++) {
+			if (i != 0 && separator_length != 0 &&
+				!printf_output_span(output, separator, separator_length))
+			{
+				return false;
+			}
+			if (!write_decimal_positive(output, values[i], fs)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	kernel = printf_cpu()->decimal_u32;
+	sink.output = output;
+	sink.used = 0;
+	sink.result = true;
+	while (done < count && sink.result) {
+		block_count = count - done;
+		if (block_count >= DECIMAL_BLOCK) {
+			block_count = DECIMAL_BLOCK;
+			kernel(values + done, digits);
+		} else {
+			memset(block, 0, sizeof(block));
+			memcpy(block, values + done, block_count * sizeof(uint32_t));
+			kernel(block, digits);
+		}
+
+		for (size_t i = 0; i < block_count; i++) {
+			length = decimal_length_u32(values[done + i]);
+			if (length <= 8) {
+				source = digits + 8 * i + 8 - length;
+			} else {
+				high = values[done + i] / 100000000;
+				if (high >= 10) {
+					memcpy(whole, decimal_pairs + 2 * high, 2);
+				} else {
+					whole[0] = '0' + high;
+				}
+				memcpy(whole + length - 8, digits + 8 * i, 8);
+				source = whole;
+			}
+
+			if (sink.used + separator_length + 16 > DECIMAL_BUFFER_SIZE) {
+				decimal_flush(&sink);
+			}
+			if (width <= (unsigned int) length &&
+				sink.used + separator_length + 16 <= DECIMAL_BUFFER_SIZE)
+			{
+				// The usual case, no padding and room to spare. Copying a
+				// fixed 16 bytes is quicker than copying length.
+				if (done + i != 0) {
+					memcpy(sink.buffer + sink.used, separator,
+						   separator_length);
+					sink.used += separator_length;
+				}
+				memcpy(sink.buffer + sink.used, source, 16);
+				sink.used += length;
+			} else {
+				if (done + i != 0) {
+					decimal_put(&sink, separator, separator_length);
+				}
+				decimal_put_padded(&sink, source, length, fs);
+			}
+		}
+		done += block_count;
+	}
+
+	return decimal_flush(&sink);
+}
+
+
+
+// Writes an array of 64 bit unsigned integers in decimal.
+// Parameters:
+//     output - set up with a printf_output_initialise_* function. Not
+//         finished, so more can be printed to it.
+//     values - the values to write.
+//     count - the number of values.
+//     separator - written between values, may be NULL for nothing.
+//     fs - how to write each value, as for "%u". NULL for plain "%u".
+// Returns:
+//     true on success, false on error.
+bool printf_decimal_u64(output_specifier *output, const uint64_t *values,
+						size_t count, const char *separator,
+						const format_specifier *fs)
+{
+	decimal_sink sink;
+	// Written backwards from the end, two digits at a time.
+	char digits[20];
+	size_t separator_length = 0;
+	uint64_t value = 0;
+	int start = 0;
+
+	assert(output != NULL);
+	assert(values != NULL || count == 0);
+	if (output == NULL) {
+		return false;
+	}
+	if (separator != NULL) {
+		separator_length = strlen(separator);
+	}
+
+	if (fs != NULL && !decimal_plain(fs)) {
+		for (size_t i = 0; i < count; i++) {
+			if (i != 0 && separator_length != 0 &&
+				!printf_output_span(output, separator, separator_length))
+			{
+				return false;
+			}
+			if (!write_decimal_positive(output, values[i], fs)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	sink.output = output;
+	sink.used = 0;
+	sink.result = true;
+	for (size_t i = 0; i < count && sink.result; i++) {
+		if (i != 0) {
+			decimal_put(&sink, separator, separator_length);
+		}
+		value = values[i];
+		start = sizeof(digits);
+		while (value >= 100) {
+			start -= 2;
+			memcpy(digits + start, decimal_pairs + 2 * (value % 100), 2);
+			value /= 100;
+		}
+		if (value >= 10) {
+			start -= 2;
+			memcpy(digits + start, decimal_pairs + 2 * value, 2);
+		} else {
+			digits[--start] = '0' + value;
+		}
+		decimal_put_padded(&sink, digits + start, sizeof(digits) - start, fs);
+	}
+
+	return decimal_flush(&sink);
+}
+
+
+
+// Writes a 32 bit unsigned integer in decimal, as write_decimal_positive
+// does, dividing by 100 as 32 bits instead of as uintmax_t.
+// Parameters:
+//     output - where to write to.
+//     value - the value to write.
+//     fs - how to write it, as for "%u".
+// Returns:
+//     true on success, false on error.
+bool printf_decimal_write_u32(output_specifier *output, uint32_t value,
+							  const format_specifier *fs)
+{
+	char buffer[DECIMAL_SINGLE_SIZE];
+	char *digits = buffer;
+	int length = decimal_length_u32(value);
+	int padding = 0;
+	int end = 0;
+
+	if (!decimal_plain(fs) || fs->width > DECIMAL_SINGLE_SIZE) {
+		return write_decimal_positive(output, value, fs);
+	}
+	if (fs->width > (unsigned int) length) {
+		padding = fs->width - length;
+	}
+	if (fs->left_justify) {
+		memset(buffer + length, ' ', padding);
+	} else {
+		memset(buffer, fs->zero_padded ? '0' : ' ', padding);
+		digits += padding;
+	}
+
+	end = length;
+	while (value >= 100) {
+		end -= 2;
+		memcpy(digits + end, decimal_pairs + 2 * (value % 100), 2);
+		value /= 100;
+	}
+	if (value >= 10) {
+		memcpy(digits, decimal_pairs + 2 * value, 2);
+	} else {
+		digits[0] = '0' + value;
+	}
+	return printf_output_span(output, buffer, length + padding);
+}
+
+
+
+// Converts a block of values without vector instructions, writing the low
+// eight digits of each, with leading zeros, to digits + 8 * i.
+// Parameters:
+//     values - DECIMAL_BLOCK values.
+//     digits - where to write the low eight digits of each.
+void printf_decimal_kernel_scalar(const uint32_t *values, char *digits)
+{
+	uint32_t low = 0;
+
+	for (int i = 0; i < DECIMAL_BLOCK; i++) {
+		low = values[i] % 100000000;
+		for (int j = 6; j >= 0; j -= 2) {
+			memcpy(digits + 8 * i + j, decimal_pairs + 2 * (low % 100), 2);
+			low /= 100;
+		}
+	}
+}
+
+
+
+#ifdef DECIMAL_X86
+// Converts a block of values four at a time with SSE4.1.
+// Parameters:
+//     values - DECIMAL_BLOCK values.
+//     digits - where to write the low eight digits of each.
+__attribute__((target("sse4.1")))
+void printf_decimal_kernel_sse41(const uint32_t *values, char *digits)
+{
+	// value / 10^8 is (value * 1441151881) >> 57 for every 32 bit value,
+	// value / 10^4 is (value * 109951163) >> 40 below 10^8.
+	const __m128i high_multiplier = _mm_set1_epi32(1441151881);
+	const __m128i middle_multiplier = _mm_set1_epi32(109951163);
+	const __m128i hundred_million = _mm_set1_epi32(100000000);
+	const __m128i ten_thousand = _mm_set1_epi32(10000);
+	const __m128i hundred = _mm_set1_epi16(100);
+	const __m128i ten = _mm_set1_epi16(10);
+	const __m128i zeros = _mm_set1_epi8('0');
+	__m128i value, even, odd, high, low, upper, lower, pairs;
+	__m128i quotient, remainder, tens, ones, first, second;
+
+	for (int i = 0; i < DECIMAL_BLOCK; i += 4) {
+		value = _mm_loadu_si128((const __m128i*) (values + i));
+
+		// 32x32 to 64 bit multiplies only do the even lanes, so twice.
+		even = _mm_srli_epi64(_mm_mul_epu32(value, high_multiplier), 57);
+		odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(value, 32),
+										   high_multiplier), 57);
+		high = _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+		low = _mm_sub_epi32(value, _mm_mullo_epi32(high, hundred_million));
+
+		// The low eight digits as two four digit halves.
+		even = _mm_srli_epi64(_mm_mul_epu32(low, middle_multiplier), 40);
+		odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(low, 32),
+										   middle_multiplier), 40);
+		upper = _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+		lower = _mm_sub_epi32(low, _mm_mullo_epi32(upper, ten_thousand));
+		pairs = _mm_or_si128(upper, _mm_slli_epi32(lower, 16));
+
+		// Each half as two pairs of digits, x / 100 is (x * 5243) >> 19.
+		quotient = _mm_srli_epi16(_mm_mulhi_epu16(pairs,
+												  _mm_set1_epi16(5243)), 3);
+		remainder = _mm_sub_epi16(pairs, _mm_mullo_epi16(quotient, hundred));
+		first = _mm_unpacklo_epi16(quotient, remainder);
+		second = _mm_unpackhi_epi16(quotient, remainder);
+
+		// Each pair as two digits, x / 10 is (x * 6554) >> 16 below 100.
+		tens = _mm_mulhi_epu16(first, _mm_set1_epi16(6554));
+		ones = _mm_sub_epi16(first, _mm_mullo_epi16(tens, ten));
+		first = _mm_add_epi8(_mm_or_si128(tens, _mm_slli_epi16(ones, 8)),
+							 zeros);
+		tens = _mm_mulhi_epu16(second, _mm_set1_epi16(6554));
+		ones = _mm_sub_epi16(second, _mm_mullo_epi16(tens, ten));
+		second = _mm_add_epi8(_mm_or_si128(tens, _mm_slli_epi16(ones, 8)),
+							  zeros);
+
+		_mm_storeu_si128((__m128i*) (digits + 8 * i), first);
+		_mm_storeu_si128((__m128i*) (digits + 8 * i + 16), second);
+	}
+}
+
+
+
+// Converts a block of values eight at a time with AVX2. The same as
+// printf_decimal_kernel_sse41, in both halves of the registers.
+// Parameters:
+//     values - DECIMAL_BLOCK values.
+//     digits - where to write the low eight digits of each.
+__attribute__((target("avx2")))
+void printf_decimal_kernel_avx2(const uint32_t *values, char *digits)
+{
+	const __m256i high_multiplier = _mm256_set1_epi32(1441151881);
+	const __m256i middle_multiplier = _mm256_set1_epi32(109951163);
+	const __m256i hundred_million = _mm256_set1_epi32(100000000);
+	const __m256i ten_thousand = _mm256_set1_epi32(10000);
+	const __m256i hundred = _mm256_set1_epi16(100);
+	const __m256i ten = _mm256_set1_epi16(10);
+	const __m256i zeros = _mm256_set1_epi8('0');
+	__m256i value, even, odd, high, low, upper, lower, pairs;
+	__m256i quotient, remainder, tens, ones, first, second;
+
+	value = _mm256_loadu_si256((const __m256i*) values);
+
+	even = _mm256_srli_epi64(_mm256_mul_epu32(value, high_multiplier), 57);
+	odd = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(value, 32),
+											 high_multiplier), 57);
+	high = _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+	low = _mm256_sub_epi32(value, _mm256_mullo_epi32(high, hundred_million));
+
+	even = _mm256_srli_epi64(_mm256_mul_epu32(low, middle_multiplier), 40);
+	odd = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(low, 32),
+											 middle_multiplier), 40);
+	upper = _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+	lower = _mm256_sub_epi32(low, _mm256_mullo_epi32(upper, ten_thousand));
+	pairs = _mm256_or_si256(upper, _mm256_slli_epi32(lower, 16));
+
+	quotient = _mm256_srli_epi16(_mm256_mulhi_epu16(pairs,
+											_mm256_set1_epi16(5243)), 3);
+	remainder = _mm256_sub_epi16(pairs, _mm256_mullo_epi16(quotient,
+														   hundred));
+	first = _mm256_unpacklo_epi16(quotient, remainder);
+	second = _mm256_unpackhi_epi16(quotient, remainder);
+
+	tens = _mm256_mulhi_epu16(first, _mm256_set1_epi16(6554));
+	ones = _mm256_sub_epi16(first, _mm256_mullo_epi16(tens, ten));
+	first = _mm256_add_epi8(_mm256_or_si256(tens, _mm256_slli_epi16(ones, 8)),
+							zeros);
+	tens = _mm256_mulhi_epu16(second, _mm256_set1_epi16(6554));
+	ones = _mm256_sub_epi16(second, _mm256_mullo_epi16(tens, ten));
+	second = _mm256_add_epi8(_mm256_or_si256(tens,
+											 _mm256_slli_epi16(ones, 8)),
+							 zeros);
+
+	// Unpacking works within each 128 bit half, giving values 0, 1, 4, 5 in
+	// first and 2, 3, 6, 7 in second. Put them back in order.
+	_mm256_storeu_si256((__m256i*) digits,
+						_mm256_permute2x128_si256(first, second, 0x20));
+	_mm256_storeu_si256((__m256i*) (digits + 32),
+						_mm256_permute2x128_si256(first, second, 0x31));
+}
+#endif
+
+
+
+// Counts the decimal digits in a value.
+// Parameters:
+//     value - the value.
+// Returns:
+//     the number of digits, at least 1.
+static int decimal_length_u32(uint32_t value)
+{
+	static const uint32_t powers[10] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+		1000000000
+	};
+	// log10(2) is about 1233 / 4096, so this is the length give or take one.
+	int length = ((32 - __builtin_clz(value | 1)) * 1233) >> 12;
+
+	return length + ((value | 1) >= powers[length]);
+}
+
+
+
+// Whether the kernels can write values for a format specifier, they only
+// handle width, '-' and '0'.
+// Parameters:
+//     fs - the format specifier.
+// Returns:
+//     true if the kernels can be used, false if not.
+static bool decimal_plain(const format_specifier *fs)
+{
+	return fs->precision == -1 && !fs->always_sign && !fs->empty_sign &&
+		   !fs->thousands_grouping;
+}
+
+
+
+// Adds characters to the sink, handing them on when it fills.
+// Parameters:
+//     sink - the sink.
+//     span - the characters.
+//     length - the number of characters.
+static void decimal_put(decimal_sink *sink, const char *span, size_t length)
+{
+	size_t chunk = 0;
+
+	while (length > 0) {
+		chunk = DECIMAL_BUFFER_SIZE - sink->used;
+		if (chunk > length) {
+			chunk = length;
+		}
+		memcpy(sink->buffer + sink->used, span, chunk);
+		sink->used += chunk;
+		span += chunk;
+		length -= chunk;
+		if (sink->used == DECIMAL_BUFFER_SIZE) {
+			decimal_flush(sink);
+		}
+	}
+}
+
+
+
+// Adds a character to the sink a number of times.
+// Parameters:
+//     sink - the sink.
+//     character - the character.
+//     length - the number of times, may be 0.
+static void decimal_fill(decimal_sink *sink, char character, size_t length)
+{
+	size_t chunk = 0;
+
+	while (length > 0) {
+		chunk = DECIMAL_BUFFER_SIZE - sink->used;
+		if (chunk > length) {
+			chunk = length;
+		}
+		memset(sink->buffer + sink->used, character, chunk);
+		sink->used += chunk;
+		length -= chunk;
+		if (sink->used == DECIMAL_BUFFER_SIZE) {
+			decimal_flush(sink);
+		}
+	}
+}
+
+
+
+// Adds a value's digits to the sink, padded to the width.
+// Parameters:
+//     sink - the sink.
+//     digits - the digits, forwards.
+//     length - the number of digits.
+//     fs - the format specifier, may be NULL for no padding.
+static void decimal_put_padded(decimal_sink *sink, const char *digits,
+							   int length, const format_specifier *fs)
+{
+	size_t padding = 0;
+
+	if (fs != NULL && fs->width > (unsigned int) length) {
+		padding = fs->width - length;
+	}
+	if (padding == 0) {
+		decimal_put(sink, digits, length);
+	} else if (fs->left_justify) {
+		decimal_put(sink, digits, length);
+		decimal_fill(sink, ' ', padding);
+	} else {
+		decimal_fill(sink, fs->zero_padded ? '0' : ' ', padding);
+		decimal_put(sink, digits, length);
+	}
+}
+
+
+
+// Hands on what the sink has collected.
+// Parameters:
+//     sink - the sink.
+// Returns:
+//     true on success, false if this or any earlier hand on failed.
+static bool decimal_flush(decimal_sink *sink)
+{
+	if (sink->result && sink->used != 0) {
+		sink->result = printf_output_span(sink->output, sink->buffer,
+										  sink->used);
+	}
+	sink->used = 0;
+	return sink->result;
+}
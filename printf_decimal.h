@@ -0,0 +1,23 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_DECIMAL_H
+#define PRINTF_DECIMAL_H
+
+#include "printf_definitions.h"
+
+bool printf_decimal_u32(output_specifier *output, const uint32_t *values, 
+						size_t count, const char *separator, 
+						const format_specifier *fs);
+bool printf_decimal_u64(output_specifier *output, const uint64_t *values, 
+						size_t count, const char *separator, 
+						const format_specifier *fs);
+bool printf_decimal_write_u32(output_specifier *output, uint32_t value,
+							  const format_specifier *fs);
+
+void printf_decimal_kernel_scalar(const uint32_t *values, char *digits);
+void printf_decimal_kernel_sse41(const uint32_t *values, char *digits);
+void printf_decimal_kernel_avx2(const uint32_t *values, char *digits);
+
+#endif // PRINTF_DECIMAL_H
@@ -0,0 +1,673 @@
+// Part of printf function suite. Writes decimal floating point numbers, for
+// TS 18661-2's lengths:
+//     %Hf - _Decimal32.
+//     %Df - _Decimal64.
+//     %DDf - _Decimal128.
+// with the 'f', 'F', 'e', 'E', 'g' and 'G' conversions, e.g.
+//     _Decimal64 price = 12.345DD;
+//     new_printf("%.2Df\n", price);
+// writes "12.34". These need PRINTF_DECIMAL_FLOAT, the compiler's decimal
+// types in the BID encoding, as GCC has for C on x86.
+//
+// The value is never converted to binary floating point. The encoding is
+// split into a sign, an integer coefficient and a power of ten exponent, the
+// coefficient is turned into its digits, and rounding to the precision is
+// done on the digits, half to even, as the default decimal rounding mode
+// does. So every value is written exactly, however many digits are asked
+// for, and "%.2Df" of 0.125DD is "0.12".
+//
+// Flags work as for binary floating point, '#' keeps the decimal point and
+// "%g"'s trailing zeros, and ' groups the whole part. The decimal point is
+// the locale's.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_decimal_float.h"
+#include "printf_locale.h"
+
+#ifdef PRINTF_DECIMAL_FLOAT
+
+// The most digits in a coefficient, _Decimal128's.
+#define DECIMAL_FLOAT_DIGITS 34
+// 10^19, the most digits that fit in a uint64_t at once.
+#define DECIMAL_FLOAT_TEN_19 UINT64_C(10000000000000000000)
+
+// What a decoded value is.
+typedef enum {
+	DECIMAL_FLOAT_finite, DECIMAL_FLOAT_infinite, DECIMAL_FLOAT_nan
+} decimal_float_class;
+
+// A decoded finite value, the digits times 10 to the exponent.
+typedef struct decimal_float_struct {
+	bool negative;
+	// The digits, with no leading zeros, "0" for zero.
+	char digits[DECIMAL_FLOAT_DIGITS];
+	int count;
+	int exponent;
+} decimal_float;
+
+// Where the characters of a number come from, without its sign or padding.
+// The whole part is the first whole_length digits, then whole_zeros zeros.
+// The fraction is leading_zeros zeros, fraction_length digits, then
+// trailing_zeros zeros.
+typedef struct decimal_float_layout_struct {
+	const char *whole;
+	size_t whole_length;
+	size_t whole_zeros;
+	bool point;
+	size_t leading_zeros;
+	const char *fraction;
+	size_t fraction_length;
+	size_t trailing_zeros;
+	// "e+05" and the like, empty for "%f".
+	char exponent[8];
+	size_t exponent_length;
+} decimal_float_layout;
+
+
+
+static decimal_float_class decimal_float_decode(printf_uint128 bits,
+												format_string_lengths length,
+												decimal_float *value);
+static int decimal_float_digits(char *digits, uint64_t value, int minimum);
+static void decimal_float_round(decimal_float *value, int keep);
+static void decimal_float_trim(decimal_float *value);
+static void decimal_float_fixed(decimal_float_layout *layout,
+								const decimal_float *value, int precision,
+								bool alternate);
+static void decimal_float_scientific(decimal_float_layout *layout,
+									 const decimal_float *value,
+									 int precision, bool alternate,
+									 bool upper);
+static bool decimal_float_write_layout(output_specifier *output,
+									   const format_specifier *fs,
+									   bool negative,
+									   const decimal_float_layout *layout);
+static bool decimal_float_write_whole(output_specifier *output,
+									  const decimal_float_layout *layout,
+									  uint64_t boundaries,
+									  const printf_grouping *locale);
+static bool decimal_float_separator(const printf_grouping *locale,
+									uint64_t boundaries, size_t right);
+static bool decimal_float_write_special(output_specifier *output,
+										const format_specifier *fs,
+										bool negative, const char *text);
+static bool decimal_float_pad(output_specifier *output, char character,
+							  size_t length);
+
+
+
+// Writes a decimal floating point number.
+// Parameters:
+//     output - where to write to.
+//     bits - the BID encoding, in the low 32, 64 or 128 bits as fs's length
+//         says.
+//     fs - the format specifier, of LENGTH_H, LENGTH_D or LENGTH_DD, and
+//         TYPE_f, TYPE_F, TYPE_e, TYPE_E, TYPE_g or TYPE_G.
+// Returns:
+//     true on success, false on error.
+bool printf_decimal_float_write(output_specifier *output, printf_uint128 bits,
+								const format_specifier *fs)
+{
+	bool upper = fs->type == TYPE_F || fs->type == TYPE_E ||
+				 fs->type == TYPE_G;
+	decimal_float_layout layout;
+	decimal_float value;
+	int precision = (fs->precision == -1) ? 6 : fs->precision;
+	int exponent = 0;
+
+	switch (decimal_float_decode(bits, fs->length, &value)) {
+		case DECIMAL_FLOAT_infinite:
+			return decimal_float_write_special(output, fs, value.negative,
+											   upper ? "INF" : "inf");
+		case DECIMAL_FLOAT_nan:
+			return decimal_float_write_special(output, fs, value.negative,
+											   upper ? "NAN" : "nan");
+		default:
+			break;
+	}
+
+	switch (fs->type) {
+		case TYPE_f:
+			// PASS-THROUGH
+		case TYPE_F:
+			// Rounded where the precision ends, if there are digits past it.
+			if (value.exponent < -precision) {
+				decimal_float_round(&value, value.count + value.exponent +
+											precision);
+			}
+			decimal_float_fixed(&layout, &value, precision,
+								fs->alternate_form);
+			break;
+		case TYPE_e:
+			// PASS-THROUGH
+		case TYPE_E:
+			if (precision < value.count - 1) {
+				decimal_float_round(&value, precision + 1);
+			}
+			decimal_float_scientific(&layout, &value, precision,
+									 fs->alternate_form, upper);
+			break;
+		default:
+			// "%g", as "%e" or "%f" by the exponent once rounded, with
+			// precision significant digits.
+			if (precision == 0) {
+				precision = 1;
+			}
+			decimal_float_round(&value, precision);
+			exponent = value.exponent + value.count - 1;
+			if (!fs->alternate_form) {
+				decimal_float_trim(&value);
+			}
+			if (exponent < precision && exponent >= -4) {
+				precision = precision - 1 - exponent;
+				if (!fs->alternate_form) {
+					precision = (value.exponent < 0) ? -value.exponent : 0;
+				}
+				decimal_float_fixed(&layout, &value, precision,
+									fs->alternate_form);
+			} else {
+				precision = precision - 1;
+				if (!fs->alternate_form) {
+					precision = value.count - 1;
+				}
+				decimal_float_scientific(&layout, &value, precision,
+										 fs->alternate_form, upper);
+			}
+			break;
+	}
+	return decimal_float_write_layout(output, fs, value.negative, &layout);
+}
+
+
+
+// Splits a BID encoding into its sign, coefficient and exponent.
+// Parameters:
+//     bits - the encoding.
+//     length - LENGTH_H, LENGTH_D or LENGTH_DD, for its size.
+//     value - where to write the value, only the sign for infinity and NaN.
+// Returns:
+//     whether it is finite, infinite or NaN.
+static decimal_float_class decimal_float_decode(printf_uint128 bits,
+												format_string_lengths length,
+												decimal_float *value)
+{
+	// _Decimal64 unless told otherwise.
+	int width = 64;
+	int exponent_bits = 10;
+	int bias = 398;
+	int digits = 16;
+	int coefficient_bits = 0;
+	int exponent = 0;
+	printf_uint128 coefficient = 0;
+	printf_uint128 largest = 1;
+
+	if (length == LENGTH_H) {
+		width = 32;
+		exponent_bits = 8;
+		bias = 101;
+		digits = 7;
+	} else if (length == LENGTH_DD) {
+		width = 128;
+		exponent_bits = 14;
+		bias = 6176;
+		digits = 34;
+	}
+	coefficient_bits = width - 1 - exponent_bits;
+	value->negative = (bits >> (width - 1)) & 1;
+
+	if (((bits >> (width - 3)) & 3) != 3) {
+		exponent = (bits >> coefficient_bits) & ((1u << exponent_bits) - 1);
+		coefficient = bits & (((printf_uint128) 1 << coefficient_bits) - 1);
+	} else if (((bits >> (width - 5)) & 3) == 3) {
+		// The combination field starts "11110" for infinity, "11111" NaN.
+		if ((bits >> (width - 6)) & 1) {
+			return DECIMAL_FLOAT_nan;
+		}
+		return DECIMAL_FLOAT_infinite;
+	} else {
+		// The exponent comes after "11", and the coefficient is "100" then
+		// the rest.
+		coefficient_bits -= 2;
+		exponent = (bits >> coefficient_bits) & ((1u << exponent_bits) - 1);
+		coefficient = ((printf_uint128) 4 << coefficient_bits) |
+					  (bits & (((printf_uint128) 1 << coefficient_bits) - 1));
+	}
+	for (int i = 0; i < digits; i++) {
+		largest *= 10;
+	}
+	if (coefficient >= largest) {
+		// Non-canonical, which means 0.
+		coefficient = 0;
+	}
+
+	value->exponent = exponent - bias;
+	if (coefficient == 0) {
+		// Zero is written the same whatever its exponent.
+		value->exponent = 0;
+	}
+	if (coefficient >= DECIMAL_FLOAT_TEN_19) {
+		value->count = decimal_float_digits(value->digits,
+								(uint64_t) (coefficient / DECIMAL_FLOAT_TEN_19),
+								1);
+		value->count += decimal_float_digits(value->digits + value->count,
+								(uint64_t) (coefficient % DECIMAL_FLOAT_TEN_19),
+								19);
+	} else {
+		value->count = decimal_float_digits(value->digits,
+											(uint64_t) coefficient, 1);
+	}
+	return DECIMAL_FLOAT_finite;
+}
+
+
+
+// Writes the digits of a number, most significant first.
+// Parameters:
+//     digits - where to write them, with room for 20.
+//     value - the number.
+//     minimum - the fewest digits to write, padded with leading zeros.
+// Returns:
+//     the number of digits written.
+static int decimal_float_digits(char *digits, uint64_t value, int minimum)
+{
+	char backwards[20];
+	int count = 0;
+
+	do {
+		backwards[count++] = '0' + (char) (value % 10);
+		value /= 10;
+	} while (value != 0 || count < minimum);
+	for (int i = 0; i < count; i++) {
+		digits[i] = backwards[count - 1 - i];
+	}
+	return count;
+}
+
+
+
+// Rounds a value to a number of significant digits, half to even. Rounding
+// up from all '9's keeps the count and raises the exponent instead.
+// Parameters:
+//     value - the value to round.
+//     keep - the digits to keep, may be 0 or less, when the value rounds to
+//         0, or 1 in the place above its first digit.
+static void decimal_float_round(decimal_float *value, int keep)
+{
+	bool up = false;
+	bool rest = false;
+	char first = 0;
+
+	if (keep >= value->count) {
+		return;
+	} else if (keep < 0) {
+		// Under a tenth of the last place kept.
+		value->digits[0] = '0';
+		value->count = 1;
+		value->exponent = 0;
+		return;
+	}
+
+	first = value->digits[keep];
+	for (int i = keep + 1; i < value->count; i++) {
+		rest = rest || value->digits[i] != '0';
+	}
+	if (first > '5' || (first == '5' && rest)) {
+		up = true;
+	} else if (first == '5' && keep > 0) {
+		// A tie, up only if that makes the last digit kept even.
+		up = (value->digits[keep - 1] - '0') % 2 == 1;
+	}
+	value->exponent += value->count - keep;
+	value->count = keep;
+
+	if (keep == 0) {
+		value->digits[0] = up ? '1' : '0';
+		value->count = 1;
+		if (!up) {
+			value->exponent = 0;
+		}
+		return;
+	}
+	for (int i = keep - 1; up && i >= 0; i--) {
+		if (value->digits[i] != '9') {
+			value->digits[i]++;
+			up = false;
+		} else {
+			value->digits[i] = '0';
+		}
+	}
+	if (up) {
+		// All '9's, now "100..." one place up.
+		value->digits[0] = '1';
+		value->exponent++;
+	}
+}
+
+
+
+// Removes trailing zeros from a value's digits, for "%g".
+// Parameters:
+//     value - the value.
+static void decimal_float_trim(decimal_float *value)
+{
+	while (value->count > 1 && value->digits[value->count - 1] == '0') {
+		value->count--;
+		value->exponent++;
+	}
+	if (value->count == 1 && value->digits[0] == '0') {
+		value->exponent = 0;
+	}
+}
+
+
+
+// Lays out a value as "%f" does, "123.456".
+// Parameters:
+//     layout - where to write the layout.
+//     value - the value, already rounded to the precision.
+//     precision - the number of decimals.
+//     alternate - whether to always write the decimal point.
+static void decimal_float_fixed(decimal_float_layout *layout,
+								const decimal_float *value, int precision,
+								bool alternate)
+{
+	int whole = value->count + value->exponent;
+
+	memset(layout, 0, sizeof(*layout));
+	layout->point = precision > 0 || alternate;
+	if (value->exponent >= 0) {
+		layout->whole = value->digits;
+		layout->whole_length = value->count;
+		if (value->digits[0] != '0') {
+			layout->whole_zeros = value->exponent;
+		}
+		layout->trailing_zeros = precision;
+		return;
+	}
+
+	if (whole > 0) {
+		layout->whole = value->digits;
+		layout->whole_length = whole;
+		layout->fraction = value->digits + whole;
+		layout->fraction_length = value->count - whole;
+	} else {
+		layout->whole = "0";
+		layout->whole_length = 1;
+		layout->leading_zeros = -whole;
+		layout->fraction = value->digits;
+		layout->fraction_length = value->count;
+	}
+	assert(precision >= -value->exponent);
+	layout->trailing_zeros = precision + value->exponent;
+}
+
+
+
+// Lays out a value as "%e" does, "1.23456e+02".
+// Parameters:
+//     layout - where to write the layout.
+//     value - the value, already rounded to precision + 1 digits.
+//     precision - the number of decimals.
+//     alternate - whether to always write the decimal point.
+//     upper - whether to write 'E' rather than 'e'.
+static void decimal_float_scientific(decimal_float_layout *layout,
+									 const decimal_float *value,
+									 int precision, bool alternate,
+									 bool upper)
+{
+	int exponent = value->exponent + value->count - 1;
+	char digits[8];
+	int count = 0;
+
+	memset(layout, 0, sizeof(*layout));
+	if (value->digits[0] == '0') {
+		exponent = 0;
+	}
+	layout->whole = value->digits;
+	layout->whole_length = 1;
+	layout->point = precision > 0 || alternate;
+	layout->fraction = value->digits + 1;
+	layout->fraction_length = value->count - 1;
+	assert(precision >= value->count - 1);
+	layout->trailing_zeros = precision - (value->count - 1);
+
+	layout->exponent[layout->exponent_length++] = upper ? 'E' : 'e';
+	layout->exponent[layout->exponent_length++] = (exponent < 0) ? '-' : '+';
+	count = decimal_float_digits(digits, (exponent < 0) ? -exponent : exponent,
+								 2);
+	memcpy(layout->exponent + layout->exponent_length, digits, count);
+	layout->exponent_length += count;
+}
+
+
+
+// Writes a laid out number with its sign and padding.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, for width and flags.
+//     negative - whether to write a '-'.
+//     layout - the number.
+// Returns:
+//     true on success, false on error.
+static bool decimal_float_write_layout(output_specifier *output,
+									   const format_specifier *fs,
+									   bool negative,
+									   const decimal_float_layout *layout)
+{
+	const printf_grouping *locale = printf_locale_grouping();
+	size_t whole = layout->whole_length + layout->whole_zeros;
+	uint64_t boundaries = 0;
+	size_t length = 0;
+	size_t padding = 0;
+	char sign = 0;
+
+	if (negative) {
+		sign = '-';
+	} else if (fs->always_sign) {
+		sign = '+';
+	} else if (fs->empty_sign) {
+		sign = ' ';
+	}
+	if (fs->thousands_grouping) {
+		// Only boundaries with a digit either side of them.
+		boundaries = locale->boundaries;
+		if (whole < 64) {
+			boundaries &= ((uint64_t) 1 << whole) - 1;
+		}
+	}
+
+	length = (sign != 0) + whole + layout->leading_zeros +
+			 layout->fraction_length + layout->trailing_zeros +
+			 layout->exponent_length;
+	for (uint64_t rest = boundaries; rest != 0; rest &= rest - 1) {
+		length += locale->separator_length;
+	}
+	for (size_t right = 64; boundaries != 0 && right < whole; right++) {
+		if (decimal_float_separator(locale, boundaries, right)) {
+			length += locale->separator_length;
+		}
+	}
+	if (layout->point) {
+		length += locale->decimal_point_length;
+	}
+	if (fs->width > length) {
+		padding = fs->width - length;
+	}
+
+	if (!fs->left_justify && !fs->zero_padded &&
+		!decimal_float_pad(output, ' ', padding))
+	{
+		return false;
+	}
+	if (sign != 0 && !printf_output(output, sign)) {
+		return false;
+	}
+	if (!fs->left_justify && fs->zero_padded &&
+		!decimal_float_pad(output, '0', padding))
+	{
+		return false;
+	}
+	if (!decimal_float_write_whole(output, layout, boundaries, locale)) {
+		return false;
+	}
+	if (layout->point &&
+		!printf_output_span(output, locale->decimal_point,
+							locale->decimal_point_length))
+	{
+		return false;
+	}
+	if (!decimal_float_pad(output, '0', layout->leading_zeros) ||
+		!printf_output_span(output, layout->fraction,
+							layout->fraction_length) ||
+		!decimal_float_pad(output, '0', layout->trailing_zeros) ||
+		!printf_output_span(output, layout->exponent,
+							layout->exponent_length))
+	{
+		return false;
+	}
+	if (fs->left_justify) {
+		return decimal_float_pad(output, ' ', padding);
+	}
+	return true;
+}
+
+
+
+// Writes the whole part of a laid out number, grouped if asked to.
+// Parameters:
+//     output - where to write to.
+//     layout - the number.
+//     boundaries - where separators go, as in printf_grouping, 0 for none.
+//     locale - the separator.
+// Returns:
+//     true on success, false on error.
+static bool decimal_float_write_whole(output_specifier *output,
+									  const decimal_float_layout *layout,
+									  uint64_t boundaries,
+									  const printf_grouping *locale)
+{
+	size_t whole = layout->whole_length + layout->whole_zeros;
+
+	if (boundaries == 0) {
+		return printf_output_span(output, layout->whole,
+								  layout->whole_length) &&
+			   decimal_float_pad(output, '0', layout->whole_zeros);
+	}
+	for (size_t i = 0; i < whole; i++) {
+		// The digits to the right of this one.
+		size_t right = whole - 1 - i;
+
+		if (!printf_output(output, (i < layout->whole_length) ?
+									layout->whole[i] : '0'))
+		{
+			return false;
+		}
+		if (decimal_float_separator(locale, boundaries, right) &&
+			!printf_output_span(output, locale->separator,
+								locale->separator_length))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+// Works out whether a separator goes after a digit of the whole part.
+// Parameters:
+//     locale - the grouping.
+//     boundaries - the grouping's boundaries, cut to the whole part.
+//     right - the number of digits to the right of the digit.
+// Returns:
+//     true if a separator goes after it.
+static bool decimal_float_separator(const printf_grouping *locale,
+									uint64_t boundaries, size_t right)
+{
+	size_t highest = 0;
+
+	if (right < 64) {
+		return (boundaries >> right) & 1;
+	} else if (locale->repeat == 0 || boundaries == 0) {
+		return false;
+	}
+	// More than 64 digits, so boundaries is all of the locale's.
+	highest = 63 - __builtin_clzll(boundaries);
+	return (right - highest) % locale->repeat == 0;
+}
+
+
+
+// Writes infinity or NaN. The '0' flag pads with spaces, as there are no
+// digits to pad.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, for width and flags.
+//     negative - whether to write a '-'.
+//     text - "inf", "nan" or their upper case.
+// Returns:
+//     true on success, false on error.
+static bool decimal_float_write_special(output_specifier *output,
+										const format_specifier *fs,
+										bool negative, const char *text)
+{
+	size_t length = 3;
+	size_t padding = 0;
+	char sign = 0;
+
+	if (negative) {
+		sign = '-';
+	} else if (fs->always_sign) {
+		sign = '+';
+	} else if (fs->empty_sign) {
+		sign = ' ';
+	}
+	length += (sign != 0);
+	if (fs->width > length) {
+		padding = fs->width - length;
+	}
+	return (fs->left_justify || decimal_float_pad(output, ' ', padding)) &&
+		   (sign == 0 || printf_output(output, sign)) &&
+		   printf_output_span(output, text, 3) &&
+		   (!fs->left_justify || decimal_float_pad(output, ' ', padding));
+}
+
+
+
+// Writes a character a number of times, for padding and zeros.
+// Parameters:
+//     output - where to write to.
+//     character - the character.
+//     length - the number of times, may be 0.
+// Returns:
+//     true on success, false on error.
+static bool decimal_float_pad(output_specifier *output, char character,
+							  size_t length)
+{
+	char run[64];
+	size_t chunk = 0;
+
+	memset(run, character, sizeof(run));
+	while (length > 0) {
+		chunk = length < sizeof(run) ? length : sizeof(run);
+		if (!printf_output_span(output, run, chunk)) {
+			return false;
+		}
+		length -= chunk;
+	}
+	return true;
+}
+
+#endif // PRINTF_DECIMAL_FLOAT
@@ -0,0 +1,15 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_DECIMAL_FLOAT_H
+#define PRINTF_DECIMAL_FLOAT_H
+
+#include "printf_definitions.h"
+
+#ifdef PRINTF_DECIMAL_FLOAT
+bool printf_decimal_float_write(output_specifier *output, printf_uint128 bits,
+								const format_specifier *fs);
+#endif
+
+#endif // PRINTF_DECIMAL_FLOAT_H
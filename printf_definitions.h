@@ -14,6 +14,7 @@ typedef enum {
 	FORMAT_ERROR_no_positional_precision,
 	FORMAT_ERROR_unknown_type,
 	FORMAT_ERROR_incompatible_length_type,
+	FORMAT_ERROR_unknown_length,
 	FORMAT_WARNING_flag_does_nothing,
 	FORMAT_WARNING_repeat_flag,
 	FORMAT_WARNING_width_does_nothing,
@@ -21,25 +22,149 @@ typedef enum {
 	FORMAT_WARNING_does_not_print
 } format_error;
 
-// Literally an enum of the type letters of printf format strings.
+// Literally an enum of the type letters of printf format strings. 
+// TYPE_custom is any conversion registered with printf_register_conversion 
+// or printf_register_named_conversion.
 typedef enum {
-	TYPE_d, TYPE_i, TYPE_u, TYPE_o, TYPE_x, TYPE_X, TYPE_f, TYPE_F, 
-	TYPE_e, TYPE_E, TYPE_g, TYPE_G, TYPE_a, TYPE_A, TYPE_c, TYPE_s, 
-	TYPE_p, TYPE_n, TYPE_ERROR
+	TYPE_d, TYPE_i, TYPE_u, TYPE_o, TYPE_x, TYPE_X, TYPE_b, TYPE_B, 
+	TYPE_f, TYPE_F, TYPE_e, TYPE_E, TYPE_g, TYPE_G, TYPE_a, TYPE_A, 
+	TYPE_c, TYPE_s, TYPE_p, TYPE_n, TYPE_custom, TYPE_ERROR
 } format_string_types;
 
-// Literally an enum of the length specifiers of printf format strings.
+// Literally an enum of the length specifiers of printf format strings. 
+// LENGTH_wN and LENGTH_wfN are C23's "wN" and "wfN", for intN_t and 
+// int_fastN_t and their unsigned versions. LENGTH_w128 is "w128", for 
+// printf_int128, and is only accepted where PRINTF_INT128 is defined. 
+// LENGTH_H, LENGTH_D and LENGTH_DD are TS 18661-2's "H", "D" and "DD", for 
+// _Decimal32, _Decimal64 and _Decimal128, and are only accepted where 
+// PRINTF_DECIMAL_FLOAT is defined.
 typedef enum {
 	LENGTH_none, LENGTH_hh, LENGTH_h, LENGTH_l, LENGTH_ll, LENGTH_j, 
-	LENGTH_z, LENGTH_t, LENGTH_L
+	LENGTH_z, LENGTH_t, LENGTH_L, LENGTH_w8, LENGTH_w16, LENGTH_w32, 
+	LENGTH_w64, LENGTH_wf8, LENGTH_wf16, LENGTH_wf32, LENGTH_wf64, 
+	LENGTH_w128, LENGTH_H, LENGTH_D, LENGTH_DD
 } format_string_lengths;
 
+// 128 bit integers, for "%w128d", where the compiler has them.
+#ifdef __SIZEOF_INT128__
+#define PRINTF_INT128
+__extension__ typedef __int128 printf_int128;
+__extension__ typedef unsigned __int128 printf_uint128;
+#endif
+
+// Decimal floating point, for "%Df" and the others, where the compiler has it
+// in the BID encoding, as GCC does for C on x86. The encodings are read as 
+// integers, so 128 bit integers are needed too.
+#if defined(__DEC64_MANT_DIG__) && defined(__DECIMAL_BID_FORMAT__) && \
+	defined(PRINTF_INT128)
+#define PRINTF_DECIMAL_FLOAT
+#endif
+
+
+// Supplies the memory used by asprintf and for storing positional arguments.
+// All functions receive the context pointer as their first argument.
+typedef struct printf_allocator_struct {
+	// Returns size bytes of memory, or NULL on failure.
+	void* (*allocate)(void *context, size_t size);
+	// Resizes memory from this allocator, keeping its contents. Returns the
+	// new location, or NULL on failure, in which case pointer is still valid.
+	void* (*reallocate)(void *context, void *pointer, size_t old_size, 
+						size_t new_size);
+	// Gives back memory from this allocator. pointer may be NULL.
+	void (*deallocate)(void *context, void *pointer);
+	void *context;
+} printf_allocator;
+
+// A bump allocator over caller provided memory. Allocation moves a pointer 
+// forwards, and everything is given back at once by printf_arena_reset.
+typedef struct printf_arena_struct {
+	char *memory;
+	size_t size;
+	// Bytes of memory handed out so far.
+	size_t used;
+	// Where the most recent allocation starts, it can be resized in place.
+	size_t last;
+} printf_arena;
 
 typedef enum {
 	OUTPUT_file_descriptor, OUTPUT_stream, OUTPUT_string, 
-	OUTPUT_allocated_string
+	OUTPUT_allocated_string, OUTPUT_callback, OUTPUT_mmap_log, OUTPUT_ring, 
+	OUTPUT_hash, OUTPUT_tee
 } printf_output_type;
 
+// An append-only log file written through a shared memory mapping. May be
+// shared between threads, and opened by several processes at once.
+typedef struct printf_mmap_log_struct {
+	int fd;
+	// Start of the mapping, the file header is at the start.
+	char *base;
+	// Bytes mapped, the largest the file may grow to.
+	size_t capacity;
+} printf_mmap_log;
+
+// What a ring producer does when there is no room for its record.
+typedef enum {
+	// Drop the record and count it, never blocks.
+	RING_POLICY_drop,
+	// Wait for the consumer to make room.
+	RING_POLICY_block
+} printf_ring_policy;
+
+// A single producer, single consumer ring buffer in posix shared memory. Each
+// side has its own printf_ring for the same shared memory.
+typedef struct printf_ring_struct {
+	// Start of the mapping, the shared header is at the start.
+	char *base;
+	// Bytes mapped, the header and the data.
+	size_t size;
+	// For the producer.
+	printf_ring_policy policy;
+	// For the producer, the record currently being written.
+	uint64_t record_length;
+	bool record_dropped;
+} printf_ring;
+
+// What printf_ring_read returns when there is no record to read.
+#define PRINTF_RING_EMPTY (-1)
+// What printf_ring_read returns when a record was too big for its buffer.
+#define PRINTF_RING_SKIPPED (-2)
+
+// Bytes of input the hash consumes at a time.
+#define HASH_STRIPE_SIZE 32
+
+// Incremental state of an xxHash64 hash.
+typedef struct printf_hash_state_struct {
+	uint64_t accumulators[4];
+	uint64_t seed;
+	uint64_t total_length;
+	// Input waiting for a whole stripe.
+	char stripe[HASH_STRIPE_SIZE];
+	size_t stripe_length;
+} printf_hash_state;
+
+// The result of hashprintf.
+typedef struct printf_hash_struct {
+	// 64 bit xxHash64 digest of the output, with a seed of 0.
+	uint64_t digest;
+	// The number of characters hashed.
+	size_t length;
+} printf_hash;
+
+// The size of the staging buffer used by buffered outputs, e.g. 
+// OUTPUT_callback. Characters are collected here and handed on in spans.
+#define OUTPUT_BUFFER_SIZE 256
+
+// User supplied function for OUTPUT_callback. Called with spans of output, 
+// never with a length of 0.
+// Parameters:
+//     context - the context pointer given alongside the callback.
+//     span - the characters to write, not '\0' terminated.
+//     length - the number of characters in span.
+// Returns:
+//     true on success, false on error.
+typedef bool (*printf_write_callback)(void *context, const char *span, 
+									  size_t length);
+
 // Holds information about how we output our characters.
 typedef struct output_specifier_struct {
 	printf_output_type type;
@@ -47,12 +172,38 @@ typedef struct output_specifier_struct {
 	FILE *stream;
 	// For use with OUTPUT_file_descriptor
 	int fd;
-	// For use with OUTPUT_string and OUTPUT_allocated_string
+	// For use with OUTPUT_string, OUTPUT_allocated_string and OUTPUT_mmap_log
 	// Note: for OUTPUT_string this refers to the next location to write to, for
-	// OUTPUT_allocated_string it refers to the start of the string.
+	// OUTPUT_allocated_string it refers to the start of the string. For 
+	// OUTPUT_mmap_log it gathers a message too long for buffer, NULL until 
+	// one is.
 	char *string;
-	// For use with OUTPUT_allocated_string;
+	// For use with OUTPUT_allocated_string and OUTPUT_mmap_log;
 	size_t allocated_size;
+	// For use with OUTPUT_mmap_log, the number of characters in string.
+	size_t string_length;
+	// For use with OUTPUT_callback
+	printf_write_callback write;
+	void *context;
+	// For use with OUTPUT_mmap_log
+	printf_mmap_log *mmap_log;
+	// For use with OUTPUT_ring
+	printf_ring *ring;
+	// For use with OUTPUT_hash
+	printf_hash_state hash_state;
+	// For use with OUTPUT_tee. Every child gets a copy of the output.
+	struct output_specifier_struct *children;
+	size_t child_count;
+	// For use with any output that is a child of an OUTPUT_tee. Set once the
+	// child has had an error, after which it is skipped.
+	bool failed;
+	// For use with OUTPUT_callback, OUTPUT_mmap_log, OUTPUT_ring and 
+	// OUTPUT_tee. Characters waiting to be handed on.
+	char buffer[OUTPUT_BUFFER_SIZE];
+	size_t buffer_length;
+	// For use with any. Memory for OUTPUT_allocated_string and for storing 
+	// positional arguments comes from here.
+	const printf_allocator *allocator;
 	// For use with any.
 	size_t character_limit;                     // FIXME should these be
 	size_t characters_written;					// size_ts or ints?
@@ -72,6 +223,9 @@ typedef struct format_specifier_struct {
     bool alternate_form;
     // zero_padded (0) Left-pads the numbers with "0".
     bool zero_padded;
+    // thousands_grouping (') Groups the digits of decimal numbers with the 
+    // locale's thousands separator.
+    bool thousands_grouping;
     // Whether the width is instead given as a preceding va_args value. 
     // 0 is no preceding width. If just preceding width with no position then 
     // non-zero, otherwise the position.
@@ -92,8 +246,154 @@ typedef struct format_specifier_struct {
     // The position in list of parameters this is related to. 0 is no position 
     // given, otherwise the position.
     int position;
+    // For TYPE_custom, the registered conversion. NULL otherwise.
+    const struct printf_custom_conversion_struct *custom;
+    // For TYPE_custom, the number after ':' in "%{name:N}", for the 
+    // conversion to use as it likes. 0 if not given.
+    int custom_option;
 } format_specifier;
 
+// An argument for new_printf_argv, tagged with its type. type says which 
+// member of value holds it: TYPE_d/TYPE_i/TYPE_c integer, TYPE_u/TYPE_o/
+// TYPE_x/TYPE_X/TYPE_b/TYPE_B unsigned_integer, the floating point types 
+// floating_point, TYPE_s string, TYPE_p and TYPE_n pointer. Integers are 
+// converted to the size in the format string, as printf does. For TYPE_n, 
+// length says what pointer points to and must match the format string.
+typedef struct printf_arg_struct {
+	format_string_types type;
+	format_string_lengths length;
+	union {
+		intmax_t integer;
+		uintmax_t unsigned_integer;
+		long double floating_point;
+		const char *string;
+		void *pointer;
+	} value;
+} printf_arg;
+
+// The longest name, plus '\0', a named conversion can have.
+#define PRINTF_CUSTOM_NAME_SIZE 32
+
+// Writes a registered conversion. argument is read from the arguments as 
+// the conversion's argument type says, with fs's length, so e.g. a TYPE_u 
+// conversion given "%lV" gets an unsigned long in unsigned_integer. context 
+// is what was given when registering.
+typedef bool (*printf_custom_function)(output_specifier *output, 
+	const format_specifier *fs, const printf_arg *argument, void *context);
+
+// A conversion registered with printf_register_conversion, "%V", or 
+// printf_register_named_conversion, "%{name}".
+typedef struct printf_custom_conversion_struct {
+	// The name, empty for a letter.
+	char name[PRINTF_CUSTOM_NAME_SIZE];
+	// Hash of name, so lookups rarely compare names.
+	uint32_t hash;
+	// The letter, '\0' for a name.
+	char letter;
+	// How the argument is read: as for TYPE_d, TYPE_u, TYPE_c, TYPE_s or 
+	// TYPE_p.
+	format_string_types argument;
+	printf_custom_function function;
+	void *context;
+} printf_custom_conversion;
+
+// One piece of a compiled format string, either a literal run to output as 
+// is or a conversion.
+typedef struct printf_format_node_struct {
+	bool literal;
+	// For a literal, where it is in the format string.
+	size_t offset;
+	size_t length;
+	// For a conversion. Already checked for unused values.
+	format_specifier fs;
+	// For a conversion, the argument to print, from 0.
+	int argument;
+	// For a conversion, the arguments for '*' width and precision, -1 if none.
+	int width_argument;
+	int precision_argument;
+} printf_format_node;
+
+// A format string parsed once by printf_compile, for printing many times.
+typedef struct printf_compiled_format_struct {
+	// The format string, which must outlive the compiled format.
+	const char *format;
+	printf_format_node *nodes;
+	size_t node_count;
+	// How many arguments the format string uses.
+	int argument_count;
+	// Where nodes came from.
+	const printf_allocator *allocator;
+} printf_compiled_format;
+
+// The type of a record field read by printf_batch.
+typedef enum {
+	BATCH_FIELD_none, BATCH_FIELD_signed_char, BATCH_FIELD_short, 
+	BATCH_FIELD_int, BATCH_FIELD_long, BATCH_FIELD_long_long, 
+	BATCH_FIELD_intmax, BATCH_FIELD_ptrdiff, BATCH_FIELD_signed_size, 
+	BATCH_FIELD_unsigned_char, BATCH_FIELD_unsigned_short, 
+	BATCH_FIELD_unsigned_int, 
+	BATCH_FIELD_unsigned_long, BATCH_FIELD_unsigned_long_long, 
+	BATCH_FIELD_uintmax, BATCH_FIELD_size, BATCH_FIELD_char, 
+	BATCH_FIELD_string, BATCH_FIELD_pointer
+} printf_batch_field;
+
+// Where and how printf_batch reads the fields for one node of a compiled 
+// format.
+typedef struct printf_batch_column_struct {
+	// BATCH_FIELD_none for a literal.
+	printf_batch_field field;
+	size_t offset;
+	// For '*' width and precision, which are ints.
+	size_t width_offset;
+	size_t precision_offset;
+} printf_batch_column;
+
+// Processor features the kernels of printf_cpu.c can use, as levels.
+typedef enum {
+	CPU_FEATURE_sse2 = 1, CPU_FEATURE_sse4_2 = 2, CPU_FEATURE_avx2 = 4, 
+	CPU_FEATURE_avx512 = 8
+} printf_cpu_feature;
+
+// The kernels printf_cpu picked for this processor.
+typedef struct printf_cpu_kernels_struct {
+	// The CPU_FEATURE_* flags found, less any PRINTF_CPU doesn't allow.
+	unsigned int features;
+	// The number of characters before the next '%' or '\0'.
+	size_t (*find_percent)(const char *format);
+	// strnlen, safe with NULL if max is 0.
+	size_t (*strnlen)(const char *string, size_t max);
+	// The low eight digits of eight values, see printf_decimal.c.
+	void (*decimal_u32)(const uint32_t *values, char *digits);
+	// The number of characters before the first JSON must escape, '\0' or
+	// max, see printf_json.c.
+	size_t (*json_plain)(const char *string, size_t max);
+	// Bytes in hexadecimal and base64, see printf_binary.c.
+	void (*hex)(const unsigned char *bytes, size_t count, char *digits,
+				const char *alphabet);
+	void (*base64)(const unsigned char *bytes, size_t count,
+				   char *characters, const char *alphabet);
+} printf_cpu_kernels;
+
+// The most bytes in a thousands separator, one UTF-8 character.
+#define PRINTF_SEPARATOR_MAX 4
+
+// How the locale groups digits for the ' flag, and its decimal point, see 
+// printf_locale.c.
+typedef struct printf_grouping_struct {
+	// The thousands separator, not '\0' terminated.
+	char separator[PRINTF_SEPARATOR_MAX];
+	size_t separator_length;
+	// Bit n is set if a separator goes n digits from the right. 0 if the
+	// locale doesn't group, as in the "C" locale.
+	uint64_t boundaries;
+	// Past bit 63, a separator goes every repeat digits on from the highest 
+	// bit set. 0 if the grouping stops.
+	unsigned int repeat;
+	// The decimal point, not '\0' terminated, "." in the "C" locale.
+	char decimal_point[PRINTF_SEPARATOR_MAX];
+	size_t decimal_point_length;
+} printf_grouping;
+
 // Holds information for when we are using posix positional arguments and need
 // to store the arguments for later.
 typedef struct struct_positional_info {
@@ -108,6 +408,8 @@ typedef struct struct_positional_info {
 typedef struct struct_positional_info_array {
 	int size;
 	positional_info* array;
+	// Where array and the stored items get their memory from.
+	const printf_allocator *allocator;
 } positional_info_array;
 
 // To share the va_list between functions and to avoid type issues like
@@ -143,10 +445,120 @@ int new_vsnprintf(char *str, size_t size, const char *format, va_list args);
 int new_asprintf(char **strp, const char *format, ...);
 int new_vasprintf(char **strp, const char *format, va_list args);
 
+// Allocated string output, using allocator for the string, NULL for this 
+// thread's.
+int new_asprintf_allocator(const printf_allocator *allocator, char **strp, 
+						   const char *format, ...);
+int new_vasprintf_allocator(const printf_allocator *allocator, char **strp, 
+							const char *format, va_list args);
+
 // File descriptor output.
 int new_dprintf(int fd, const char *format, ...);
 int new_vdprintf(int fd, const char *format, va_list args);
 
+// User callback output.
+int new_cbprintf(printf_write_callback write, void *context, 
+				 const char *format, ...);
+int new_vcbprintf(printf_write_callback write, void *context, 
+				  const char *format, va_list args);
+
+// Memory mapped log file output.
+bool printf_mmap_log_open(printf_mmap_log *log, const char *path, 
+						  size_t capacity);
+bool printf_mmap_log_close(printf_mmap_log *log);
+bool printf_mmap_log_sync(printf_mmap_log *log);
+int new_mmprintf(printf_mmap_log *log, const char *format, ...);
+int new_vmmprintf(printf_mmap_log *log, const char *format, va_list args);
+
+// Shared memory ring output.
+bool printf_ring_create(printf_ring *ring, const char *name, size_t capacity);
+bool printf_ring_open(printf_ring *ring, const char *name, 
+					  printf_ring_policy policy);
+bool printf_ring_close(printf_ring *ring);
+int printf_ring_read(printf_ring *ring, char *buffer, size_t size);
+uint64_t printf_ring_dropped(const printf_ring *ring);
+int new_ringprintf(printf_ring *ring, const char *format, ...);
+int new_vringprintf(printf_ring *ring, const char *format, va_list args);
+
+// Hash of output.
+int new_hashprintf(printf_hash *hash, const char *format, ...);
+int new_vhashprintf(printf_hash *hash, const char *format, va_list args);
+
+// Output to several outputs at once, set up with printf_output_initialise_*.
+int new_teeprintf(output_specifier *children, size_t count, 
+				  const char *format, ...);
+int new_vteeprintf(output_specifier *children, size_t count, 
+				   const char *format, va_list args);
+
+// Arguments from an array instead of a va_list.
+int new_printf_argv(output_specifier *output, const char *format, 
+					const printf_arg *args, size_t count);
+
+// Formatting arrays of records.
+bool printf_batch(output_specifier *output, const char *format, 
+				  const void *rows, size_t stride, size_t count, ...);
+bool printf_batch_offsets(output_specifier *output, const char *format, 
+						  const void *rows, size_t stride, size_t count, 
+						  const size_t *offsets);
+bool printf_batch_compiled(output_specifier *output, 
+						   const printf_compiled_format *compiled, 
+						   const void *rows, size_t stride, size_t count, 
+						   const size_t *offsets);
+bool printf_batch_parallel(output_specifier *output, 
+						   const printf_compiled_format *compiled, 
+						   const void *rows, size_t stride, size_t count, 
+						   const size_t *offsets, int threads);
+
+// Writing arrays of integers in decimal.
+bool printf_decimal_u32(output_specifier *output, const uint32_t *values, 
+						size_t count, const char *separator, 
+						const format_specifier *fs);
+bool printf_decimal_u64(output_specifier *output, const uint64_t *values, 
+						size_t count, const char *separator, 
+						const format_specifier *fs);
+
+// User conversions, registered before printing with them.
+bool printf_register_conversion(char letter, format_string_types argument, 
+								printf_custom_function function, 
+								void *context);
+bool printf_register_named_conversion(const char *name, 
+									  format_string_types argument, 
+									  printf_custom_function function, 
+									  void *context);
+
+// Setting up outputs directly, e.g. for the children of teeprintf. Once 
+// printed to, outputs must be finished with printf_output_finish.
+void printf_output_initialise_stream(output_specifier *output, FILE *stream);
+void printf_output_initialise_file_descriptor(output_specifier *output, 
+											  int fd);
+void printf_output_initialise_string(output_specifier *output, char *str, 
+									 size_t size);
+bool printf_output_initialise_allocated_string(output_specifier *output, 
+	const printf_allocator *allocator);
+void printf_output_initialise_callback(output_specifier *output, 
+									   printf_write_callback write, 
+									   void *context);
+void printf_output_initialise_mmap_log(output_specifier *output, 
+									   printf_mmap_log *log);
+void printf_output_initialise_ring(output_specifier *output, printf_ring *ring);
+void printf_output_initialise_hash(output_specifier *output, uint64_t seed);
+void printf_output_initialise_tee(output_specifier *output, 
+								  output_specifier *children, size_t count);
+bool printf_output_finish(output_specifier *output);
+uint64_t printf_hash_digest(const printf_hash_state *state);
+
+// Format strings parsed once, for printing many times.
+bool printf_compile(printf_compiled_format *compiled, const char *format, 
+					const printf_allocator *allocator);
+void printf_compiled_free(printf_compiled_format *compiled);
+
+// Allocators.
+void printf_set_thread_allocator(const printf_allocator *allocator);
+const printf_allocator* printf_thread_allocator(void);
+void printf_arena_initialise(printf_arena *arena, void *memory, size_t size);
+void printf_arena_reset(printf_arena *arena);
+printf_allocator printf_arena_allocator(printf_arena *arena);
+
 bool parse_format_string_for_positions(const char* format, 
 									   positional_info_array *pia, int *max);
 void print_positional_info_stuff(const positional_info *items, int count);
@@ -154,6 +566,9 @@ void print_positional_info_stuff(const positional_info *items, int count);
 bool format_error_is_error(format_error error);
 bool format_error_is_warning(format_error error);
 bool printf_output(output_specifier *output, char c);
+bool printf_output_span(output_specifier *output, const char *span, 
+						size_t length);
+bool printf_output_flush(output_specifier *output);
 
 void test_rda(void);
 	
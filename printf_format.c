@@ -1,6 +1,8 @@
 // Part of printf function suite. Parses format specifiers in the printf format
 // string e.g. "%20d". format: %[flags][width][.precision][length]specifier
-// Parsed results are stored in the format_specifier struct.
+// Parsed results are stored in the format_specifier struct. specifier may 
+// also be a registered letter, or a registered name in braces, "%{name}". 
+// length may be C23's "wN" or "wfN" for N of 8, 16, 32 or 64.
 // Incompatible types and lengths, e.g. "%lp", result in errors of type 
 // format_error. Inconsistent features, e.g. "% +d" are fixed and warnings 
 // returned.
@@ -20,6 +22,7 @@
 #include "printf_definitions.h"
 #include "printf_arguments.h"
 #include "printf_format.h"
+#include "printf_custom.h"
 
 
 
@@ -34,9 +37,15 @@ static format_error read_format_string_precision(const char *format_string,
 												 format_specifier *fs);
 static format_error read_format_string_length(const char* format_string, 
 											  format_specifier *fs);
+static size_t read_format_string_decimal_length(const char* format_string, 
+											  format_specifier *fs);
+static format_error read_format_string_width_length(const char* format_string, 
+													format_specifier *fs);
 static format_error read_format_string_type(const char* format_string, 
 											format_specifier *fs);
 static int format_string_atoi(const char *string, int *value);
+static bool format_string_custom_option(const char *option, size_t length, 
+										int *value);
 static format_error format_string_check_length_type(const format_specifier *fs);
 
 
@@ -60,11 +69,14 @@ format_error read_format_string(const char *format, format_specifier *fs)
     fs->empty_sign = false;
     fs->alternate_form = false;
     fs->zero_padded = false;
+    fs->thousands_grouping = false;
     fs->preceding_width = 0;
     fs->width = 0;
     fs->preceding_precision = 0;
     fs->precision = -1;
     fs->position = 0;
+    fs->custom = NULL;
+    fs->custom_option = 0;
     error = read_format_string_position(format, fs);
     if (format_error_is_error(error)) {
 		return error;
@@ -174,6 +186,14 @@ static format_error read_format_string_flags(const char *format,
 			fs->zero_padded = true;
 			fs->input_length++;
 			format++;
+		} else if (*format == '\'') {
+			// Check for repeated flag.
+			if (fs->thousands_grouping) {
+				error = FORMAT_WARNING_repeat_flag;
+			}
+			fs->thousands_grouping = true;
+			fs->input_length++;
+			format++;
 		} else {
 			// No more flags, move to width.
 			finished_finding_flags = true;
@@ -332,6 +352,12 @@ static format_error read_format_string_length(const char* format,
         fs->length = LENGTH_L;
         fs->input_length++;
         format++;
+    } else if (*format == 'w') {
+        return read_format_string_width_length(format, fs);
+    } else if (*format == 'H' || *format == 'D') {
+		// Either a decimal floating point length, or a registered "%H" or 
+		// "%D" with no length.
+		format += read_format_string_decimal_length(format, fs);
     } else {
         fs->length = LENGTH_none;
     }
@@ -340,6 +366,130 @@ static format_error read_format_string_length(const char* format,
 
 
 
+// Parses the format string for a TS 18661-2 "H", "D" or "DD" length field, 
+// where PRINTF_DECIMAL_FLOAT is defined. These are only lengths when a 
+// floating point conversion follows, so "%D" may still be registered. 
+// Parameters:
+//     format - What is left of a printf format string, starting at 'H' or 
+//         'D'.
+//     fs - The format specifier to write into.
+// Returns:
+//     fs - Populates the length, LENGTH_none if there isn't one.
+//     return - Characters read, 0 if there isn't a length.
+static size_t read_format_string_decimal_length(const char* format, 
+											  format_specifier *fs)
+{
+	size_t characters = 1;
+
+	fs->length = LENGTH_none;
+#ifdef PRINTF_DECIMAL_FLOAT
+	if (format[0] == 'D' && format[1] == 'D') {
+		characters = 2;
+	}
+	if (format[characters] == '\0' || 
+		strchr("aAeEfFgG", format[characters]) == NULL) 
+	{
+		return 0;
+	}
+	if (format[0] == 'H') {
+		fs->length = LENGTH_H;
+	} else if (characters == 2) {
+		fs->length = LENGTH_DD;
+	} else {
+		fs->length = LENGTH_D;
+	}
+	fs->input_length += characters;
+	return characters;
+#else
+	(void) format;
+	(void) characters;
+	return 0;
+#endif
+}
+
+
+
+// Parses the format string for a C23 "wN" or "wfN" length field. "w128" is 
+// accepted where PRINTF_INT128 is defined.
+// Parameters:
+//     format - What is left of a printf format string, starting at 'w'.
+//     fs - The format specifier to write into.
+// Returns:
+//     fs - Populates the format specifier pointed to with the result.
+//     return - A format_error error on error, otherwise a warning or okay.
+static format_error read_format_string_width_length(const char* format, 
+													format_specifier *fs)
+{
+	static const format_string_lengths exact[] = {
+		LENGTH_w8, LENGTH_w16, LENGTH_w32, LENGTH_w64, LENGTH_w128
+	};
+	// There is no "wf128".
+	static const format_string_lengths fast[] = {
+		LENGTH_wf8, LENGTH_wf16, LENGTH_wf32, LENGTH_wf64, LENGTH_none
+	};
+	static const char *bits[] = {"8", "16", "32", "64", "128"};
+#ifdef PRINTF_INT128
+	const int count = 5;
+#else
+	const int count = 4;
+#endif
+	const format_string_lengths *lengths = exact;
+	size_t characters = 1;
+	size_t digits = 0;
+
+	if (format[1] == 'f') {
+		lengths = fast;
+		characters++;
+	}
+	digits = strspn(format + characters, "0123456789");
+	for (int i = 0; i < count; i++) {
+		if (strlen(bits[i]) == digits && lengths[i] != LENGTH_none && 
+			strncmp(format + characters, bits[i], digits) == 0) 
+		{
+			fs->length = lengths[i];
+			fs->input_length += characters + digits;
+			return read_format_string_type(format + characters + digits, fs);
+		}
+	}
+	fs->length = LENGTH_none;
+	return FORMAT_ERROR_unknown_length;
+}
+
+
+
+// Gives the number of bits in the integer type of a C23 length.
+// Parameters:
+//     length - The length.
+// Returns:
+//     The number of bits for LENGTH_wN and LENGTH_wfN, 0 for other lengths.
+int format_string_length_bits(format_string_lengths length)
+{
+	switch (length) {
+		case LENGTH_w8:
+			return 8;
+		case LENGTH_w16:
+			return 16;
+		case LENGTH_w32:
+			return 32;
+		case LENGTH_w64:
+			return 64;
+		case LENGTH_wf8:
+			return sizeof(int_fast8_t) * CHAR_BIT;
+		case LENGTH_wf16:
+			return sizeof(int_fast16_t) * CHAR_BIT;
+		case LENGTH_wf32:
+			return sizeof(int_fast32_t) * CHAR_BIT;
+		case LENGTH_wf64:
+			return sizeof(int_fast64_t) * CHAR_BIT;
+		case LENGTH_w128:
+			return 128;
+		default:
+			return 0;
+	}
+}
+
+
+
 // Parses the format string for a type field.
 // Parameters:
 //     format - What is left of a printf format string.
@@ -350,46 +500,38 @@ static format_error read_format_string_length(const char* format,
 static format_error read_format_string_type(const char* format, 
 											format_specifier *fs) 
 {
-    if (*format == 'd') {
-        fs->type = TYPE_d;
-    } else if (*format == 'i') {
-        fs->type = TYPE_i;
-    } else if (*format == 'u') {
-        fs->type = TYPE_u;
-    } else if (*format == 'o') {
-        fs->type = TYPE_o;
-    } else if (*format == 'x') {
-        fs->type = TYPE_x;
-    } else if (*format == 'X') {
-        fs->type = TYPE_X;
-    } else if (*format == 'f') {
-        fs->type = TYPE_f;
-    } else if (*format == 'F') {
-        fs->type = TYPE_F;
-    } else if (*format == 'e') {
-        fs->type = TYPE_e;
-    } else if (*format == 'E') {
-        fs->type = TYPE_E;
-    } else if (*format == 'g') {
-        fs->type = TYPE_g;
-    } else if (*format == 'G') {
-        fs->type = TYPE_G;
-    } else if (*format == 'a') {
-        fs->type = TYPE_a;
-    } else if (*format == 'A') {
-        fs->type = TYPE_A;
-    } else if (*format == 'c') {
-        fs->type = TYPE_c;
-    } else if (*format == 's') {
-        fs->type = TYPE_s;
-    } else if (*format == 'p') {
-        fs->type = TYPE_p;
-    } else if (*format == 'n') {
-        fs->type = TYPE_n;
-    } else {
-        fs->type = TYPE_ERROR;
-        return FORMAT_ERROR_unknown_type;
-    }
+	const printf_custom_conversion *custom = NULL;
+	size_t name_length = 0;
+	size_t lookup_length = 0;
+
+	if (*format == '{') {
+		// A named conversion, "%{name}" or "%{name:N}".
+		name_length = strcspn(format + 1, "}");
+		lookup_length = strcspn(format + 1, ":}");
+		if (format[name_length + 1] == '}' && 
+			(lookup_length == name_length || 
+			 format_string_custom_option(format + lookup_length + 2, 
+										 name_length - lookup_length - 1, 
+										 &fs->custom_option))) 
+		{
+			custom = printf_custom_find(format + 1, lookup_length);
+		}
+		if (custom == NULL) {
+			fs->type = TYPE_ERROR;
+			return FORMAT_ERROR_unknown_type;
+		}
+		fs->type = TYPE_custom;
+		fs->custom = custom;
+		fs->input_length += name_length + 2;
+		return FORMAT_okay;
+	}
+
+	// Standard and registered letters are all in one table.
+	fs->type = printf_custom_letter(*format, &custom);
+	if (fs->type == TYPE_ERROR) {
+		return FORMAT_ERROR_unknown_type;
+	}
+	fs->custom = custom;
     // Increment length counter by 1.
     fs->input_length++;
     return FORMAT_okay;
@@ -406,6 +548,8 @@ static format_error read_format_string_type(const char* format,
 //     A format_error error on error, otherwise an okay.
 static format_error format_string_check_length_type(const format_specifier *fs)
 {
+	format_specifier argument_fs;
+
 	switch (fs->type) {
         case TYPE_d:
             // PASS-THROUGH
@@ -421,6 +565,10 @@ static format_error format_string_check_length_type(const format_specifier *fs)
         case TYPE_x:
             // PASS-THROUGH
         case TYPE_X:
+            // PASS-THROUGH
+        case TYPE_b:
+            // PASS-THROUGH
+        case TYPE_B:
 			if (fs->length == LENGTH_L) {
 				return FORMAT_ERROR_incompatible_length_type;
 			}
@@ -440,11 +588,21 @@ static format_error format_string_check_length_type(const format_specifier *fs)
         case TYPE_a:
             // PASS-THROUGH
         case TYPE_A:
+			// Decimal floating point has no hexadecimal form.
+			if (fs->length == LENGTH_H || fs->length == LENGTH_D || 
+				fs->length == LENGTH_DD) 
+			{
+				if (fs->type == TYPE_a || fs->type == TYPE_A) {
+					return FORMAT_ERROR_incompatible_length_type;
+				}
+				break;
+			}
 			// Everything but L and none is invalid.
             if (fs->length == LENGTH_h || fs->length == LENGTH_hh || 
 				fs->length == LENGTH_l || fs->length == LENGTH_ll || 
 				fs->length == LENGTH_j || fs->length == LENGTH_z || 
-				fs->length == LENGTH_t) 
+				fs->length == LENGTH_t || 
+				format_string_length_bits(fs->length) != 0) 
 			{
 				return FORMAT_ERROR_incompatible_length_type;
 			}
@@ -454,7 +612,8 @@ static format_error format_string_check_length_type(const format_specifier *fs)
             if (fs->length == LENGTH_h || fs->length == LENGTH_hh || 
 				fs->length == LENGTH_ll || fs->length == LENGTH_j || 
 				fs->length == LENGTH_z || fs->length == LENGTH_t || 
-				fs->length == LENGTH_L) 
+				fs->length == LENGTH_L || 
+				format_string_length_bits(fs->length) != 0) 
 			{
 				return FORMAT_ERROR_incompatible_length_type;
 			}
@@ -464,7 +623,8 @@ static format_error format_string_check_length_type(const format_specifier *fs)
             if (fs->length == LENGTH_h || fs->length == LENGTH_hh || 
 				fs->length == LENGTH_ll || fs->length == LENGTH_j || 
 				fs->length == LENGTH_z || fs->length == LENGTH_t || 
-				fs->length == LENGTH_L) 
+				fs->length == LENGTH_L || 
+				format_string_length_bits(fs->length) != 0) 
 			{
 				return FORMAT_ERROR_incompatible_length_type;
 			}
@@ -480,6 +640,11 @@ static format_error format_string_check_length_type(const format_specifier *fs)
 				return FORMAT_ERROR_incompatible_length_type;
 			}
             break;
+        case TYPE_custom:
+			// The same lengths as the conversion the argument is read as.
+			argument_fs = *fs;
+			argument_fs.type = fs->custom->argument;
+			return format_string_check_length_type(&argument_fs);
         default: 
             return FORMAT_ERROR_unknown_type;
             break;
@@ -516,8 +681,25 @@ format_error format_string_check_unused_values(format_specifier *fs)
 		}
 	}
 	
-	// Fixing hex with sign. "+x" "+X" " x" " X"
-	if (fs->type == TYPE_x || fs->type == TYPE_X) {
+	// Fixing grouping with anything but decimal. "'x" "'o" "'e" "'s"
+	// Note: custom conversions are left to decide for themselves.
+	if (fs->thousands_grouping && fs->type != TYPE_d && 
+		fs->type != TYPE_i && fs->type != TYPE_u && fs->type != TYPE_f && 
+		fs->type != TYPE_F && fs->type != TYPE_g && fs->type != TYPE_G && 
+		fs->type != TYPE_custom) 
+	{
+		if (fs->type == TYPE_n) {
+			result = FORMAT_WARNING_does_not_print;
+		} else {
+			result = FORMAT_WARNING_flag_does_nothing;
+		}
+		fs->thousands_grouping = false;
+	}
+	
+	// Fixing hex and binary with sign. "+x" "+X" " x" " X" "+b" " b"
+	if (fs->type == TYPE_x || fs->type == TYPE_X || fs->type == TYPE_b || 
+		fs->type == TYPE_B) 
+	{
 		if (fs->always_sign) {
 			result = FORMAT_WARNING_flag_does_nothing;
 			fs->always_sign = false;
@@ -599,8 +781,14 @@ format_error format_string_check_unused_values(format_specifier *fs)
 		fs->zero_padded = false;
 	}
 	
-	// If a precision is specified, the 0 flag is ignored.
-	if (fs->precision != -1) {
+	// If a precision is specified, the 0 flag is ignored, for the integer 
+	// conversions. Floating point pads with zeros whatever the precision.
+	// Note: custom conversions are left to decide for themselves.
+	if (fs->precision != -1 && fs->type != TYPE_f && fs->type != TYPE_F && 
+		fs->type != TYPE_e && fs->type != TYPE_E && fs->type != TYPE_g && 
+		fs->type != TYPE_G && fs->type != TYPE_a && fs->type != TYPE_A && 
+		fs->type != TYPE_custom) 
+	{
 		if (fs->zero_padded) {
 			result = FORMAT_WARNING_flag_does_nothing;
 			fs->zero_padded = false;
@@ -636,6 +824,57 @@ static int format_string_atoi(const char *format, int *value)
 
 
 
+// Reads the number after ':' in a named conversion, "%{name:N}".
+// Parameters:
+//     option - The characters after the ':'.
+//     length - The number of characters, up to the '}'.
+//     value - Pointer to the resulting number.
+// Returns:
+//     value - Populates with the read number.
+//     return - true if option is a number, optionally signed, of no more
+//         than 9 digits, false if not.
+static bool format_string_custom_option(const char *option, size_t length,
+										int *value)
+{
+	bool negative = false;
+	int digits = 0;
+
+	if (length > 0 && (*option == '-' || *option == '+')) {
+		negative = (*option == '-');
+		option++;
+		length--;
+	}
+	if (length == 0 || length > 9) {
+		return false;
+	}
+	digits = format_string_atoi(option, value);
+	if ((size_t) digits != length) {
+		return false;
+	}
+	if (negative) {
+		*value = -*value;
+	}
+	return true;
+}
+
+
+
+// Gives the conversion an argument is read as, which is the type of fs 
+// unless it is TYPE_custom.
+// Parameters:
+//     fs - The format specifier.
+// Returns:
+//     The type to read the argument as.
+format_string_types format_string_argument_type(const format_specifier *fs)
+{
+	if (fs->type == TYPE_custom) {
+		return fs->custom->argument;
+	}
+	return fs->type;
+}
+
+
+
 // Determines whether it is an actual error.
 // Parameters:
 //     error - The format_error to check.
@@ -646,7 +885,8 @@ bool format_error_is_error(format_error error)
 	return (error == FORMAT_ERROR_no_positional_width || 
 		    error == FORMAT_ERROR_no_positional_precision ||
 		    error == FORMAT_ERROR_unknown_type ||
-		    error == FORMAT_ERROR_incompatible_length_type
+		    error == FORMAT_ERROR_incompatible_length_type ||
+		    error == FORMAT_ERROR_unknown_length
 			);
 }
 
@@ -709,6 +949,12 @@ void print_format_specifier(const format_specifier *fs)
     } else {
         printf("false\n");
     }
+    printf("Thousands Grouping: ");
+    if (fs->thousands_grouping) {
+        printf("true\n");
+    } else {
+        printf("false\n");
+    }
     printf("Preceding Width: %d\n", fs->preceding_width);
     printf("Width: %d\n", fs->width);
     printf("Preceding Precision: %d\n", fs->preceding_precision);
@@ -743,6 +989,42 @@ void print_format_specifier(const format_specifier *fs)
         case LENGTH_L:
             printf("L\n");
             break;
+        case LENGTH_w8:
+            printf("w8\n");
+            break;
+        case LENGTH_w16:
+            printf("w16\n");
+            break;
+        case LENGTH_w32:
+            printf("w32\n");
+            break;
+        case LENGTH_w64:
+            printf("w64\n");
+            break;
+        case LENGTH_wf8:
+            printf("wf8\n");
+            break;
+        case LENGTH_wf16:
+            printf("wf16\n");
+            break;
+        case LENGTH_wf32:
+            printf("wf32\n");
+            break;
+        case LENGTH_wf64:
+            printf("wf64\n");
+            break;
+        case LENGTH_w128:
+            printf("w128\n");
+            break;
+        case LENGTH_H:
+            printf("H\n");
+            break;
+        case LENGTH_D:
+            printf("D\n");
+            break;
+        case LENGTH_DD:
+            printf("DD\n");
+            break;
         default:
             printf("Error\n");
             break;
@@ -767,6 +1049,12 @@ void print_format_specifier(const format_specifier *fs)
         case TYPE_X:
             printf("X\n");
             break;
+        case TYPE_b:
+            printf("b\n");
+            break;
+        case TYPE_B:
+            printf("B\n");
+            break;
         case TYPE_f:
             printf("f\n");
             break;
@@ -803,6 +1091,13 @@ void print_format_specifier(const format_specifier *fs)
         case TYPE_n:
             printf("n\n");
             break;
+        case TYPE_custom:
+            if (fs->custom->letter != '\0') {
+                printf("custom %c\n", fs->custom->letter);
+            } else {
+                printf("custom {%s}\n", fs->custom->name);
+            }
+            break;
         case TYPE_ERROR:
             printf("TYPE_ERROR\n");
             break;
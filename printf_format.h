@@ -14,6 +14,8 @@ format_error read_format_string(const char *format_string,
 bool format_error_is_error(format_error error);
 bool format_error_is_warning(format_error error);
 format_error format_string_check_unused_values(format_specifier *fs);
+format_string_types format_string_argument_type(const format_specifier *fs);
+int format_string_length_bits(format_string_lengths length);
 
 
 
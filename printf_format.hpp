@@ -0,0 +1,441 @@
+// Part of printf function suite. A constexpr port of printf_format.c, so that
+// format strings known when compiling can be parsed then. Used by printf.hpp
+// for STDLIB_FORMAT. The results match read_format_string and
+// format_string_check_unused_values exactly, so keep them in step.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_FORMAT_HPP
+#define PRINTF_FORMAT_HPP
+
+#include <cstddef>
+
+extern "C" {
+#include "printf_definitions.h"
+}
+
+
+namespace stdlib {
+
+namespace detail {
+
+// One piece of a parsed format string, either a literal run to output as is
+// or a conversion.
+struct format_node {
+	bool literal;
+	// For a literal, where it is in the format string.
+	size_t offset;
+	size_t length;
+	// For a conversion. Already checked for unused values.
+	format_specifier fs;
+	// For a conversion, the argument to print, from 0.
+	int argument;
+	// For a conversion, the arguments for '*' width and precision, -1 if none.
+	int width_argument;
+	int precision_argument;
+};
+
+// What walking a whole format string found.
+struct format_summary {
+	size_t node_count;
+	// The first error found, parsing stops there.
+	format_error error;
+	// Whether positional and plain conversions were mixed.
+	bool mixed_positions;
+	// How many arguments the format string uses.
+	int argument_count;
+};
+
+
+
+// Reads an numberic value from the format string.
+// Parameters:
+//     format - What is left of a printf format string.
+//     value - Pointer to the resulting number.
+// Returns:
+//     value - Populates with the read number. Defaults to 0.
+//     return - Characters read.
+constexpr int constexpr_format_atoi(const char *format, int *value)
+{
+	int characters_read = 0;
+	int current = 0;
+	while ((*format >= '0') && (*format <= '9')) {
+		current *= 10;
+		current += *format - '0';
+		format++;
+		characters_read++;
+	}
+	*value = current;
+	return characters_read;
+}
+
+
+
+// Parses the format string for a length field, then the type. See
+// read_format_string_length and read_format_string_type.
+// Parameters:
+//     format - What is left of a printf format string.
+//     fs - The format specifier to write into.
+// Returns:
+//     fs - Populates the format specifier pointed to with the result.
+//     return - A format_error error on error, otherwise okay.
+constexpr format_error constexpr_format_length_type(const char *format,
+													format_specifier *fs)
+{
+	fs->length = LENGTH_none;
+	if (format[0] == 'h' && format[1] == 'h') {
+		fs->length = LENGTH_hh;
+	} else if (format[0] == 'h') {
+		fs->length = LENGTH_h;
+	} else if (format[0] == 'l' && format[1] == 'l') {
+		fs->length = LENGTH_ll;
+	} else if (format[0] == 'l') {
+		fs->length = LENGTH_l;
+	} else if (format[0] == 'j') {
+		fs->length = LENGTH_j;
+	} else if (format[0] == 'z') {
+		fs->length = LENGTH_z;
+	} else if (format[0] == 't') {
+		fs->length = LENGTH_t;
+	} else if (format[0] == 'L') {
+		fs->length = LENGTH_L;
+	}
+	if (fs->length == LENGTH_hh || fs->length == LENGTH_ll) {
+		fs->input_length += 2;
+		format += 2;
+	} else if (fs->length != LENGTH_none) {
+		fs->input_length++;
+		format++;
+	} else if (format[0] == 'w') {
+		// C23 "wN" and "wfN", see read_format_string_width_length.
+		bool fast = (format[1] == 'f');
+		int characters = fast ? 2 : 1;
+		int bits = 0;
+		int digits = constexpr_format_atoi(format + characters, &bits);
+		if (digits != (bits < 10 ? 1 : 2)) {
+			return FORMAT_ERROR_unknown_length;
+		}
+		switch (bits) {
+			case 8: fs->length = fast ? LENGTH_wf8 : LENGTH_w8; break;
+			case 16: fs->length = fast ? LENGTH_wf16 : LENGTH_w16; break;
+			case 32: fs->length = fast ? LENGTH_wf32 : LENGTH_w32; break;
+			case 64: fs->length = fast ? LENGTH_wf64 : LENGTH_w64; break;
+			default: return FORMAT_ERROR_unknown_length;
+		}
+		fs->input_length += characters + digits;
+		format += characters + digits;
+	}
+
+	switch (*format) {
+		case 'd': fs->type = TYPE_d; break;
+		case 'i': fs->type = TYPE_i; break;
+		case 'u': fs->type = TYPE_u; break;
+		case 'o': fs->type = TYPE_o; break;
+		case 'x': fs->type = TYPE_x; break;
+		case 'X': fs->type = TYPE_X; break;
+		case 'b': fs->type = TYPE_b; break;
+		case 'B': fs->type = TYPE_B; break;
+		case 'f': fs->type = TYPE_f; break;
+		case 'F': fs->type = TYPE_F; break;
+		case 'e': fs->type = TYPE_e; break;
+		case 'E': fs->type = TYPE_E; break;
+		case 'g': fs->type = TYPE_g; break;
+		case 'G': fs->type = TYPE_G; break;
+		case 'a': fs->type = TYPE_a; break;
+		case 'A': fs->type = TYPE_A; break;
+		case 'c': fs->type = TYPE_c; break;
+		case 's': fs->type = TYPE_s; break;
+		case 'p': fs->type = TYPE_p; break;
+		case 'n': fs->type = TYPE_n; break;
+		default:
+			fs->type = TYPE_ERROR;
+			return FORMAT_ERROR_unknown_type;
+	}
+	fs->input_length++;
+
+	// See format_string_check_length_type.
+	format_string_lengths length = fs->length;
+	switch (fs->type) {
+		case TYPE_d: case TYPE_i: case TYPE_u: case TYPE_o: case TYPE_x:
+		case TYPE_X: case TYPE_b: case TYPE_B: case TYPE_n:
+			if (length == LENGTH_L) {
+				return FORMAT_ERROR_incompatible_length_type;
+			}
+			break;
+		case TYPE_f: case TYPE_F: case TYPE_e: case TYPE_E: case TYPE_g:
+		case TYPE_G: case TYPE_a: case TYPE_A:
+			if (length != LENGTH_none && length != LENGTH_L) {
+				return FORMAT_ERROR_incompatible_length_type;
+			}
+			break;
+		case TYPE_c: case TYPE_s:
+			if (length != LENGTH_none && length != LENGTH_l) {
+				return FORMAT_ERROR_incompatible_length_type;
+			}
+			break;
+		case TYPE_p:
+			if (length != LENGTH_none) {
+				return FORMAT_ERROR_incompatible_length_type;
+			}
+			break;
+		default:
+			return FORMAT_ERROR_unknown_type;
+	}
+	return FORMAT_okay;
+}
+
+
+
+// Parses a format specifier, the constexpr read_format_string. Assumes '%'
+// has already been read. Warnings aren't reported, they don't stop printing.
+// Parameters:
+//     format - A printf format string past the '%'.
+//     fs - The format specifier to write into.
+// Returns:
+//     fs - Populates the format specifier pointed to with the result.
+//     return - A format_error error on error, otherwise okay.
+constexpr format_error constexpr_read_format_string(const char *format,
+													format_specifier *fs)
+{
+	int value = 0;
+	int characters_read = 0;
+
+	*fs = format_specifier{};
+	fs->precision = -1;
+
+	// Position, or a width that looked like one.
+	bool read_width = false;
+	if (*format > '0' && *format <= '9') {
+		characters_read = constexpr_format_atoi(format, &value);
+		fs->input_length += characters_read;
+		format += characters_read;
+		if (*format == '$') {
+			fs->input_length++;
+			format++;
+			fs->position = value;
+		} else {
+			fs->width = value;
+			read_width = true;
+		}
+	}
+
+	if (!read_width) {
+		// Flags.
+		for (bool flag = true; flag; ) {
+			switch (*format) {
+				case '-': fs->left_justify = true; break;
+				case '+': fs->always_sign = true; break;
+				case ' ': fs->empty_sign = true; break;
+				case '#': fs->alternate_form = true; break;
+				case '0': fs->zero_padded = true; break;
+				case '\'': fs->thousands_grouping = true; break;
+				default: flag = false; break;
+			}
+			if (flag) {
+				fs->input_length++;
+				format++;
+			}
+		}
+
+		// Width.
+		if (*format == '*') {
+			fs->input_length++;
+			format++;
+			if (fs->position != 0) {
+				characters_read = constexpr_format_atoi(format, &value);
+				fs->preceding_width = value;
+				fs->input_length += characters_read;
+				format += characters_read;
+				if (value == 0 || *format != '$') {
+					return FORMAT_ERROR_no_positional_width;
+				}
+				fs->input_length++;
+				format++;
+			} else {
+				fs->preceding_width = 1;
+			}
+		} else {
+			characters_read = constexpr_format_atoi(format, &value);
+			fs->width = value;
+			fs->input_length += characters_read;
+			format += characters_read;
+		}
+	}
+
+	// Precision.
+	if (*format == '.') {
+		fs->input_length++;
+		format++;
+		if (*format == '*') {
+			fs->input_length++;
+			format++;
+			if (fs->position != 0) {
+				characters_read = constexpr_format_atoi(format, &value);
+				fs->preceding_precision = value;
+				fs->input_length += characters_read;
+				format += characters_read;
+				if (value == 0 || *format != '$') {
+					return FORMAT_ERROR_no_positional_precision;
+				}
+				fs->input_length++;
+				format++;
+			} else {
+				fs->preceding_precision = 1;
+			}
+		} else {
+			characters_read = constexpr_format_atoi(format, &value);
+			fs->precision = value;
+			fs->input_length += characters_read;
+			format += characters_read;
+		}
+	}
+
+	return constexpr_format_length_type(format, fs);
+}
+
+
+
+// Clears unused values from fs, the constexpr
+// format_string_check_unused_values.
+// Parameters:
+//     fs - The format specifier to fix.
+constexpr void constexpr_check_unused_values(format_specifier *fs)
+{
+	format_string_types type = fs->type;
+
+	if (fs->always_sign && fs->empty_sign) {
+		fs->empty_sign = false;
+	}
+	if (type == TYPE_d || type == TYPE_i || type == TYPE_u) {
+		fs->alternate_form = false;
+	}
+	if (type != TYPE_d && type != TYPE_i && type != TYPE_u &&
+		type != TYPE_f && type != TYPE_F && type != TYPE_g && type != TYPE_G &&
+		type != TYPE_custom)
+	{
+		fs->thousands_grouping = false;
+	}
+	if (type == TYPE_x || type == TYPE_X || type == TYPE_b || type == TYPE_B) {
+		fs->always_sign = false;
+		fs->empty_sign = false;
+	}
+	if (type == TYPE_c || type == TYPE_s || type == TYPE_p ||
+		type == TYPE_n)
+	{
+		fs->always_sign = false;
+		fs->empty_sign = false;
+		fs->alternate_form = false;
+		fs->zero_padded = false;
+	}
+	if (type == TYPE_n) {
+		fs->left_justify = false;
+		fs->width = 0;
+		fs->precision = -1;
+	}
+	if (type == TYPE_c || type == TYPE_p) {
+		fs->precision = -1;
+	}
+	if (fs->zero_padded && fs->left_justify) {
+		fs->zero_padded = false;
+	}
+	if (fs->precision != -1 && type != TYPE_f && type != TYPE_F &&
+		type != TYPE_e && type != TYPE_E && type != TYPE_g && type != TYPE_G &&
+		type != TYPE_a && type != TYPE_A && type != TYPE_custom)
+	{
+		fs->zero_padded = false;
+	}
+}
+
+
+
+// Walks a whole format string, splitting it into literal runs and
+// conversions and working out which argument each conversion uses.
+// Parameters:
+//     format - the printf format string.
+//     nodes - where to store the nodes, or nullptr to just count them.
+// Returns:
+//     nodes - populated, if given.
+//     return - what was found, stopping at the first error.
+constexpr format_summary walk_format_string(const char *format,
+											format_node *nodes)
+{
+	format_summary summary = {0, FORMAT_okay, false, 0};
+	const char *start = format;
+	bool using_positions = false;
+	bool first_element = true;
+	// The next argument when not using positions.
+	int next = 0;
+
+	while (*format != '\0') {
+		format_node node = {};
+		node.argument = -1;
+		node.width_argument = -1;
+		node.precision_argument = -1;
+
+		if (*format == '%' && *(format + 1) == '%') {
+			// Escaped % - "%%", output the second one.
+			node.literal = true;
+			node.offset = (format + 1) - start;
+			node.length = 1;
+			format += 2;
+		} else if (*format == '%') {
+			format++;
+			summary.error = constexpr_read_format_string(format, &node.fs);
+			if (summary.error != FORMAT_okay) {
+				return summary;
+			}
+			if (first_element) {
+				using_positions = (node.fs.position != 0);
+				first_element = false;
+			}
+			if ((node.fs.position != 0) != using_positions) {
+				summary.mixed_positions = true;
+				return summary;
+			}
+			if (node.fs.preceding_width != 0) {
+				node.width_argument = using_positions ?
+									  node.fs.preceding_width - 1 : next++;
+			}
+			if (node.fs.preceding_precision != 0) {
+				node.precision_argument = using_positions ?
+										  node.fs.preceding_precision - 1 :
+										  next++;
+			}
+			node.argument = using_positions ? node.fs.position - 1 : next++;
+			constexpr_check_unused_values(&node.fs);
+
+			int highest = node.argument;
+			if (node.width_argument > highest) {
+				highest = node.width_argument;
+			}
+			if (node.precision_argument > highest) {
+				highest = node.precision_argument;
+			}
+			if (highest + 1 > summary.argument_count) {
+				summary.argument_count = highest + 1;
+			}
+			format += node.fs.input_length;
+		} else {
+			// Just normal letters, up to the next '%'.
+			node.literal = true;
+			node.offset = format - start;
+			while (*format != '\0' && *format != '%') {
+				format++;
+			}
+			node.length = (format - start) - node.offset;
+		}
+
+		if (nodes != nullptr) {
+			nodes[summary.node_count] = node;
+		}
+		summary.node_count++;
+	}
+	return summary;
+}
+
+} // namespace detail
+
+} // namespace stdlib
+
+
+#endif // PRINTF_FORMAT_HPP
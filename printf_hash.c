@@ -0,0 +1,244 @@
+// Part of printf function suite. Handles hashing output as it is produced, for
+// hashprintf, so a digest of formatted output can be had without storing it.
+// The hash is xxHash64 (https://github.com/Cyan4973/xxHash), fed incrementally.
+// Input is consumed in 32 byte stripes, anything shorter is held in the state
+// until more arrives or the digest is taken.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_hash.h"
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+
+
+static uint64_t hash_rotate_left(uint64_t value, int amount);
+static uint64_t hash_read_64(const char *input);
+static uint32_t hash_read_32(const char *input);
+static uint64_t hash_round(uint64_t accumulator, uint64_t input);
+static uint64_t hash_merge_round(uint64_t accumulator, uint64_t value);
+static void hash_stripe(printf_hash_state *state, const char *stripe);
+
+
+
+// Sets up a hash state for new input.
+// Parameters:
+//     state - the state to set up.
+//     seed - the seed, different seeds give unrelated digests.
+void printf_hash_initialise(printf_hash_state *state, uint64_t seed)
+{
+	state->seed = seed;
+	state->accumulators[0] = seed + PRIME64_1 + PRIME64_2;
+	state->accumulators[1] = seed + PRIME64_2;
+	state->accumulators[2] = seed;
+	state->accumulators[3] = seed - PRIME64_1;
+	state->total_length = 0;
+	state->stripe_length = 0;
+}
+
+
+
+// Feeds a span of input into the hash.
+// Parameters:
+//     state - the hash state.
+//     span - the input, may be NULL if length is 0.
+//     length - the number of characters in span.
+void printf_hash_update(printf_hash_state *state, const char *span, 
+						size_t length)
+{
+	size_t needed = 0;
+	
+	state->total_length += length;
+	
+	// Finish off a stripe started by an earlier span.
+	if (state->stripe_length != 0) {
+		needed = HASH_STRIPE_SIZE - state->stripe_length;
+		if (length < needed) {
+			memcpy(state->stripe + state->stripe_length, span, length);
+			state->stripe_length += length;
+			return;
+		}
+		memcpy(state->stripe + state->stripe_length, span, needed);
+		hash_stripe(state, state->stripe);
+		state->stripe_length = 0;
+		span += needed;
+		length -= needed;
+	}
+	
+	// Whole stripes straight from the input.
+	while (length >= HASH_STRIPE_SIZE) {
+		hash_stripe(state, span);
+		span += HASH_STRIPE_SIZE;
+		length -= HASH_STRIPE_SIZE;
+	}
+	
+	// Keep the rest for later.
+	if (length != 0) {
+		memcpy(state->stripe, span, length);
+		state->stripe_length = length;
+	}
+}
+
+
+
+// Works out the digest of everything fed in so far. The state is unchanged, 
+// so more may be fed in afterwards.
+// Parameters:
+//     state - the hash state.
+// Returns:
+//     the 64 bit digest.
+uint64_t printf_hash_digest(const printf_hash_state *state)
+{
+	const char *remaining = state->stripe;
+	size_t length = state->stripe_length;
+	uint64_t hash = 0;
+	
+	if (state->total_length >= HASH_STRIPE_SIZE) {
+		hash = hash_rotate_left(state->accumulators[0], 1) + 
+			   hash_rotate_left(state->accumulators[1], 7) + 
+			   hash_rotate_left(state->accumulators[2], 12) + 
+			   hash_rotate_left(state->accumulators[3], 18);
+		for (int i = 0; i < 4; i++) {
+			hash = hash_merge_round(hash, state->accumulators[i]);
+		}
+	} else {
+		hash = state->seed + PRIME64_5;
+	}
+	hash += state->total_length;
+	
+	while (length >= 8) {
+		hash ^= hash_round(0, hash_read_64(remaining));
+		hash = hash_rotate_left(hash, 27) * PRIME64_1 + PRIME64_4;
+		remaining += 8;
+		length -= 8;
+	}
+	if (length >= 4) {
+		hash ^= (uint64_t) hash_read_32(remaining) * PRIME64_1;
+		hash = hash_rotate_left(hash, 23) * PRIME64_2 + PRIME64_3;
+		remaining += 4;
+		length -= 4;
+	}
+	while (length > 0) {
+		hash ^= (unsigned char) *remaining * PRIME64_5;
+		hash = hash_rotate_left(hash, 11) * PRIME64_1;
+		remaining++;
+		length--;
+	}
+	
+	// Final mix so every input bit affects every output bit.
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+
+
+// Rotates the bits of value left.
+// Parameters:
+//     value - the value to rotate.
+//     amount - how many bits to rotate by, 1 to 63.
+// Returns:
+//     the rotated value.
+static uint64_t hash_rotate_left(uint64_t value, int amount)
+{
+	return (value << amount) | (value >> (64 - amount));
+}
+
+
+
+// Reads 8 bytes of input as a little endian number.
+// Parameters:
+//     input - the bytes to read.
+// Returns:
+//     the number.
+static uint64_t hash_read_64(const char *input)
+{
+	const unsigned char *bytes = (const unsigned char*) input;
+	uint64_t value = 0;
+	
+	for (int i = 7; i >= 0; i--) {
+		value = (value << 8) | bytes[i];
+	}
+	return value;
+}
+
+
+
+// Reads 4 bytes of input as a little endian number.
+// Parameters:
+//     input - the bytes to read.
+// Returns:
+//     the number.
+static uint32_t hash_read_32(const char *input)
+{
+	const unsigned char *bytes = (const unsigned char*) input;
+	uint32_t value = 0;
+	
+	for (int i = 3; i >= 0; i--) {
+		value = (value << 8) | bytes[i];
+	}
+	return value;
+}
+
+
+
+// Mixes 8 bytes of input into an accumulator.
+// Parameters:
+//     accumulator - the accumulator.
+//     input - the input to mix in.
+// Returns:
+//     the new accumulator.
+static uint64_t hash_round(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * PRIME64_2;
+	accumulator = hash_rotate_left(accumulator, 31);
+	accumulator *= PRIME64_1;
+	return accumulator;
+}
+
+
+
+// Mixes one of the accumulators into the digest.
+// Parameters:
+//     accumulator - the digest so far.
+//     value - the accumulator to mix in.
+// Returns:
+//     the new digest.
+static uint64_t hash_merge_round(uint64_t accumulator, uint64_t value)
+{
+	accumulator ^= hash_round(0, value);
+	accumulator = accumulator * PRIME64_1 + PRIME64_4;
+	return accumulator;
+}
+
+
+
+// Mixes a whole 32 byte stripe into the accumulators.
+// Parameters:
+//     state - the hash state.
+//     stripe - the 32 bytes of input.
+static void hash_stripe(printf_hash_state *state, const char *stripe)
+{
+	for (int i = 0; i < 4; i++) {
+		state->accumulators[i] = hash_round(state->accumulators[i], 
+											hash_read_64(stripe + 8 * i));
+	}
+}
@@ -0,0 +1,15 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_HASH_H
+#define PRINTF_HASH_H
+
+#include "printf_definitions.h"
+
+void printf_hash_initialise(printf_hash_state *state, uint64_t seed);
+void printf_hash_update(printf_hash_state *state, const char *span, 
+						size_t length);
+uint64_t printf_hash_digest(const printf_hash_state *state);
+
+#endif // PRINTF_HASH_H
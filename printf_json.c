@@ -0,0 +1,365 @@
+// Part of printf function suite. Writes strings escaped for JSON, for the
+// built in "%{json}" conversion, e.g.
+//     new_printf("{\"message\": \"%{json}\"}\n", message);
+// The quotes aren't written, so the conversion can be used for part of a
+// string. '"', '\\' and control characters are escaped, anything else,
+// including UTF-8, is copied as it is.
+//
+// Width and precision work as they do for "%s": precision is the most
+// characters of the argument read, and width pads what is written, escapes
+// included. A NULL argument is written as "(null)".
+//
+// Most strings need few escapes, so a kernel finds the run of characters
+// before the next that needs one, and the run is copied in one go. SSE2 and
+// AVX2 kernels check 16 or 32 characters at a time, as picked by printf_cpu.c,
+// and read past the end of the string in the same way as its kernels do.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_json.h"
+#include "printf_cpu.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_X86
+#include <immintrin.h>
+#endif
+
+// Output is collected in a buffer of this size before being handed on.
+#define JSON_BUFFER_SIZE 4096
+
+// Collects escaped output, so escapes aren't handed on one at a time.
+typedef struct json_sink_struct {
+	output_specifier *output;
+	char buffer[JSON_BUFFER_SIZE];
+	size_t used;
+	bool result;
+} json_sink;
+
+
+
+static size_t json_escape(json_sink *sink, const char *input, size_t max);
+static size_t json_escape_character(unsigned char character, char *escape);
+static void json_put(json_sink *sink, const char *span, size_t length);
+static void json_fill(json_sink *sink, char character, size_t length);
+static bool json_flush(json_sink *sink);
+
+
+
+// Writes a string escaped for JSON, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, width and precision as for "%s".
+//     argument - the string, in argument->value.string.
+//     context - unused.
+// Returns:
+//     true on success, false on error.
+bool printf_json_write(output_specifier *output, const format_specifier *fs,
+					   const printf_arg *argument, void *context)
+{
+	json_sink sink;
+	const char *input = argument->value.string;
+	size_t max = SIZE_MAX;
+	size_t length = 0;
+	size_t padding = 0;
+
+	(void) context;
+	if (fs->precision != -1) {
+		max = fs->precision;
+	}
+	if (input == NULL && max != 0) {
+		input = "(null)";
+	}
+
+	sink.output = output;
+	sink.used = 0;
+	sink.result = true;
+	if (fs->width > 0 && !fs->left_justify) {
+		// Right justified, so the length is needed first.
+		length = json_escape(NULL, input, max);
+		if (fs->width > length) {
+			padding = fs->width - length;
+		}
+		json_fill(&sink, ' ', padding);
+		json_escape(&sink, input, max);
+	} else {
+		length = json_escape(&sink, input, max);
+		if (fs->width > length) {
+			json_fill(&sink, ' ', fs->width - length);
+		}
+	}
+	return json_flush(&sink);
+}
+
+
+
+// Finds the run of characters that JSON doesn't need escaped.
+// Parameters:
+//     string - the string.
+//     max - the most characters of string to read.
+// Returns:
+//     the number of characters before the first that needs escaping or '\0',
+//     or max, whichever is smaller.
+size_t printf_json_kernel_scalar(const char *string, size_t max)
+{
+	size_t count = 0;
+	unsigned char character = 0;
+
+	while (count < max) {
+		character = string[count];
+		if (character < 0x20 || character == '"' || character == '\\') {
+			break;
+		}
+		count++;
+	}
+	return count;
+}
+
+
+
+#ifdef JSON_X86
+// printf_json_kernel_scalar 16 characters at a time.
+// Parameters:
+//     string - the string.
+//     max - the most characters of string to read.
+// Returns:
+//     the number of characters before the first that needs escaping or '\0',
+//     or max, whichever is smaller.
+__attribute__((target("sse2"), no_sanitize_address))
+size_t printf_json_kernel_sse2(const char *string, size_t max)
+{
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1f);
+	unsigned int offset = (uintptr_t) string & 15;
+	const char *block = string - offset;
+	__m128i chunk;
+	unsigned int found = 0;
+	size_t length = 0;
+
+	if (max == 0) {
+		return 0;
+	}
+	for (;;) {
+		chunk = _mm_load_si128((const __m128i*) block);
+		// Control characters are those no greater than 0x1f, unsigned.
+		found = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+			_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control)));
+		if (block < string) {
+			found &= UINT_MAX << offset;
+		}
+		if (found != 0) {
+			break;
+		}
+		block += 16;
+		if ((size_t) (block - string) >= max) {
+			return max;
+		}
+	}
+	length = block + __builtin_ctz(found) - string;
+	return length < max ? length : max;
+}
+
+
+
+// printf_json_kernel_scalar 32 characters at a time.
+// Parameters:
+//     string - the string.
+//     max - the most characters of string to read.
+// Returns:
+//     the number of characters before the first that needs escaping or '\0',
+//     or max, whichever is smaller.
+__attribute__((target("avx2"), no_sanitize_address))
+size_t printf_json_kernel_avx2(const char *string, size_t max)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i control = _mm256_set1_epi8(0x1f);
+	unsigned int offset = (uintptr_t) string & 31;
+	const char *block = string - offset;
+	__m256i chunk;
+	unsigned int found = 0;
+	size_t length = 0;
+
+	if (max == 0) {
+		return 0;
+	}
+	for (;;) {
+		chunk = _mm256_load_si256((const __m256i*) block);
+		found = _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+			_mm256_cmpeq_epi8(chunk, quote),
+			_mm256_cmpeq_epi8(chunk, backslash)),
+			_mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control)));
+		if (block < string) {
+			found &= UINT_MAX << offset;
+		}
+		if (found != 0) {
+			break;
+		}
+		block += 32;
+		if ((size_t) (block - string) >= max) {
+			return max;
+		}
+	}
+	length = block + __builtin_ctz(found) - string;
+	return length < max ? length : max;
+}
+#endif
+
+
+
+// Escapes a string, or just works out how long it is escaped.
+// Parameters:
+//     sink - where to write to, NULL to only count.
+//     input - the string, may be NULL if max is 0.
+//     max - the most characters of input to read.
+// Returns:
+//     the number of characters written, or that would be.
+static size_t json_escape(json_sink *sink, const char *input, size_t max)
+{
+	size_t (*plain)(const char *string, size_t max) = printf_cpu()->json_plain;
+	char escape[6];
+	size_t escape_length = 0;
+	size_t read = 0;
+	size_t written = 0;
+	size_t run = 0;
+
+	while (read < max) {
+		run = plain(input + read, max - read);
+		if (sink != NULL) {
+			json_put(sink, input + read, run);
+		}
+		read += run;
+		written += run;
+		if (read == max || input[read] == '\0') {
+			break;
+		}
+		escape_length = json_escape_character(input[read], escape);
+		if (sink != NULL) {
+			json_put(sink, escape, escape_length);
+		}
+		written += escape_length;
+		read++;
+	}
+	return written;
+}
+
+
+
+// Escapes a character.
+// Parameters:
+//     character - '"', '\\' or a control character.
+//     escape - where to write the escape, room for 6 characters.
+// Returns:
+//     the length of the escape.
+static size_t json_escape_character(unsigned char character, char *escape)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+
+	escape[0] = '\\';
+	switch (character) {
+		case '"':
+			// PASS-THROUGH
+		case '\\':
+			escape[1] = character;
+			return 2;
+		case '\b':
+			escape[1] = 'b';
+			return 2;
+		case '\f':
+			escape[1] = 'f';
+			return 2;
+		case '\n':
+			escape[1] = 'n';
+			return 2;
+		case '\r':
+			escape[1] = 'r';
+			return 2;
+		case '\t':
+			escape[1] = 't';
+			return 2;
+		default:
+			escape[1] = 'u';
+			escape[2] = '0';
+			escape[3] = '0';
+			escape[4] = hex_digits[character >> 4];
+			escape[5] = hex_digits[character & 15];
+			return 6;
+	}
+}
+
+
+
+// Adds characters to the sink, handing on long runs directly.
+// Parameters:
+//     sink - the sink.
+//     span - the characters.
+//     length - the number of characters, may be 0.
+static void json_put(json_sink *sink, const char *span, size_t length)
+{
+	if (length > JSON_BUFFER_SIZE - sink->used) {
+		json_flush(sink);
+		if (length >= JSON_BUFFER_SIZE) {
+			if (!printf_output_span(sink->output, span, length)) {
+				sink->result = false;
+			}
+			return;
+		}
+	}
+	memcpy(sink->buffer + sink->used, span, length);
+	sink->used += length;
+}
+
+
+
+// Adds a character to the sink a number of times.
+// Parameters:
+//     sink - the sink.
+//     character - the character.
+//     length - the number of times, may be 0.
+static void json_fill(json_sink *sink, char character, size_t length)
+{
+	size_t chunk = 0;
+
+	while (length > 0) {
+		if (sink->used == JSON_BUFFER_SIZE) {
+			json_flush(sink);
+		}
+		chunk = JSON_BUFFER_SIZE - sink->used;
+		if (chunk > length) {
+			chunk = length;
+		}
+		memset(sink->buffer + sink->used, character, chunk);
+		sink->used += chunk;
+		length -= chunk;
+	}
+}
+
+
+
+// Hands what is in the sink on to its output.
+// Parameters:
+//     sink - the sink.
+// Returns:
+//     true if everything was written, false if anything failed.
+static bool json_flush(json_sink *sink)
+{
+	if (sink->used != 0 &&
+		!printf_output_span(sink->output, sink->buffer, sink->used))
+	{
+		sink->result = false;
+	}
+	sink->used = 0;
+	return sink->result;
+}
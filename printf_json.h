@@ -0,0 +1,17 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_JSON_H
+#define PRINTF_JSON_H
+
+#include "printf_definitions.h"
+
+bool printf_json_write(output_specifier *output, const format_specifier *fs,
+					   const printf_arg *argument, void *context);
+
+size_t printf_json_kernel_scalar(const char *string, size_t max);
+size_t printf_json_kernel_sse2(const char *string, size_t max);
+size_t printf_json_kernel_avx2(const char *string, size_t max);
+
+#endif // PRINTF_JSON_H
@@ -0,0 +1,116 @@
+// Part of printf function suite. Holds what printf needs from the locale, the
+// thousands separator and digit grouping for the ' flag, e.g.
+//     setlocale(LC_NUMERIC, "");
+//     new_printf("%'d\n", 1234567);
+// writes "1,234,567" in an English locale. The "C" locale doesn't group.
+//
+// The decimal point is kept with them, for the conversions that write
+// decimals, e.g. "%{fixed}".
+//
+// localeconv() fills in a whole struct lconv, so rather than calling it for
+// every number, each thread keeps what it got and only calls it again when
+// the locale has changed. nl_langinfo(THOUSEP) points into the loaded
+// locale's own data, so it is a cheap way to tell, and notices locales set
+// with uselocale() as well as setlocale(). The grouping is kept as a bit per
+// digit position, so the digits can be written without walking the locale's
+// grouping string.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <locale.h>
+#include <langinfo.h>
+
+#include "printf_definitions.h"
+#include "printf_locale.h"
+
+// This thread's grouping, and nl_langinfo(THOUSEP) for the locale it is for,
+// NULL until the first call.
+static _Thread_local printf_grouping locale_grouping;
+static _Thread_local const char *locale_key = NULL;
+
+
+
+static void locale_read_grouping(printf_grouping *grouping);
+
+
+
+// Gets the digit grouping of the current LC_NUMERIC locale.
+// Returns:
+//     the grouping, valid until the next call on this thread.
+const printf_grouping* printf_locale_grouping(void)
+{
+	const char *key = nl_langinfo(THOUSEP);
+
+	if (key != locale_key) {
+		locale_read_grouping(&locale_grouping);
+		locale_key = key;
+	}
+	return &locale_grouping;
+}
+
+
+
+// Reads the decimal point, thousands separator and grouping from
+// localeconv().
+// Parameters:
+//     grouping - where to write them.
+static void locale_read_grouping(printf_grouping *grouping)
+{
+	const struct lconv *conventions = localeconv();
+	const char *sizes = conventions->grouping;
+	size_t length = 0;
+	int size = 0;
+	int position = 0;
+
+	grouping->decimal_point[0] = '.';
+	grouping->decimal_point_length = 1;
+	length = strlen(conventions->decimal_point);
+	if (length > 0 && length <= PRINTF_SEPARATOR_MAX) {
+		memcpy(grouping->decimal_point, conventions->decimal_point, length);
+		grouping->decimal_point_length = length;
+	}
+
+	grouping->separator_length = 0;
+	grouping->boundaries = 0;
+	grouping->repeat = 0;
+	length = strlen(conventions->thousands_sep);
+	if (length == 0 || length > PRINTF_SEPARATOR_MAX) {
+		// Doesn't group, or a separator too long to be a character.
+		return;
+	}
+	memcpy(grouping->separator, conventions->thousands_sep, length);
+	grouping->separator_length = length;
+
+	// Each size is the digits in the next group leftwards. The last is used
+	// again if the string ends, and CHAR_MAX means no more grouping.
+	for (;;) {
+		if (*sizes != '\0') {
+			if (*sizes == CHAR_MAX) {
+				break;
+			}
+			size = *sizes;
+			sizes++;
+		}
+		if (size <= 0) {
+			break;
+		}
+		position += size;
+		if (position >= 64) {
+			if (*sizes == '\0') {
+				// The last size goes on for as many digits as there are.
+				grouping->repeat = size;
+			}
+			break;
+		}
+		grouping->boundaries |= (uint64_t) 1 << position;
+	}
+}
@@ -0,0 +1,12 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_LOCALE_H
+#define PRINTF_LOCALE_H
+
+#include "printf_definitions.h"
+
+const printf_grouping* printf_locale_grouping(void);
+
+#endif // PRINTF_LOCALE_H
@@ -0,0 +1,263 @@
+// Part of printf function suite. Handles output to an append-only log file 
+// that is written through a shared memory mapping, for mmprintf.
+// The file starts with a small header holding the end of the data written so 
+// far (tail). Writers reserve space with an atomic fetch-add on tail and copy
+// straight into the mapping, so threads and processes can share a log without
+// locks or write() calls, and anything copied in survives the writer crashing.
+// The whole capacity is mapped up front and the file is grown underneath it in
+// large extents. The mapping never moves, so no writer is ever left holding a 
+// pointer into an unmapped region.
+// Each mmprintf message is reserved and copied in one piece, so messages from
+// different writers never interleave. Space reserved but never filled, when 
+// the file couldn't be grown or a writer died while copying, is left as '\0'
+// bytes, so readers should skip runs of '\0'.
+// Needs POSIX, and flock() to stop two openers both writing the header of a 
+// new file, so is for Linux and the BSDs. flock() is used over fcntl() locks 
+// as it also keeps out other threads of the same process.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+// For posix_fallocate() and pwrite() when compiling as plain C.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "printf_definitions.h"
+#include "printf_mmap.h"
+
+// Identifies a file as one of our logs, "PRNTFLOG".
+#define MMAP_LOG_MAGIC 0x474f4c46544e5250ULL
+// Where the data starts in the file, after the header.
+#define MMAP_LOG_HEADER_SIZE 64
+// How much the file grows by at a time.
+#define MMAP_LOG_EXTENT_SIZE (1024 * 1024)
+
+
+
+// The header at the start of the file. Shared between every process with the
+// log open, tail and file_size are only accessed atomically.
+typedef struct mmap_log_header_struct {
+	uint64_t magic;
+	// Offset of the end of the space reserved so far.
+	uint64_t tail;
+	// How big the file has been grown to.
+	uint64_t file_size;
+} mmap_log_header;
+
+
+
+static bool mmap_log_create_header(int fd);
+static bool mmap_log_grow(printf_mmap_log *log, uint64_t required_size);
+
+
+
+// Opens a log file, creating it if it doesn't exist. capacity bytes of 
+// address space are mapped, which is the most the file can ever grow to.
+// Parameters:
+//     log - the log to open.
+//     path - the file to log to.
+//     capacity - the largest the file may grow to, including the header. 
+//         Should be the same in every process with the file open.
+// Returns:
+//     log - set up on success.
+//     return - true on success, false on error.
+bool printf_mmap_log_open(printf_mmap_log *log, const char *path, 
+						  size_t capacity)
+{
+	struct stat file_status;
+	mmap_log_header *header = NULL;
+	
+	assert(log != NULL);
+	assert(path != NULL);
+	if (log == NULL || path == NULL || capacity <= MMAP_LOG_HEADER_SIZE) {
+		return false;
+	}
+	
+	log->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (log->fd == -1) {
+		return false;
+	}
+	
+	// Only one process should write the header of a new file.
+	if (flock(log->fd, LOCK_EX) != 0) {
+		close(log->fd);
+		return false;
+	}
+	if (fstat(log->fd, &file_status) != 0) {
+		close(log->fd);
+		return false;
+	}
+	if (file_status.st_size == 0) {
+		if (!mmap_log_create_header(log->fd)) {
+			close(log->fd);
+			return false;
+		}
+	} else if ((size_t) file_status.st_size > capacity) {
+		close(log->fd);
+		return false;
+	}
+	flock(log->fd, LOCK_UN);
+	
+	log->base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, 
+					 log->fd, 0);
+	if (log->base == MAP_FAILED) {
+		close(log->fd);
+		return false;
+	}
+	log->capacity = capacity;
+	
+	header = (mmap_log_header*) log->base;
+	if (header->magic != MMAP_LOG_MAGIC) {
+		// Not one of our logs.
+		munmap(log->base, capacity);
+		close(log->fd);
+		return false;
+	}
+	
+	return true;
+}
+
+
+
+// Closes a log. The file is left as is for other processes, and for reading.
+// Parameters:
+//     log - the log to close.
+// Returns:
+//     true on success, false on error.
+bool printf_mmap_log_close(printf_mmap_log *log)
+{
+	bool result = true;
+	
+	if (munmap(log->base, log->capacity) != 0) {
+		result = false;
+	}
+	if (close(log->fd) != 0) {
+		result = false;
+	}
+	log->base = NULL;
+	log->fd = -1;
+	return result;
+}
+
+
+
+// Flushes everything written to the log out to disk. Not needed to survive
+// the writing process crashing, only for the machine crashing.
+// Parameters:
+//     log - the log to flush.
+// Returns:
+//     true on success, false on error.
+bool printf_mmap_log_sync(printf_mmap_log *log)
+{
+	mmap_log_header *header = (mmap_log_header*) log->base;
+	uint64_t size = __atomic_load_n(&header->file_size, __ATOMIC_ACQUIRE);
+	
+	return msync(log->base, size, MS_SYNC) == 0;
+}
+
+
+
+// Appends a span to the log. Space is reserved for the whole span at once, so
+// it is never interleaved with other writers. mmprintf hands over each 
+// message as a single span. If the file can't be grown after the space is 
+// reserved, the space is left as '\0' bytes for readers to skip.
+// Parameters:
+//     log - the log to append to.
+//     span - the characters to append.
+//     length - the number of characters in span.
+// Returns:
+//     true on success, false on error or if the log is full.
+bool printf_mmap_log_write(printf_mmap_log *log, const char *span, 
+						   size_t length)
+{
+	mmap_log_header *header = (mmap_log_header*) log->base;
+	uint64_t offset = 0;
+	
+	offset = __atomic_fetch_add(&header->tail, length, __ATOMIC_RELAXED);
+	if (offset > log->capacity || length > log->capacity - offset) {
+		// Full. The tail stays past the capacity so every later write fails 
+		// too, rather than leaving a hole.
+		return false;
+	}
+	
+	if (!mmap_log_grow(log, offset + length)) {
+		return false;
+	}
+	
+	memcpy(log->base + offset, span, length);
+	return true;
+}
+
+
+
+// Writes the header into a new, empty log file and gives it its first extent.
+// Parameters:
+//     fd - the log file.
+// Returns:
+//     true on success, false on error.
+static bool mmap_log_create_header(int fd)
+{
+	mmap_log_header header;
+	header.magic = MMAP_LOG_MAGIC;
+	header.tail = MMAP_LOG_HEADER_SIZE;
+	header.file_size = MMAP_LOG_EXTENT_SIZE;
+	
+	if (posix_fallocate(fd, 0, MMAP_LOG_EXTENT_SIZE) != 0) {
+		return false;
+	}
+	if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+		return false;
+	}
+	return true;
+}
+
+
+
+// Makes sure the file is at least required_size, growing it by whole extents
+// if not. Writing to the mapping past the end of the file would fault.
+// Parameters:
+//     log - the log to grow.
+//     required_size - the size the file needs to be.
+// Returns:
+//     true on success, false on error.
+static bool mmap_log_grow(printf_mmap_log *log, uint64_t required_size)
+{
+	mmap_log_header *header = (mmap_log_header*) log->base;
+	uint64_t size = __atomic_load_n(&header->file_size, __ATOMIC_ACQUIRE);
+	uint64_t new_size = 0;
+	
+	while (size < required_size) {
+		new_size = (required_size + MMAP_LOG_EXTENT_SIZE - 1) / 
+				   MMAP_LOG_EXTENT_SIZE * MMAP_LOG_EXTENT_SIZE;
+		if (new_size > log->capacity) {
+			new_size = log->capacity;
+		}
+		// posix_fallocate never shrinks the file, so racing writers can't
+		// undo each other.
+		if (posix_fallocate(log->fd, 0, new_size) != 0) {
+			return false;
+		}
+		// If someone else grew it further in the meantime, size is updated and
+		// we go around again to check it.
+		if (__atomic_compare_exchange_n(&header->file_size, &size, new_size, 
+										false, __ATOMIC_RELEASE, 
+										__ATOMIC_ACQUIRE))
+		{
+			size = new_size;
+		}
+	}
+	return true;
+}
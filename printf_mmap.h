@@ -0,0 +1,17 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_MMAP_H
+#define PRINTF_MMAP_H
+
+#include "printf_definitions.h"
+
+bool printf_mmap_log_open(printf_mmap_log *log, const char *path, 
+						  size_t capacity);
+bool printf_mmap_log_close(printf_mmap_log *log);
+bool printf_mmap_log_sync(printf_mmap_log *log);
+bool printf_mmap_log_write(printf_mmap_log *log, const char *span, 
+						   size_t length);
+
+#endif // PRINTF_MMAP_H
@@ -0,0 +1,409 @@
+// Part of printf function suite. Writes integers as decimal quantities, for
+// the built in named conversions:
+//     %{iec} - a count of bytes with a binary prefix, "1.5 KiB", "3.2 GiB".
+//     %{si} - a quantity with an SI prefix, "12.3 k", "4.5 µ", for the unit
+//         to follow, e.g. "%{si}Hz".
+//     %{fixed} - a fixed point number, an integer with an implied number of
+//         decimals, e.g. "%ll{fixed:2}" writes cents as "-12.34".
+// %{iec} reads an unsigned integer and the others a signed one, with the
+// usual lengths, e.g. "%z{iec}" for a size_t. The option is the unit the
+// value is in, as a power of 1024 or of 10, e.g. "%{iec:1}" for a count of
+// KiB or "%{si:-9}" for nanoseconds, or for %{fixed} the number of implied
+// decimals, 0 to 60.
+//
+// Precision is the number of decimals, at most 60. It is 1 if not given, or
+// for %{fixed} the implied decimals, so the value is written exactly. Counts
+// of bytes under 1 KiB are written without decimals. Width and the '-', '0',
+// '+', ' ', '#' and ' flags work as they do for "%f", and the decimal point
+// is the locale's.
+//
+// The value is never converted to floating point. The prefix is picked from
+// the number of bits or digits in the value, the whole part is a shift or a
+// division by a power of ten, each decimal comes from the remainder, and the
+// last is rounded half away from zero.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "printf_definitions.h"
+#include "printf_quantity.h"
+#include "printf_locale.h"
+
+// The most decimals written.
+#define QUANTITY_MAX_PRECISION 60
+// Room for a sign, 20 digits with separators, a decimal point, the decimals,
+// ' ' and a unit.
+#define QUANTITY_BUFFER_SIZE 192
+// The exponent of the largest SI prefix, and minus that of the smallest.
+#define QUANTITY_SI_MAX 30
+
+// Binary units, by power of 1024.
+static const char *const quantity_iec_units[] = {
+	"B", "KiB", "MiB", "GiB", "TiB", "PiB", "EiB", "ZiB", "YiB", "RiB", "QiB"
+};
+
+// SI prefixes from 10^-30 to 10^30, by thousands. "\xc2\xb5" is the micro
+// sign in UTF-8.
+static const char *const quantity_si_prefixes[] = {
+	"q", "r", "y", "z", "a", "f", "p", "n", "\xc2\xb5", "m", "",
+	"k", "M", "G", "T", "P", "E", "Z", "Y", "R", "Q"
+};
+
+
+
+static int quantity_precision(const format_specifier *fs, int otherwise);
+static bool quantity_round(char *decimals, int count, uintmax_t *whole);
+static bool quantity_write(output_specifier *output,
+						   const format_specifier *fs, bool negative,
+						   uintmax_t whole, const char *decimals, int count,
+						   const char *unit);
+static bool quantity_pad(output_specifier *output, char character,
+						 size_t length);
+
+
+
+// Writes a count of bytes with a binary prefix, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of decimals and
+//         the option the power of 1024 the count is in.
+//     argument - the count, in argument->value.unsigned_integer.
+//     context - unused.
+// Returns:
+//     true on success, false on error, including an option with no unit.
+bool printf_quantity_iec_write(output_specifier *output,
+							   const format_specifier *fs,
+							   const printf_arg *argument, void *context)
+{
+	const int unit_count = sizeof(quantity_iec_units) /
+						   sizeof(quantity_iec_units[0]);
+	uintmax_t value = argument->value.unsigned_integer;
+	uintmax_t remainder = 0;
+	uintmax_t whole = 0;
+	char decimals[QUANTITY_MAX_PRECISION];
+	int count = quantity_precision(fs, 1);
+	int unit = fs->custom_option;
+	int shift = 0;
+
+	(void) context;
+	if (unit < 0 || unit >= unit_count) {
+		return false;
+	}
+	// The largest power of 1024 not above the value. Nothing is "0 B".
+	if (value == 0) {
+		unit = 0;
+	}
+	while (unit + 1 < unit_count &&
+		   shift + 10 < (int) (sizeof(uintmax_t) * CHAR_BIT) &&
+		   (value >> (shift + 10)) != 0)
+	{
+		shift += 10;
+		unit++;
+	}
+	if (unit == 0) {
+		count = 0;
+	}
+
+	// The remainder is under 2^60, so times 10 it still fits.
+	whole = value >> shift;
+	remainder = (shift == 0) ? 0 : value & ((UINTMAX_C(1) << shift) - 1);
+	for (int i = 0; i < count; i++) {
+		remainder *= 10;
+		decimals[i] = '0' + (char) (remainder >> shift);
+		remainder &= (shift == 0) ? 0 : (UINTMAX_C(1) << shift) - 1;
+	}
+	if (shift != 0 && (remainder >> (shift - 1)) != 0 &&
+		quantity_round(decimals, count, &whole) && whole == 1024 &&
+		unit + 1 < unit_count)
+	{
+		// Rounded up to the next unit, "1023.96 KiB" is "1.0 MiB".
+		whole = 1;
+		unit++;
+	}
+	return quantity_write(output, fs, false, whole, decimals, count,
+						  quantity_iec_units[unit]);
+}
+
+
+
+// Writes a quantity with an SI prefix, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of decimals and
+//         the option the power of 10 the quantity is in.
+//     argument - the quantity, in argument->value.integer.
+//     context - unused.
+// Returns:
+//     true on success, false on error, including an option out of range.
+bool printf_quantity_si_write(output_specifier *output,
+							  const format_specifier *fs,
+							  const printf_arg *argument, void *context)
+{
+	intmax_t value = argument->value.integer;
+	uintmax_t magnitude = value < 0 ? -(uintmax_t) value : (uintmax_t) value;
+	uintmax_t power = 1;
+	uintmax_t remainder = 0;
+	uintmax_t whole = 0;
+	char decimals[QUANTITY_MAX_PRECISION];
+	int count = quantity_precision(fs, 1);
+	int exponent = fs->custom_option;
+	int digits = 1;
+	int top = 0;
+	int prefix = 0;
+	int shift = 0;
+
+	(void) context;
+	if (exponent < -QUANTITY_SI_MAX || exponent > QUANTITY_SI_MAX) {
+		return false;
+	}
+	// The prefix is the thousands of the leading digit, rounding down.
+	// Nothing is "0.0 " in any unit.
+	if (magnitude == 0) {
+		exponent = 0;
+	}
+	for (uintmax_t rest = magnitude; rest >= 10; rest /= 10) {
+		digits++;
+	}
+	top = digits - 1 + exponent;
+	prefix = (top >= 0) ? top / 3 * 3 : -((2 - top) / 3 * 3);
+	if (prefix > QUANTITY_SI_MAX) {
+		prefix = QUANTITY_SI_MAX;
+	}
+
+	// The prefix is at most 2 below the exponent, when the quantity has at
+	// most 2 digits, so multiplying can't overflow. Dividing is by at most
+	// 10^19, as many digits as the quantity has.
+	shift = prefix - exponent;
+	for (int i = shift < 0 ? shift : 0; i < 0; i++) {
+		magnitude *= 10;
+	}
+	for (int i = 0; i < shift; i++) {
+		power *= 10;
+	}
+	whole = magnitude / power;
+	remainder = magnitude % power;
+	for (int i = 0; i < count; i++) {
+		if (power > 1) {
+			power /= 10;
+			decimals[i] = '0' + (char) (remainder / power);
+			remainder %= power;
+		} else {
+			decimals[i] = '0';
+		}
+	}
+	if (remainder >= power - remainder && remainder != 0 &&
+		quantity_round(decimals, count, &whole) && whole == 1000 &&
+		prefix < QUANTITY_SI_MAX)
+	{
+		// Rounded up to the next prefix, "999.96 k" is "1.0 M".
+		whole = 1;
+		prefix += 3;
+	}
+	return quantity_write(output, fs, value < 0, whole, decimals, count,
+				quantity_si_prefixes[(prefix + QUANTITY_SI_MAX) / 3]);
+}
+
+
+
+// Writes a fixed point number, as a printf_custom_function.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, the precision is the number of decimals and
+//         the option the number of implied decimals.
+//     argument - the number, in argument->value.integer.
+//     context - unused.
+// Returns:
+//     true on success, false on error, including an option out of range.
+bool printf_quantity_fixed_write(output_specifier *output,
+								 const format_specifier *fs,
+								 const printf_arg *argument, void *context)
+{
+	intmax_t value = argument->value.integer;
+	uintmax_t whole = value < 0 ? -(uintmax_t) value : (uintmax_t) value;
+	char decimals[QUANTITY_MAX_PRECISION];
+	int scale = fs->custom_option;
+	int count = 0;
+	bool round_up = false;
+
+	(void) context;
+	if (scale < 0 || scale > QUANTITY_MAX_PRECISION) {
+		return false;
+	}
+	count = quantity_precision(fs, scale);
+
+	// The implied decimals, last first, then zeros for any more asked for.
+	// Past 20 they are all '0'.
+	memset(decimals, '0', sizeof(decimals));
+	for (int i = scale - 1; i >= 0; i--) {
+		decimals[i] = '0' + (char) (whole % 10);
+		whole /= 10;
+	}
+	if (count < scale) {
+		// Exact, so the first dropped digit says which way to round.
+		round_up = decimals[count] >= '5';
+	}
+	if (round_up) {
+		quantity_round(decimals, count, &whole);
+	}
+	return quantity_write(output, fs, value < 0, whole, decimals, count,
+						  NULL);
+}
+
+
+
+// Works out how many decimals to write.
+// Parameters:
+//     fs - the format specifier.
+//     otherwise - the number of decimals if the precision isn't given.
+// Returns:
+//     the precision, or otherwise, no more than QUANTITY_MAX_PRECISION.
+static int quantity_precision(const format_specifier *fs, int otherwise)
+{
+	if (fs->precision == -1) {
+		return otherwise;
+	} else if (fs->precision > QUANTITY_MAX_PRECISION) {
+		return QUANTITY_MAX_PRECISION;
+	}
+	return fs->precision;
+}
+
+
+
+// Rounds decimals up by one in the last place.
+// Parameters:
+//     decimals - the decimal digits.
+//     count - the number of decimals, may be 0.
+//     whole - the whole part, incremented if the decimals were all '9'.
+// Returns:
+//     true if whole was incremented, false if not.
+static bool quantity_round(char *decimals, int count, uintmax_t *whole)
+{
+	for (int i = count - 1; i >= 0; i--) {
+		if (decimals[i] != '9') {
+			decimals[i]++;
+			return false;
+		}
+		decimals[i] = '0';
+	}
+	(*whole)++;
+	return true;
+}
+
+
+
+// Writes a quantity with its sign, unit and padding.
+// Parameters:
+//     output - where to write to.
+//     fs - the format specifier, for width and flags.
+//     negative - whether to write a '-'.
+//     whole - the whole part.
+//     decimals - the decimal digits.
+//     count - the number of decimals, may be 0.
+//     unit - the unit or prefix, written after a space, or NULL for none.
+// Returns:
+//     true on success, false on error.
+static bool quantity_write(output_specifier *output,
+						   const format_specifier *fs, bool negative,
+						   uintmax_t whole, const char *decimals, int count,
+						   const char *unit)
+{
+	const printf_grouping *locale = printf_locale_grouping();
+	char buffer[QUANTITY_BUFFER_SIZE];
+	char digits[24];
+	uint64_t boundaries = 0;
+	size_t length = 0;
+	size_t padding = 0;
+	int digit_count = 0;
+	char sign = 0;
+
+	if (negative) {
+		sign = '-';
+	} else if (fs->always_sign) {
+		sign = '+';
+	} else if (fs->empty_sign) {
+		sign = ' ';
+	}
+	do {
+		digits[digit_count++] = '0' + (char) (whole % 10);
+		whole /= 10;
+	} while (whole != 0);
+	if (fs->thousands_grouping) {
+		boundaries = locale->boundaries;
+	}
+
+	if (sign != 0) {
+		buffer[length++] = sign;
+	}
+	while (digit_count > 0) {
+		buffer[length++] = digits[--digit_count];
+		// digit_count is now the digits to the right.
+		if ((boundaries >> digit_count) & 1) {
+			memcpy(buffer + length, locale->separator,
+				   locale->separator_length);
+			length += locale->separator_length;
+		}
+	}
+	if (count > 0 || fs->alternate_form) {
+		memcpy(buffer + length, locale->decimal_point,
+			   locale->decimal_point_length);
+		length += locale->decimal_point_length;
+		memcpy(buffer + length, decimals, count);
+		length += count;
+	}
+	if (unit != NULL) {
+		buffer[length++] = ' ';
+		memcpy(buffer + length, unit, strlen(unit));
+		length += strlen(unit);
+	}
+
+	if (fs->width > length) {
+		padding = fs->width - length;
+	}
+	if (fs->left_justify) {
+		return printf_output_span(output, buffer, length) &&
+			   quantity_pad(output, ' ', padding);
+	} else if (fs->zero_padded) {
+		// Zeros go between the sign and the digits.
+		return (sign == 0 || printf_output(output, sign)) &&
+			   quantity_pad(output, '0', padding) &&
+			   printf_output_span(output, buffer + (sign != 0),
+								  length - (sign != 0));
+	}
+	return quantity_pad(output, ' ', padding) &&
+		   printf_output_span(output, buffer, length);
+}
+
+
+
+// Writes a character a number of times, for width.
+// Parameters:
+//     output - where to write to.
+//     character - the character.
+//     length - the number of times, may be 0.
+// Returns:
+//     true on success, false on error.
+static bool quantity_pad(output_specifier *output, char character,
+						 size_t length)
+{
+	char run[64];
+	size_t chunk = 0;
+
+	memset(run, character, sizeof(run));
+	while (length > 0) {
+		chunk = length < sizeof(run) ? length : sizeof(run);
+		if (!printf_output_span(output, run, chunk)) {
+			return false;
+		}
+		length -= chunk;
+	}
+	return true;
+}
@@ -0,0 +1,20 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_QUANTITY_H
+#define PRINTF_QUANTITY_H
+
+#include "printf_definitions.h"
+
+bool printf_quantity_iec_write(output_specifier *output,
+							   const format_specifier *fs,
+							   const printf_arg *argument, void *context);
+bool printf_quantity_si_write(output_specifier *output,
+							  const format_specifier *fs,
+							  const printf_arg *argument, void *context);
+bool printf_quantity_fixed_write(output_specifier *output,
+								 const format_specifier *fs,
+								 const printf_arg *argument, void *context);
+
+#endif // PRINTF_QUANTITY_H
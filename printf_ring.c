@@ -0,0 +1,419 @@
+// Part of printf function suite. Handles output into a single producer, single
+// consumer ring buffer in posix shared memory, for ringprintf. Lets a separate
+// process, e.g. a log shipper, pick up output without a pipe or socket.
+// Each printf call is one record, a 4 byte length followed by the characters,
+// padded so the next record starts on an 8 byte boundary. Records run off the 
+// end of the ring and carry on at the start. A record is only made visible to
+// the consumer once it has been written completely.
+// When the ring is full the producer either drops the record and counts it,
+// never blocking, or waits for the consumer to make room.
+// printf_ring_consumer.c is a reference consumer.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+// For ftruncate() and shm_open() when compiling as plain C.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "printf_definitions.h"
+#include "printf_ring.h"
+
+// Identifies shared memory as one of our rings, "PRNTFRNG".
+#define RING_MAGIC 0x474e5246544e5250ULL
+// Records start on multiples of this, so a length never wraps.
+#define RING_ALIGNMENT 8
+// Size of the length at the start of each record.
+#define RING_RECORD_HEADER_SIZE 4
+// Size of a cache line, head and tail are kept on separate ones.
+#define RING_CACHE_LINE 64
+
+
+
+// The header at the start of the shared memory, followed by the data. head is
+// only written by the consumer and tail only by the producer, each is only 
+// ever increased, and both are taken modulo capacity to index the data.
+typedef struct ring_header_struct {
+	uint64_t magic;
+	// Bytes of data, a power of two.
+	uint64_t capacity;
+	// Records dropped because the ring was full.
+	uint64_t dropped;
+	char padding1[RING_CACHE_LINE - 3 * sizeof(uint64_t)];
+	// End of the last record made visible to the consumer.
+	uint64_t tail;
+	char padding2[RING_CACHE_LINE - sizeof(uint64_t)];
+	// End of the last record the consumer has finished with.
+	uint64_t head;
+	char padding3[RING_CACHE_LINE - sizeof(uint64_t)];
+} ring_header;
+
+
+
+static bool ring_map(printf_ring *ring, int fd, size_t size);
+static void ring_copy_in(printf_ring *ring, uint64_t position, 
+						 const char *span, size_t length);
+static void ring_copy_out(const printf_ring *ring, uint64_t position, 
+						  char *buffer, size_t length);
+static uint64_t ring_record_size(uint64_t length);
+
+
+
+// Creates a new ring in shared memory, replacing any of the same name. 
+// Usually done by the consumer.
+// Parameters:
+//     ring - the ring to set up.
+//     name - the shm_open name, e.g. "/my_log_ring".
+//     capacity - bytes of data, must be a power of two and at least 64.
+// Returns:
+//     ring - set up on success.
+//     return - true on success, false on error.
+bool printf_ring_create(printf_ring *ring, const char *name, size_t capacity)
+{
+	ring_header *header = NULL;
+	int fd = -1;
+	
+	assert(ring != NULL);
+	assert(name != NULL);
+	if (ring == NULL || name == NULL || capacity < RING_CACHE_LINE || 
+		(capacity & (capacity - 1)) != 0) 
+	{
+		return false;
+	}
+	
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1) {
+		return false;
+	}
+	if (ftruncate(fd, sizeof(ring_header) + capacity) != 0) {
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+	if (!ring_map(ring, fd, sizeof(ring_header) + capacity)) {
+		shm_unlink(name);
+		return false;
+	}
+	ring->policy = RING_POLICY_drop;
+	
+	// The new memory is zeroed, so only the magic and capacity need setting.
+	// The magic goes last so producers never see a half set up ring.
+	header = (ring_header*) ring->base;
+	header->capacity = capacity;
+	__atomic_store_n(&header->magic, RING_MAGIC, __ATOMIC_RELEASE);
+	return true;
+}
+
+
+
+// Opens an existing ring in shared memory. Usually done by the producer.
+// Parameters:
+//     ring - the ring to set up.
+//     name - the shm_open name the ring was created with.
+//     policy - what the producer does when the ring is full.
+// Returns:
+//     ring - set up on success.
+//     return - true on success, false on error.
+bool printf_ring_open(printf_ring *ring, const char *name, 
+					  printf_ring_policy policy)
+{
+	struct stat shm_status;
+	ring_header *header = NULL;
+	int fd = -1;
+	
+	assert(ring != NULL);
+	assert(name != NULL);
+	if (ring == NULL || name == NULL) {
+		return false;
+	}
+	
+	fd = shm_open(name, O_RDWR, 0600);
+	if (fd == -1) {
+		return false;
+	}
+	if (fstat(fd, &shm_status) != 0 || 
+		(size_t) shm_status.st_size < sizeof(ring_header)) 
+	{
+		close(fd);
+		return false;
+	}
+	if (!ring_map(ring, fd, shm_status.st_size)) {
+		return false;
+	}
+	ring->policy = policy;
+	
+	header = (ring_header*) ring->base;
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != RING_MAGIC ||
+		header->capacity != ring->size - sizeof(ring_header)) 
+	{
+		printf_ring_close(ring);
+		return false;
+	}
+	return true;
+}
+
+
+
+// Closes a ring. The shared memory stays until shm_unlink is called.
+// Parameters:
+//     ring - the ring to close.
+// Returns:
+//     true on success, false on error.
+bool printf_ring_close(printf_ring *ring)
+{
+	bool result = (munmap(ring->base, ring->size) == 0);
+	ring->base = NULL;
+	ring->size = 0;
+	return result;
+}
+
+
+
+// Reads the oldest record out of the ring. For the consumer only.
+// Parameters:
+//     ring - the ring to read from.
+//     buffer - where to copy the record to, it is not '\0' terminated.
+//     size - the size of buffer.
+// Returns:
+//     buffer - holds the record.
+//     return - the length of the record, which may be 0, PRINTF_RING_EMPTY if
+//         there is no record, or PRINTF_RING_SKIPPED if the record doesn't 
+//         fit in buffer, in which case it is skipped.
+int printf_ring_read(printf_ring *ring, char *buffer, size_t size)
+{
+	ring_header *header = (ring_header*) ring->base;
+	uint64_t head = header->head;
+	uint64_t tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+	uint32_t length = 0;
+	int result = 0;
+	
+	if (head == tail) {
+		return PRINTF_RING_EMPTY;
+	}
+	
+	ring_copy_out(ring, head, (char*) &length, RING_RECORD_HEADER_SIZE);
+	if (length > size || length > INT_MAX) {
+		result = PRINTF_RING_SKIPPED;
+	} else {
+		ring_copy_out(ring, head + RING_RECORD_HEADER_SIZE, buffer, length);
+		result = length;
+	}
+	
+	// Let the producer reuse the space.
+	__atomic_store_n(&header->head, head + ring_record_size(length), 
+					 __ATOMIC_RELEASE);
+	return result;
+}
+
+
+
+// Gets the number of records dropped because the ring was full.
+// Parameters:
+//     ring - the ring to check.
+// Returns:
+//     the number of records dropped.
+uint64_t printf_ring_dropped(const printf_ring *ring)
+{
+	const ring_header *header = (const ring_header*) ring->base;
+	return __atomic_load_n(&header->dropped, __ATOMIC_RELAXED);
+}
+
+
+
+// Starts a new record. For the producer only.
+// Parameters:
+//     ring - the ring to write to.
+void printf_ring_begin(printf_ring *ring)
+{
+	ring->record_length = 0;
+	ring->record_dropped = false;
+}
+
+
+
+// Adds a span to the record being written. It is not visible to the consumer 
+// until printf_ring_commit.
+// Parameters:
+//     ring - the ring to write to.
+//     span - the characters to add.
+//     length - the number of characters in span.
+// Returns:
+//     true on success, false if the record has to be dropped.
+bool printf_ring_write(printf_ring *ring, const char *span, size_t length)
+{
+	ring_header *header = (ring_header*) ring->base;
+	uint64_t tail = header->tail;
+	uint64_t needed = ring_record_size(ring->record_length + length);
+	uint64_t head = 0;
+	
+	if (ring->record_dropped) {
+		return false;
+	}
+	if (ring->record_length + length > UINT32_MAX || 
+		needed > header->capacity) 
+	{
+		// It could never fit.
+		ring->record_dropped = true;
+		return false;
+	}
+	
+	head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+	while (tail + needed - head > header->capacity) {
+		if (ring->policy == RING_POLICY_drop) {
+			ring->record_dropped = true;
+			return false;
+		}
+		// Wait for the consumer to make room.
+		sched_yield();
+		head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+	}
+	
+	ring_copy_in(ring, tail + RING_RECORD_HEADER_SIZE + ring->record_length, 
+				 span, length);
+	ring->record_length += length;
+	return true;
+}
+
+
+
+// Finishes the record being written and makes it visible to the consumer.
+// Parameters:
+//     ring - the ring to write to.
+// Returns:
+//     true on success, false if the record was dropped.
+bool printf_ring_commit(printf_ring *ring)
+{
+	ring_header *header = (ring_header*) ring->base;
+	uint64_t tail = header->tail;
+	uint32_t length = ring->record_length;
+	
+	if (ring->record_dropped) {
+		printf_ring_abandon(ring);
+		return false;
+	}
+	// Make sure there is room for an empty record's length too.
+	if (length == 0 && !printf_ring_write(ring, "", 0)) {
+		printf_ring_abandon(ring);
+		return false;
+	}
+	
+	ring_copy_in(ring, tail, (const char*) &length, RING_RECORD_HEADER_SIZE);
+	__atomic_store_n(&header->tail, tail + ring_record_size(length), 
+					 __ATOMIC_RELEASE);
+	return true;
+}
+
+
+
+// Throws away the record being written. It is counted as dropped if it ran
+// out of room.
+// Parameters:
+//     ring - the ring being written to.
+void printf_ring_abandon(printf_ring *ring)
+{
+	ring_header *header = (ring_header*) ring->base;
+	
+	if (ring->record_dropped) {
+		__atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+	}
+	ring->record_length = 0;
+	ring->record_dropped = false;
+}
+
+
+
+// Maps the shared memory of a ring. Closes fd whether it succeeds or not.
+// Parameters:
+//     ring - the ring to map into.
+//     fd - the shared memory.
+//     size - the size of the shared memory.
+// Returns:
+//     true on success, false on error.
+static bool ring_map(printf_ring *ring, int fd, size_t size)
+{
+	ring->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring->base == MAP_FAILED) {
+		ring->base = NULL;
+		return false;
+	}
+	ring->size = size;
+	ring->record_length = 0;
+	ring->record_dropped = false;
+	return true;
+}
+
+
+
+// Copies a span into the ring's data, wrapping around at the end.
+// Parameters:
+//     ring - the ring to copy into.
+//     position - where to copy to, before being taken modulo capacity.
+//     span - the characters to copy.
+//     length - the number of characters in span.
+static void ring_copy_in(printf_ring *ring, uint64_t position, 
+						 const char *span, size_t length)
+{
+	ring_header *header = (ring_header*) ring->base;
+	char *data = ring->base + sizeof(ring_header);
+	uint64_t offset = position & (header->capacity - 1);
+	uint64_t first = header->capacity - offset;
+	
+	if (first >= length) {
+		memcpy(data + offset, span, length);
+	} else {
+		memcpy(data + offset, span, first);
+		memcpy(data, span + first, length - first);
+	}
+}
+
+
+
+// Copies a span out of the ring's data, wrapping around at the end.
+// Parameters:
+//     ring - the ring to copy from.
+//     position - where to copy from, before being taken modulo capacity.
+//     buffer - where to copy to.
+//     length - the number of characters to copy.
+static void ring_copy_out(const printf_ring *ring, uint64_t position, 
+						  char *buffer, size_t length)
+{
+	const ring_header *header = (const ring_header*) ring->base;
+	const char *data = ring->base + sizeof(ring_header);
+	uint64_t offset = position & (header->capacity - 1);
+	uint64_t first = header->capacity - offset;
+	
+	if (first >= length) {
+		memcpy(buffer, data + offset, length);
+	} else {
+		memcpy(buffer, data + offset, first);
+		memcpy(buffer + first, data, length - first);
+	}
+}
+
+
+
+// Works out how much of the ring a record takes up.
+// Parameters:
+//     length - the number of characters in the record.
+// Returns:
+//     the size of the record including its length and padding.
+static uint64_t ring_record_size(uint64_t length)
+{
+	return (RING_RECORD_HEADER_SIZE + length + RING_ALIGNMENT - 1) & 
+		   ~(uint64_t) (RING_ALIGNMENT - 1);
+}
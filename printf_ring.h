@@ -0,0 +1,22 @@
+// Part of printf function suite. See other files for usage instructions.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+#ifndef PRINTF_RING_H
+#define PRINTF_RING_H
+
+#include "printf_definitions.h"
+
+bool printf_ring_create(printf_ring *ring, const char *name, size_t capacity);
+bool printf_ring_open(printf_ring *ring, const char *name, 
+					  printf_ring_policy policy);
+bool printf_ring_close(printf_ring *ring);
+int printf_ring_read(printf_ring *ring, char *buffer, size_t size);
+uint64_t printf_ring_dropped(const printf_ring *ring);
+
+void printf_ring_begin(printf_ring *ring);
+bool printf_ring_write(printf_ring *ring, const char *span, size_t length);
+bool printf_ring_commit(printf_ring *ring);
+void printf_ring_abandon(printf_ring *ring);
+
+#endif // PRINTF_RING_H
@@ -0,0 +1,119 @@
+// Reference consumer for the printf shared memory ring, see printf_ring.c.
+// Creates the ring and copies each record to stdout as it arrives, reporting 
+// how many records producers have dropped when that changes. Producers open 
+// the ring with printf_ring_open and write to it with new_ringprintf.
+//
+// Usage: printf_ring_consumer name [capacity]
+//     name - the shm_open name, e.g. "/my_log_ring".
+//     capacity - bytes of data in the ring, a power of two. Default 1 MiB.
+// Stops, removing the ring, on SIGINT or SIGTERM.
+//
+// Copyright 2017 - Elliot Dawber. MIT licensed.
+
+// For nanosleep() and shm_unlink() when compiling as plain C.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "printf_definitions.h"
+#include "printf_ring.h"
+
+#define DEFAULT_CAPACITY (1024 * 1024)
+// How long to sleep when the ring is empty, in nanoseconds.
+#define IDLE_SLEEP 1000000
+
+
+
+static volatile sig_atomic_t running = 1;
+
+
+
+static void stop_running(int signal_number);
+
+
+
+int main(int argc, char **argv)
+{
+	printf_ring ring;
+	struct timespec idle = { 0, IDLE_SLEEP };
+	size_t capacity = DEFAULT_CAPACITY;
+	char *buffer = NULL;
+	int length = 0;
+	uint64_t dropped = 0;
+	uint64_t last_dropped = 0;
+	
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "Usage: %s name [capacity]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc == 3) {
+		capacity = strtoull(argv[2], NULL, 0);
+	}
+	
+	if (!printf_ring_create(&ring, argv[1], capacity)) {
+		fprintf(stderr, "Couldn't create ring %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	// No record can be bigger than the ring.
+	buffer = malloc(capacity);
+	if (buffer == NULL) {
+		printf_ring_close(&ring);
+		shm_unlink(argv[1]);
+		return EXIT_FAILURE;
+	}
+	
+	signal(SIGINT, stop_running);
+	signal(SIGTERM, stop_running);
+	
+	while (running) {
+		length = printf_ring_read(&ring, buffer, capacity);
+		if (length >= 0) {
+			fwrite(buffer, 1, length, stdout);
+		} else if (length == PRINTF_RING_EMPTY) {
+			fflush(stdout);
+			nanosleep(&idle, NULL);
+		}
+		
+		dropped = printf_ring_dropped(&ring);
+		if (dropped != last_dropped) {
+			fprintf(stderr, "%llu records dropped\n", 
+					(unsigned long long) dropped);
+			last_dropped = dropped;
+		}
+	}
+	
+	// Pick up anything left over.
+	while ((length = printf_ring_read(&ring, buffer, capacity)) != 
+		   PRINTF_RING_EMPTY) 
+	{
+		if (length >= 0) {
+			fwrite(buffer, 1, length, stdout);
+		}
+	}
+	fflush(stdout);
+	
+	free(buffer);
+	printf_ring_close(&ring);
+	shm_unlink(argv[1]);
+	return EXIT_SUCCESS;
+}
+
+
+
+// Signal handler, makes the main loop finish.
+// Parameters:
+//     signal_number - unused.
+static void stop_running(int signal_number)
+{
+	(void) signal_number;
+	running = 0;
+}